@@ -55,6 +55,29 @@ public:
 
     // render the mesh
     void Draw(Shader &shader)
+    {
+        BindTextures(shader);
+
+        // draw mesh
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // render count instances of the mesh, read from the buffer attached by InstanceBuffer
+    void DrawInstanced(Shader &shader, int count)
+    {
+        BindTextures(shader);
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, count);
+        glBindVertexArray(0);
+    }
+
+    // binds the textures of the mesh to units from 0 on, for drawing it or something else with its material
+    void BindTextures(Shader &shader) const
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -81,21 +104,52 @@ public:
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
+        glActiveTexture(GL_TEXTURE0);
+    }
 
+    // keeps only the triangles the predicate is true for, to leave out a part that is drawn some other way
+    template<typename Predicate>
+    void KeepTriangles(Predicate keep)
+    {
+        vector<unsigned int> kept;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            if (keep(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]))
+                kept.insert(kept.end(), &indices[i], &indices[i] + 3);
+        indices = kept;
+        glBindVertexArray(VAO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+    }
 
+    // rebuilds the mesh with the vertices of a lightmap layout (vertices along chart seams are duplicated)
+    // and feeds the lightmap coordinates to attribute 5
+    void SetLightmapLayout(const vector<unsigned int>& remap, const vector<glm::vec2>& lightmapCoords,
+                           const vector<unsigned int>& lightmapIndices)
+    {
+        vector<Vertex> remapped(remap.size());
+        for (size_t i = 0; i < remap.size(); i++)
+            remapped[i] = vertices[remap[i]];
+        vertices = remapped;
+        indices = lightmapIndices;
+
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        setupMesh();
 
-        // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glGenBuffers(1, &lightmapVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, lightmapVBO);
+        glBufferData(GL_ARRAY_BUFFER, lightmapCoords.size() * sizeof(glm::vec2), &lightmapCoords[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
         glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
     }
 
 private:
     // render data
     unsigned int VBO, EBO;
+    unsigned int lightmapVBO = 0;
 
     // initializes all the buffer objects/arrays
     void setupMesh()
@@ -8,7 +8,14 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 #include <common.h>
+
+// glad is generated for GL 3.3, compute shaders are loaded by hand where the context has them (rg/ComputeBlur.h)
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+
 class Shader
 {
 public:
@@ -64,44 +71,54 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        compile(vertexCode, fragmentCode, geometryCode);
+    }
+    // compiles sources that are already in memory, e.g. generated or preprocessed ones
+    // ------------------------------------------------------------------------
+    static Shader FromSource(const std::string& vertexCode, const std::string& fragmentCode,
+                             const std::string& geometryCode = "")
+    {
+        Shader shader;
+        shader.compile(vertexCode, fragmentCode, geometryCode);
+        return shader;
+    }
+    // a vertex shader alone, whose outputs are captured by transform feedback into one interleaved buffer
+    // instead of being rasterized
+    // ------------------------------------------------------------------------
+    static Shader TransformFeedback(const char* vertexPath, const std::vector<const char*>& varyings)
+    {
+        std::string vertexCode = readFileContents(vertexPath);
         const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
+        unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertex, 1, &vShaderCode, NULL);
         glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
-        {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
-        }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
+        Shader shader;
+        shader.checkCompileErrors(vertex, "VERTEX");
+        shader.ID = glCreateProgram();
+        glAttachShader(shader.ID, vertex);
+        // has to be known before linking
+        glTransformFeedbackVaryings(shader.ID, (GLsizei) varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(shader.ID);
+        shader.checkCompileErrors(shader.ID, "PROGRAM");
         glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        return shader;
+    }
+    // a compute shader alone, from source that is already in memory; only for contexts of GL 4.3 or newer
+    // ------------------------------------------------------------------------
+    static Shader Compute(const std::string& computeCode)
+    {
+        const char* cShaderCode = computeCode.c_str();
+        unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(compute, 1, &cShaderCode, NULL);
+        glCompileShader(compute);
+        Shader shader;
+        shader.checkCompileErrors(compute, "COMPUTE");
+        shader.ID = glCreateProgram();
+        glAttachShader(shader.ID, compute);
+        glLinkProgram(shader.ID);
+        shader.checkCompileErrors(shader.ID, "PROGRAM");
+        glDeleteShader(compute);
+        return shader;
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -169,6 +186,49 @@ public:
     }
 
 private:
+    Shader() : ID(0) {}
+
+    void compile(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode)
+    {
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+        // 2. compile shaders
+        unsigned int vertex, fragment;
+        // vertex shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+        // fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+        // if geometry shader is given, compile geometry shader
+        unsigned int geometry;
+        if(!geometryCode.empty())
+        {
+            const char * gShaderCode = geometryCode.c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
+        // shader Program
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        if(!geometryCode.empty())
+            glAttachShader(ID, geometry);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        if(!geometryCode.empty())
+            glDeleteShader(geometry);
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
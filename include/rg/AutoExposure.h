@@ -0,0 +1,172 @@
+#ifndef PROJECT_BASE_AUTOEXPOSURE_H
+#define PROJECT_BASE_AUTOEXPOSURE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/FrameGraph.h>
+
+#include <functional>
+
+// Exposure adapted to a histogram of the scene's log luminance, without the CPU ever seeing a number:
+// 1. the scene is reduced to LUMINANCE_WIDTH x LUMINANCE_HEIGHT log2 luminance values,
+// 2. every one of them is drawn as a point into the bin it falls in, additive blending does the counting,
+// 3. a single pixel averages the bins between two percentiles and moves the exposure towards the one that
+//    average calls for; the 1x1 result is what the tonemapper samples.
+// The exposure textures are ping-ponged so step 3 can read the exposure of the last frame.
+class AutoExposure {
+public:
+    static const int BINS = 128;
+    static const int LUMINANCE_WIDTH = 128;
+    static const int LUMINANCE_HEIGHT = 72;
+
+    // range of log2 luminance the histogram covers, anything outside lands in the first or last bin
+    float minLogLuminance = -8.0f;
+    float maxLogLuminance = 4.0f;
+    // the darkest and brightest fractions of the screen are left out of the average
+    float lowPercentile = 0.5f;
+    float highPercentile = 0.95f;
+    // exposure that maps the average luminance to key, shifted by compensation stops
+    float key = 0.5f;
+    float compensation = 0.0f;
+    float minExposure = 0.05f;
+    float maxExposure = 8.0f;
+    // how fast the eye adapts, per second, going brighter and darker
+    float speedUp = 3.0f;
+    float speedDown = 1.0f;
+
+    AutoExposure() {
+        luminance = createTexture(LUMINANCE_WIDTH, LUMINANCE_HEIGHT, GL_R16F, nullptr);
+        histogram = createTexture(BINS, 1, GL_R32F, nullptr);
+        float initial = 1.0f;
+        for (int i = 0; i < 2; i++)
+            exposure[i] = createTexture(1, 1, GL_R32F, &initial);
+        glGenFramebuffers(1, &luminanceFBO);
+        attach(luminanceFBO, luminance);
+        glGenFramebuffers(1, &histogramFBO);
+        attach(histogramFBO, histogram);
+        glGenFramebuffers(2, exposureFBO);
+        for (int i = 0; i < 2; i++)
+            attach(exposureFBO[i], exposure[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // the points of the histogram are generated from gl_VertexID, but a core context still wants a VAO bound
+        glGenVertexArrays(1, &emptyVAO);
+    }
+
+    void destroy() {
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteFramebuffers(1, &luminanceFBO);
+        glDeleteFramebuffers(1, &histogramFBO);
+        glDeleteFramebuffers(2, exposureFBO);
+        glDeleteTextures(1, &luminance);
+        glDeleteTextures(1, &histogram);
+        glDeleteTextures(2, exposure);
+    }
+
+    AutoExposure(const AutoExposure&) = delete;
+    AutoExposure& operator=(const AutoExposure&) = delete;
+
+    // leaves framebuffer 0 bound and the viewport as it was
+    void update(unsigned int scene, float deltaTime, Shader& luminanceShader, Shader& histogramShader,
+                Shader& adaptShader, const std::function<void()>& drawQuad) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glActiveTexture(GL_TEXTURE0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, luminanceFBO);
+        glViewport(0, 0, LUMINANCE_WIDTH, LUMINANCE_HEIGHT);
+        luminanceShader.use();
+        luminanceShader.setInt("scene", 0);
+        luminanceShader.setVec2("blockSize", glm::vec2(1.0f / LUMINANCE_WIDTH, 1.0f / LUMINANCE_HEIGHT));
+        glBindTexture(GL_TEXTURE_2D, scene);
+        drawQuad();
+
+        GLfloat clearColor[4];
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+        glBindFramebuffer(GL_FRAMEBUFFER, histogramFBO);
+        glViewport(0, 0, BINS, 1);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        histogramShader.use();
+        histogramShader.setInt("luminance", 0);
+        histogramShader.setInt("bins", BINS);
+        histogramShader.setFloat("minLogLuminance", minLogLuminance);
+        histogramShader.setFloat("logLuminanceRange", maxLogLuminance - minLogLuminance);
+        glBindTexture(GL_TEXTURE_2D, luminance);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_POINTS, 0, LUMINANCE_WIDTH * LUMINANCE_HEIGHT);
+        glBindVertexArray(0);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDisable(GL_BLEND);
+
+        int previous = current;
+        current = 1 - current;
+        glBindFramebuffer(GL_FRAMEBUFFER, exposureFBO[current]);
+        glViewport(0, 0, 1, 1);
+        adaptShader.use();
+        adaptShader.setInt("histogram", 0);
+        adaptShader.setInt("previousExposure", 1);
+        adaptShader.setInt("bins", BINS);
+        adaptShader.setFloat("minLogLuminance", minLogLuminance);
+        adaptShader.setFloat("logLuminanceRange", maxLogLuminance - minLogLuminance);
+        adaptShader.setFloat("lowPercentile", lowPercentile);
+        adaptShader.setFloat("highPercentile", highPercentile);
+        adaptShader.setFloat("key", key);
+        adaptShader.setFloat("compensation", compensation);
+        adaptShader.setFloat("minExposure", minExposure);
+        adaptShader.setFloat("maxExposure", maxExposure);
+        adaptShader.setFloat("speedUp", speedUp);
+        adaptShader.setFloat("speedDown", speedDown);
+        adaptShader.setFloat("deltaTime", deltaTime);
+        glBindTexture(GL_TEXTURE_2D, histogram);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, exposure[previous]);
+        drawQuad();
+        glActiveTexture(GL_TEXTURE0);
+
+        if (blend)
+            glEnable(GL_BLEND);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    // 1x1 texture with the exposure the last update() arrived at
+    unsigned int texture() const { return exposure[current]; }
+
+    RenderTargetDesc desc() const { return {1, 1, GL_R32F}; }
+
+private:
+    unsigned int luminance, histogram, exposure[2];
+    unsigned int luminanceFBO, histogramFBO, exposureFBO[2];
+    unsigned int emptyVAO;
+    int current = 0;
+
+    static unsigned int createTexture(int width, int height, GLenum internalFormat, const float* data) {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RED, GL_FLOAT, data);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+
+    static void attach(unsigned int FBO, unsigned int texture) {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    }
+};
+
+#endif //PROJECT_BASE_AUTOEXPOSURE_H
@@ -0,0 +1,208 @@
+#ifndef PROJECT_BASE_BLOOM_H
+#define PROJECT_BASE_BLOOM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/FrameGraph.h>
+
+#include <algorithm>
+#include <functional>
+
+// Bloom over a chain of progressively halved textures, in the style of Call of Duty: Advanced Warfare.
+// The bright parts of the scene are downsampled level by level with a 13 tap filter, then every level is upsampled with a
+// 3x3 tent and added onto the one above it, so the blur gets wider with every level while each pass only
+// touches a quarter of the pixels of the previous one. The result is half the resolution of the source.
+// An occlusion query on the first downsample tells whether anything was bright at all; when a frame had nothing,
+// the next one stops after the first level. The answer is read as soon as the GPU has it, normally on the next
+// frame, so the CPU never waits for it and bloom that appears out of nothing shows up one frame late. While the GPU
+// runs further behind, up to MAX_QUERIES are in flight; past that no query is issued and the last answer stands.
+class MipChainBloom {
+public:
+    static const int MAX_LEVELS = 6;
+    static const int MAX_QUERIES = 3;
+
+    // number of levels used, the blur radius roughly doubles with every one
+    int levels = MAX_LEVELS;
+    // radius of the upsampling tent in texture coordinates, the same on every level so it spans more texels on the small ones
+    float filterRadius = 0.004f;
+    // luminance above which the source blooms
+    float threshold = 1.3f;
+    // multiplies the sum of all levels
+    float intensity = 1.0f;
+    // skip the rest of the chain when the last known first level was completely dark
+    bool skipWhenDark = true;
+
+    MipChainBloom(int width, int height) {
+        glGenTextures(MAX_LEVELS, mips);
+        for (int i = 0; i < MAX_LEVELS; i++) {
+            glBindTexture(GL_TEXTURE_2D, mips[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        glGenFramebuffers(1, &FBO);
+        glGenQueries(MAX_QUERIES, queries);
+        resize(width, height);
+    }
+
+    void destroy() {
+        glDeleteQueries(MAX_QUERIES, queries);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteTextures(MAX_LEVELS, mips);
+    }
+
+    MipChainBloom(const MipChainBloom&) = delete;
+    MipChainBloom& operator=(const MipChainBloom&) = delete;
+
+    // reallocates the chain for a new source size or format, does nothing if neither changed
+    void resize(int width, int height, GLenum internalFormat = GL_RGBA16F) {
+        if (width == sourceWidth && height == sourceHeight && internalFormat == format)
+            return;
+        sourceWidth = width;
+        sourceHeight = height;
+        format = internalFormat;
+        for (int i = 0; i < MAX_LEVELS; i++) {
+            sizes[i] = glm::ivec2(std::max(1, width >> (i + 1)), std::max(1, height >> (i + 1)));
+            glBindTexture(GL_TEXTURE_2D, mips[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, sizes[i].x, sizes[i].y, 0, GL_RGBA, GL_FLOAT, NULL);
+        }
+    }
+
+    // blurs the bright parts of source and returns the texture holding the bloom, or 0 when the bloom was skipped
+    // because nothing was bright; leaves framebuffer 0 bound
+    unsigned int render(unsigned int source, Shader& downsampleShader, Shader& upsampleShader,
+                        const std::function<void()>& drawQuad) {
+        int count = std::max(1, std::min(levels, MAX_LEVELS));
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glActiveTexture(GL_TEXTURE0);
+
+        downsampleShader.use();
+        downsampleShader.setInt("source", 0);
+        downsampleShader.setFloat("threshold", threshold);
+        glm::vec2 sourceSize = glm::vec2(sourceWidth, sourceHeight);
+        glBindTexture(GL_TEXTURE_2D, source);
+        collectQueries();
+        lastSkipped = skipWhenDark && !anyBright;
+        for (int i = 0; i < count; i++) {
+            // the first level also does the bright pass, and its Karis average keeps single very bright pixels from flickering;
+            // it discards the dark pixels, so the query counts the bright ones
+            downsampleShader.setInt("firstLevel", i == 0);
+            downsampleShader.setVec2("sourceTexelSize", 1.0f / sourceSize);
+            target(i);
+            if (i == 0) {
+                GLfloat clearColor[4];
+                glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+                glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+                glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+                if (pendingQueries < MAX_QUERIES) {
+                    glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[(oldestQuery + pendingQueries) % MAX_QUERIES]);
+                    drawQuad();
+                    glEndQuery(GL_ANY_SAMPLES_PASSED);
+                    pendingQueries++;
+                } else {
+                    drawQuad();
+                }
+                if (lastSkipped)
+                    break;
+            } else {
+                drawQuad();
+            }
+            glBindTexture(GL_TEXTURE_2D, mips[i]);
+            sourceSize = glm::vec2(sizes[i].x, sizes[i].y);
+        }
+
+        if (!lastSkipped) {
+            upsampleShader.use();
+            upsampleShader.setInt("source", 0);
+            upsampleShader.setFloat("filterRadius", filterRadius);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            for (int i = count - 1; i > 0; i--) {
+                glBindTexture(GL_TEXTURE_2D, mips[i]);
+                target(i - 1);
+                drawQuad();
+            }
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+        if (!blend)
+            glDisable(GL_BLEND);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        return lastSkipped ? 0 : mips[0];
+    }
+
+    // the texture render() leaves the bloom in
+    unsigned int texture() const { return mips[0]; }
+
+    RenderTargetDesc desc() const { return {sizes[0].x, sizes[0].y, format}; }
+
+    // estimated traffic of the last render() below the first level, which the frame graph doesn't see: every
+    // downsample reads the level above and writes its own, every upsample reads its level and blends onto the one above
+    void traffic(size_t& bytesRead, size_t& bytesWritten) const {
+        bytesRead = bytesWritten = 0;
+        int count = lastSkipped ? 1 : std::max(1, std::min(levels, MAX_LEVELS));
+        for (int i = 1; i < count; i++) {
+            size_t level = RenderTargetDesc{sizes[i].x, sizes[i].y, format}.bytes();
+            size_t above = RenderTargetDesc{sizes[i - 1].x, sizes[i - 1].y, format}.bytes();
+            bytesRead += above + level + above;
+            bytesWritten += level + above;
+        }
+    }
+
+    // whether the last render stopped early because nothing was bright
+    bool skipped() const { return lastSkipped; }
+
+    // what the bloom texture has to be scaled by when it is added to the scene, every level contributes once
+    float strength() const {
+        return intensity / (float) std::max(1, std::min(levels, MAX_LEVELS));
+    }
+
+private:
+    unsigned int FBO;
+    unsigned int mips[MAX_LEVELS];
+    glm::ivec2 sizes[MAX_LEVELS];
+    int sourceWidth = 0, sourceHeight = 0;
+    GLenum format = 0;
+    unsigned int queries[MAX_QUERIES];
+    // the queries in flight, pendingQueries of them from oldestQuery on in the order they were issued
+    int oldestQuery = 0;
+    int pendingQueries = 0;
+    // until the first query answers everything is assumed to be bright
+    bool anyBright = true;
+    bool lastSkipped = false;
+
+    // reads the queries the GPU is done with, oldest first, so the answer is the newest there is; a query that
+    // isn't done yet keeps the last answer and stays in flight
+    void collectQueries() {
+        while (pendingQueries > 0) {
+            GLint available = 0;
+            glGetQueryObjectiv(queries[oldestQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return;
+            GLuint result = 0;
+            glGetQueryObjectuiv(queries[oldestQuery], GL_QUERY_RESULT, &result);
+            anyBright = result != 0;
+            oldestQuery = (oldestQuery + 1) % MAX_QUERIES;
+            pendingQueries--;
+        }
+    }
+
+    void target(int level) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mips[level], 0);
+        glViewport(0, 0, sizes[level].x, sizes[level].y);
+    }
+};
+
+#endif //PROJECT_BASE_BLOOM_H
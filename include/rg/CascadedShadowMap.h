@@ -0,0 +1,255 @@
+#ifndef PROJECT_BASE_CASCADEDSHADOWMAP_H
+#define PROJECT_BASE_CASCADEDSHADOWMAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/ShaderVariants.h>
+
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Something that casts a shadow and may move: its world space bounding sphere is used to skip cascades it can't touch.
+// It is drawn with the variant of the depth shader for keywords, e.g. INSTANCED for an rg/InstanceBuffer.h.
+struct ShadowCaster {
+    glm::vec3 center;
+    float radius;
+    std::function<void(Shader&)> draw;
+    unsigned int keywords = 0;
+    // moves within its bounds, which stay the same, so that alone doesn't tell whether it moved
+    bool animated = false;
+};
+
+// Cascaded shadow maps for the directional light.
+// Static casters are rendered into a cached depth array that is refreshed only when the light direction
+// or the bounds of a cascade change. The bounds are fitted to a sphere around each slice of the view frustum
+// (so they don't change when the camera rotates), snapped to whole texels and given some slack, so that
+// moving the camera around does not invalidate them every frame. Each frame the cached depth is copied into
+// the sampled array and the dynamic casters are drawn on top of it.
+class CascadedShadowMap {
+public:
+    static const int NUM_CASCADES = 4;
+
+    int resolution;
+    float shadowDistance = 40.0f;
+    // 0 gives uniform splits, 1 logarithmic ones
+    float splitLambda = 0.75f;
+    // how much bigger the cached region is than the slice it covers
+    float cacheMargin = 0.2f;
+
+    explicit CascadedShadowMap(int resolution = 2048) : resolution(resolution) {
+        staticMap = createDepthArray(false);
+        shadowMap = createDepthArray(true);
+
+        glGenFramebuffers(NUM_CASCADES, staticFBO);
+        glGenFramebuffers(NUM_CASCADES, shadowFBO);
+        for (int i = 0; i < NUM_CASCADES; i++) {
+            attachLayer(staticFBO[i], staticMap, i);
+            attachLayer(shadowFBO[i], shadowMap, i);
+            cascades[i].staticValid = false;
+            cascades[i].hasDynamic = false;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void destroy() {
+        glDeleteFramebuffers(NUM_CASCADES, staticFBO);
+        glDeleteFramebuffers(NUM_CASCADES, shadowFBO);
+        glDeleteTextures(1, &staticMap);
+        glDeleteTextures(1, &shadowMap);
+    }
+
+    CascadedShadowMap(const CascadedShadowMap&) = delete;
+    CascadedShadowMap& operator=(const CascadedShadowMap&) = delete;
+
+    // forces the static casters to be redrawn, e.g. after a static object was moved
+    void invalidate() {
+        for (int i = 0; i < NUM_CASCADES; i++)
+            cascades[i].staticValid = false;
+    }
+
+    // number of cascades whose static depth was redrawn during the last update
+    int staticRedraws() const { return lastStaticRedraws; }
+
+    void update(const glm::mat4& view, float fovDegrees, float aspect, float nearPlane, glm::vec3 lightDirection,
+                ShaderVariants& depthShaders, const std::function<void(Shader&)>& drawStatic,
+                const std::vector<ShadowCaster>& dynamicCasters) {
+        lightDirection = glm::normalize(lightDirection);
+        if (lightDirection != cachedLightDirection) {
+            cachedLightDirection = lightDirection;
+            glm::vec3 up = std::fabs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+            invalidate();
+        }
+
+        glm::mat4 inverseView = glm::inverse(view);
+        glm::vec3 cameraPosition = glm::vec3(inverseView[3]);
+        glm::vec3 cameraForward = -glm::normalize(glm::vec3(inverseView[2]));
+        float tanHalfFov = std::tan(glm::radians(fovDegrees) * 0.5f);
+        // squared distance of a frustum corner from the view axis, per unit of depth
+        float k2 = tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);
+
+        float sliceNear = nearPlane;
+        for (int i = 0; i < NUM_CASCADES; i++) {
+            float t = (float) (i + 1) / NUM_CASCADES;
+            float logSplit = nearPlane * std::pow(shadowDistance / nearPlane, t);
+            float uniformSplit = nearPlane + (shadowDistance - nearPlane) * t;
+            float sliceFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+            splits[i] = sliceFar;
+
+            // smallest sphere around the frustum slice, it only depends on the slice so it is rotation invariant
+            float centerDistance = std::min(0.5f * (sliceNear + sliceFar) * (1.0f + k2), sliceFar);
+            float radius = std::max(std::sqrt((centerDistance - sliceNear) * (centerDistance - sliceNear) + sliceNear * sliceNear * k2),
+                                    std::sqrt((sliceFar - centerDistance) * (sliceFar - centerDistance) + sliceFar * sliceFar * k2));
+            radius = std::ceil(radius * 16.0f) / 16.0f;
+            glm::vec3 center = glm::vec3(lightView * glm::vec4(cameraPosition + cameraForward * centerDistance, 1.0f));
+            fitCascade(cascades[i], center, radius);
+            sliceNear = sliceFar;
+        }
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glViewport(0, 0, resolution, resolution);
+        // casters between the light and the near plane are clamped instead of clipped away
+        glEnable(GL_DEPTH_CLAMP);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(1.1f, 2.0f);
+
+        Shader& depthShader = depthShaders.get(0);
+        lastStaticRedraws = 0;
+        std::vector<const ShadowCaster*> visible;
+        for (int i = 0; i < NUM_CASCADES; i++) {
+            Cascade& cascade = cascades[i];
+            depthShader.use();
+            depthShader.setMat4("lightSpaceMatrix", cascade.lightSpaceMatrix);
+
+            bool copyStatic = false;
+            if (!cascade.staticValid) {
+                glBindFramebuffer(GL_FRAMEBUFFER, staticFBO[i]);
+                glClear(GL_DEPTH_BUFFER_BIT);
+                drawStatic(depthShader);
+                cascade.staticValid = true;
+                copyStatic = true;
+                lastStaticRedraws++;
+            }
+
+            visible.clear();
+            for (const ShadowCaster& caster: dynamicCasters) {
+                glm::vec3 p = glm::vec3(lightView * glm::vec4(caster.center, 1.0f));
+                if (std::fabs(p.x - cascade.center.x) < cascade.radius + caster.radius &&
+                    std::fabs(p.y - cascade.center.y) < cascade.radius + caster.radius &&
+                    p.z + caster.radius > cascade.center.z - cascade.radius)
+                    visible.push_back(&caster);
+            }
+
+            // the sampled layer only has to be rebuilt if it is stale or some dynamic caster was, or is, in it
+            if (copyStatic || cascade.hasDynamic || !visible.empty()) {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFBO[i]);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, shadowFBO[i]);
+                glBlitFramebuffer(0, 0, resolution, resolution, 0, 0, resolution, resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+                glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO[i]);
+                for (const ShadowCaster* caster: visible) {
+                    Shader& casterShader = depthShaders.get(caster->keywords);
+                    casterShader.use();
+                    casterShader.setMat4("lightSpaceMatrix", cascade.lightSpaceMatrix);
+                    caster->draw(casterShader);
+                }
+                cascade.hasDynamic = !visible.empty();
+            }
+        }
+
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glEnable(GL_CULL_FACE);
+        glDisable(GL_DEPTH_CLAMP);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    // binds the shadow map to the given texture unit and sets the uniforms CalcShadow() in the lit shaders reads
+    void bind(Shader& shader, int textureUnit) const {
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("shadowMap", textureUnit);
+        for (int i = 0; i < NUM_CASCADES; i++) {
+            shader.setMat4("cascadeMatrices[" + std::to_string(i) + "]", cascades[i].lightSpaceMatrix);
+            shader.setFloat("cascadeSplits[" + std::to_string(i) + "]", splits[i]);
+        }
+        shader.setFloat("shadowTexelSize", 1.0f / resolution);
+    }
+
+private:
+    struct Cascade {
+        glm::mat4 lightSpaceMatrix;
+        // light space center and half size of the region the cached depth covers
+        glm::vec3 center;
+        float radius;
+        bool staticValid;
+        bool hasDynamic;
+    };
+
+    unsigned int staticMap, shadowMap;
+    unsigned int staticFBO[NUM_CASCADES], shadowFBO[NUM_CASCADES];
+    Cascade cascades[NUM_CASCADES];
+    float splits[NUM_CASCADES];
+    glm::mat4 lightView = glm::mat4(1.0f);
+    glm::vec3 cachedLightDirection = glm::vec3(0.0f);
+    int lastStaticRedraws = 0;
+
+    void fitCascade(Cascade& cascade, glm::vec3 center, float radius) {
+        if (cascade.staticValid) {
+            glm::vec3 offset = glm::abs(center - cascade.center);
+            bool sameSize = radius <= cascade.radius && radius * (1.0f + cacheMargin) > cascade.radius * 0.8f;
+            if (sameSize && std::max(offset.x, std::max(offset.y, offset.z)) + radius <= cascade.radius)
+                return;
+        }
+
+        // recenter on the slice, snapping to whole texels so the static depth doesn't shimmer when it's rebuilt
+        cascade.radius = radius * (1.0f + cacheMargin);
+        float texel = 2.0f * cascade.radius / resolution;
+        cascade.center = glm::vec3(std::floor(center.x / texel) * texel, std::floor(center.y / texel) * texel, center.z);
+        // the light looks down -z, depth range is given as distances along it
+        glm::mat4 projection = glm::ortho(cascade.center.x - cascade.radius, cascade.center.x + cascade.radius,
+                                          cascade.center.y - cascade.radius, cascade.center.y + cascade.radius,
+                                          -cascade.center.z - cascade.radius, -cascade.center.z + cascade.radius);
+        cascade.lightSpaceMatrix = projection * lightView;
+        cascade.staticValid = false;
+    }
+
+    unsigned int createDepthArray(bool comparison) {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, NUM_CASCADES, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, comparison ? GL_LINEAR : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, comparison ? GL_LINEAR : GL_NEAREST);
+        // everything outside of a cascade is lit
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+        if (comparison) {
+            // hardware depth comparison gives bilinear PCF for every tap
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+        return texture;
+    }
+
+    void attachLayer(unsigned int fbo, unsigned int texture, int layer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Shadow framebuffer not complete!" << std::endl;
+    }
+};
+
+#endif //PROJECT_BASE_CASCADEDSHADOWMAP_H
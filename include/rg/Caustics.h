@@ -0,0 +1,111 @@
+#ifndef PROJECT_BASE_CAUSTICS_H
+#define PROJECT_BASE_CAUSTICS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/CausticsFile.h>
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The caustics baked by caustics_baker, played back on the seabed with a single fetch per fragment: every layer
+// of the texture array holds one frame in red and the next one in green, so the shader blends the two frames
+// it falls between without a second fetch. The layer and the blend are the same for the whole frame and worked
+// out here.
+class Caustics {
+public:
+    // returns false (and changes nothing) without an up to date bake
+    bool load() {
+        uint64_t hash = hashCausticsSettings();
+        std::string path = causticsPath(hash);
+        CausticsData data;
+        if (!readCaustics(path, hash, data)) {
+            std::cout << "No baked caustics at " << path << ", run caustics_baker to create it" << std::endl;
+            return false;
+        }
+        size_t frameTexels = (size_t) data.size * data.size;
+        std::vector<uint8_t> pairs(2 * frameTexels * data.frames);
+        for (int frame = 0; frame < data.frames; frame++) {
+            const uint8_t* current = &data.texels[frameTexels * frame];
+            const uint8_t* next = &data.texels[frameTexels * ((frame + 1) % data.frames)];
+            uint8_t* layer = &pairs[2 * frameTexels * frame];
+            for (size_t i = 0; i < frameTexels; i++) {
+                layer[2 * i] = current[i];
+                layer[2 * i + 1] = next[i];
+            }
+        }
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RG8, data.size, data.size, data.frames, 0, GL_RG, GL_UNSIGNED_BYTE,
+                     pairs.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        // the pattern is fine enough to shimmer in the distance without mipmaps
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        frames = data.frames;
+        tileSize = data.tileSize;
+        period = data.period;
+        range = data.range;
+        bytes = pairs.size() * 4 / 3;
+        loaded = true;
+        return true;
+    }
+
+    bool isLoaded() const { return loaded; }
+
+    void destroy() {
+        if (loaded)
+            glDeleteTextures(1, &texture);
+    }
+
+    // binds the frames and sets the uniforms of the given time, once per frame and shader; light is the direction
+    // the sun shines in, strength blends from no caustics at 0 to the baked ones at 1
+    void bind(Shader& shader, int textureUnit, float time, const glm::vec3& light, float waterLevel, float strength) const {
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("caustics", textureUnit);
+
+        float position = std::fmod(time / period, 1.0f) * (float) frames;
+        float layer = std::floor(position);
+        shader.setFloat("causticsLayer", layer);
+        shader.setFloat("causticsBlend", position - layer);
+        shader.setFloat("causticsTileSize", tileSize);
+        shader.setFloat("causticsRange", range);
+        shader.setFloat("causticsStrength", strength);
+        shader.setFloat("waterLevel", waterLevel);
+
+        // the light under the surface, bent towards straight down; the bake only had light coming straight down,
+        // the shader samples the pattern where the bent light entered the water
+        glm::vec3 incident = glm::normalize(light);
+        float eta = 1.0f / 1.33f;
+        float cosIncident = std::fabs(incident.y);
+        float cosRefracted = std::sqrt(1.0f - eta * eta * (1.0f - cosIncident * cosIncident));
+        glm::vec3 refracted = eta * incident + (eta * cosIncident - cosRefracted) * glm::vec3(0.0f, 1.0f, 0.0f);
+        shader.setVec2("causticsShift", glm::vec2(refracted.x, refracted.z) / -refracted.y);
+    }
+
+    size_t textureBytes() const { return bytes; }
+
+private:
+    unsigned int texture = 0;
+    bool loaded = false;
+    int frames = 0;
+    float tileSize = 1.0f;
+    float period = 1.0f;
+    float range = 1.0f;
+    size_t bytes = 0;
+};
+
+#endif //PROJECT_BASE_CAUSTICS_H
@@ -0,0 +1,95 @@
+#ifndef PROJECT_BASE_CAUSTICSFILE_H
+#define PROJECT_BASE_CAUSTICSFILE_H
+
+#include <rg/LightmapFile.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// The light patterns written by the caustics baker (tools/caustics_baker.cpp) and drawn on the seabed by
+// rg/Caustics.h: CAUSTICS_FRAMES square frames of one loop of the water's motion, each tiling with itself.
+// Texels are 8 bit fractions of CAUSTICS_RANGE times the light an unmoving surface would let through, which is
+// also the average of every frame.
+// Like lightmaps, files are named after a hash of the bake settings, stale ones are simply never found.
+
+const uint32_t CAUSTICS_MAGIC = 0x53434352; // "RCCS"
+const uint32_t CAUSTICS_VERSION = 1;
+const char* const CAUSTICS_DIRECTORY = "resources/caustics";
+
+// bake settings, part of the hash
+const int CAUSTICS_SIZE = 256;
+const int CAUSTICS_FRAMES = 64;
+// world units a frame covers on a side
+const float CAUSTICS_TILE_SIZE = 4.0f;
+// seconds until the pattern repeats
+const float CAUSTICS_PERIOD = 4.0f;
+// depth below the surface the light is gathered at, where the waves focus it most
+const float CAUSTICS_DEPTH = 1.5f;
+// photons sent down through every texel, on a grid of this many on a side
+const int CAUSTICS_PHOTONS_PER_SIDE = 4;
+const float CAUSTICS_RANGE = 4.0f;
+
+struct CausticsData {
+    int size = 0;
+    int frames = 0;
+    float tileSize = 0.0f;
+    float period = 0.0f;
+    float range = 0.0f;
+    // frame after frame, rows from the lowest z
+    std::vector<uint8_t> texels;
+};
+
+inline uint64_t hashCausticsSettings() {
+    uint64_t hash = fnv1a(&CAUSTICS_VERSION, sizeof(CAUSTICS_VERSION));
+    hash = fnv1a(&CAUSTICS_SIZE, sizeof(CAUSTICS_SIZE), hash);
+    hash = fnv1a(&CAUSTICS_FRAMES, sizeof(CAUSTICS_FRAMES), hash);
+    hash = fnv1a(&CAUSTICS_TILE_SIZE, sizeof(CAUSTICS_TILE_SIZE), hash);
+    hash = fnv1a(&CAUSTICS_PERIOD, sizeof(CAUSTICS_PERIOD), hash);
+    hash = fnv1a(&CAUSTICS_DEPTH, sizeof(CAUSTICS_DEPTH), hash);
+    hash = fnv1a(&CAUSTICS_PHOTONS_PER_SIDE, sizeof(CAUSTICS_PHOTONS_PER_SIDE), hash);
+    return fnv1a(&CAUSTICS_RANGE, sizeof(CAUSTICS_RANGE), hash);
+}
+
+inline std::string causticsPath(uint64_t hash) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long) hash);
+    return std::string(CAUSTICS_DIRECTORY) + "/" + name + ".caustics";
+}
+
+inline bool writeCaustics(const std::string& path, uint64_t hash, const CausticsData& data) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        return false;
+    lightmapio::write(out, CAUSTICS_MAGIC);
+    lightmapio::write(out, CAUSTICS_VERSION);
+    lightmapio::write(out, hash);
+    lightmapio::write(out, data.size);
+    lightmapio::write(out, data.frames);
+    lightmapio::write(out, data.tileSize);
+    lightmapio::write(out, data.period);
+    lightmapio::write(out, data.range);
+    lightmapio::writeVector(out, data.texels);
+    return (bool) out;
+}
+
+inline bool readCaustics(const std::string& path, uint64_t hash, CausticsData& data) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    uint32_t magic, version;
+    uint64_t fileHash;
+    if (!lightmapio::read(in, magic) || magic != CAUSTICS_MAGIC ||
+        !lightmapio::read(in, version) || version != CAUSTICS_VERSION ||
+        !lightmapio::read(in, fileHash) || fileHash != hash ||
+        !lightmapio::read(in, data.size) || !lightmapio::read(in, data.frames) ||
+        !lightmapio::read(in, data.tileSize) || !lightmapio::read(in, data.period) ||
+        !lightmapio::read(in, data.range))
+        return false;
+    return lightmapio::readVector(in, data.texels) && data.size > 0 && data.frames > 0 &&
+           data.texels.size() == (size_t) data.size * data.size * data.frames;
+}
+
+#endif //PROJECT_BASE_CAUSTICSFILE_H
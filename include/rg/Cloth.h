@@ -0,0 +1,105 @@
+#ifndef PROJECT_BASE_CLOTH_H
+#define PROJECT_BASE_CLOTH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rg/ClothSimulation.h>
+
+#include <vector>
+
+// Draws a Cloth (rg/ClothSimulation.h) with the attributes of a model mesh: position and normal at 0 and 1, in
+// world space, and texture coordinates at 2; the position of the frame before is at 3, for the motion vectors of
+// the CLOTH variant of taaObjectVelocity.vs. Both sides are drawn, the back with its own copy of the vertices and
+// the normals turned around, so the cloth is lit from either side with culling on.
+// The positions and normals change every frame and are streamed into a buffer that is orphaned first: the driver
+// hands out fresh memory to write into while the GPU may still be drawing the last frame's, so the upload never
+// waits for it. The texture coordinates and the triangles never change.
+class ClothMesh {
+public:
+    // the texture coordinates run from uvCorner at the held corner to uvOpposite at the one across from it
+    ClothMesh(const Cloth& cloth, const glm::vec2& uvCorner, const glm::vec2& uvOpposite) {
+        int columns = cloth.columns(), rows = cloth.rows();
+        vertexCount = 2 * cloth.particleCount();
+        std::vector<glm::vec2> texCoords;
+        texCoords.reserve(vertexCount);
+        for (int side = 0; side < 2; side++)
+            for (int row = 0; row < rows; row++)
+                for (int column = 0; column < columns; column++) {
+                    glm::vec2 along((float) column / (float) (columns - 1), (float) row / (float) (rows - 1));
+                    texCoords.push_back(uvCorner + (uvOpposite - uvCorner) * along);
+                }
+        std::vector<unsigned int> indices;
+        unsigned int back = (unsigned int) cloth.particleCount();
+        for (int row = 0; row + 1 < rows; row++)
+            for (int column = 0; column + 1 < columns; column++) {
+                unsigned int i = row * columns + column;
+                unsigned int quad[6] = {i, i + columns, i + 1, i + 1, i + columns, i + columns + 1};
+                indices.insert(indices.end(), quad, quad + 6);
+                for (int k = 5; k >= 0; k--)
+                    indices.push_back(back + quad[k]);
+            }
+        indexCount = (int) indices.size();
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &texCoordBuffer);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes(), NULL, GL_STREAM_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*) 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*) (3 * sizeof(float)));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*) (6 * sizeof(float)));
+        glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
+        glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), &texCoords[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*) 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        upload(cloth);
+    }
+
+    void destroy() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &texCoordBuffer);
+        glDeleteBuffers(1, &EBO);
+    }
+
+    ClothMesh(const ClothMesh&) = delete;
+    ClothMesh& operator=(const ClothMesh&) = delete;
+
+    // the cloth as it is now, written straight into the buffer
+    void upload(const Cloth& cloth) {
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes(), NULL, GL_STREAM_DRAW);
+        float* mapped = (float*) glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexBytes(),
+                                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped)
+            cloth.writeVertices(mapped);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // with the model matrix of the shader set to identity
+    void draw() const {
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
+
+    GLsizeiptr vertexBytes() const { return (GLsizeiptr) vertexCount * 9 * sizeof(float); }
+
+private:
+    unsigned int VAO = 0, vertexBuffer = 0, texCoordBuffer = 0, EBO = 0;
+    int vertexCount = 0;
+    int indexCount = 0;
+};
+
+#endif //PROJECT_BASE_CLOTH_H
@@ -0,0 +1,386 @@
+#ifndef PROJECT_BASE_CLOTHSIMULATION_H
+#define PROJECT_BASE_CLOTHSIMULATION_H
+
+#include <glm/glm.hpp>
+
+#include <rg/JobPool.h>
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+struct ClothParams {
+    // solver steps per second, each frame runs as many as its time adds up to
+    float stepRate = 120.0f;
+    // a slow frame slows the cloth down rather than taking longer still
+    int maxSteps = 4;
+    int iterations = 8;
+    // how much of a stretch or a bend is undone after all the iterations of a step, 0 to 1
+    float stretchStiffness = 1.0f;
+    float bendStiffness = 0.15f;
+    // fraction of the velocity lost every step
+    float damping = 0.01f;
+    float gravity = 9.81f;
+    // acceleration of the cloth per unit of air speed across it
+    float aerodynamics = 3.0f;
+    glm::vec3 wind = glm::vec3(5.0f, 0.0f, 2.0f);
+    // how much the wind strength varies in the gusts that roll along with it, as a fraction of it
+    float gustiness = 0.5f;
+    // the constraints and the integration four at a time with SSE, or one at a time
+    bool simd = true;
+};
+
+// One piece of cloth, a grid of particles held at one edge, solved with position based dynamics: Verlet integration
+// of gravity and the push of the wind along the cloth's normal, then distance constraints between neighbours against
+// stretching and shearing and between particles two apart against bending.
+// Everything is kept as structure of arrays, padded to whole SSE registers. The constraints are sorted into batches
+// in which no two of them share a particle, which is what lets four of them be solved at once: the particles of four
+// constraints are gathered into registers, corrected together and scattered back, and since they are independent the
+// result is the same as solving them one after the other. Every batch is padded with constraints of a spare particle
+// that can't move.
+class Cloth {
+public:
+    // a grid of columns x rows particles over corner + across * [0, 1] + down * [0, 1] in the space of transform, at
+    // rest; the column along down at the corner is held in place
+    Cloth(int columns, int rows, const glm::vec3& corner, const glm::vec3& across, const glm::vec3& down,
+          const glm::mat4& transform)
+            : gridColumns(columns), gridRows(rows), corner(corner), across(across), down(down) {
+        int count = columns * rows;
+        // room for the spare particle
+        padded = (count + 4) / 4 * 4;
+        for (std::vector<float>* array: {&x, &y, &z, &previousX, &previousY, &previousZ, &drawnX, &drawnY, &drawnZ,
+                                         &forceX, &forceY, &forceZ, &normalX, &normalY, &normalZ, &inverseMass})
+            array->assign(padded, 0.0f);
+        for (int row = 0; row < rows; row++)
+            for (int column = 0; column < columns; column++) {
+                int i = index(column, row);
+                glm::vec3 position = restPosition(column, row, transform);
+                x[i] = previousX[i] = drawnX[i] = position.x;
+                y[i] = previousY[i] = drawnY[i] = position.y;
+                z[i] = previousZ[i] = drawnZ[i] = position.z;
+                inverseMass[i] = column == 0 ? 0.0f : 1.0f;
+            }
+
+        // stretching, shearing and bending, each family split by parity (or by pairs of columns or rows for the
+        // bending) so that no particle shows up twice in a batch; all but the ones along a row then join particles
+        // that lie next to each other in memory, four at a time
+        auto addBatch = [&](bool bending, int dc, int dr, const std::function<bool(int, int)>& inBatch) {
+            Batch batch;
+            batch.bending = bending;
+            batch.begin = (int) first.size();
+            for (int row = 0; row < rows; row++)
+                for (int column = 0; column < columns; column++) {
+                    int otherColumn = column + dc, otherRow = row + dr;
+                    if (otherColumn < 0 || otherColumn >= columns || otherRow >= rows || !inBatch(column, row))
+                        continue;
+                    first.push_back(index(column, row));
+                    second.push_back(index(otherColumn, otherRow));
+                    restLength.push_back(glm::length(restPosition(otherColumn, otherRow, transform) -
+                                                     restPosition(column, row, transform)));
+                }
+            while ((first.size() - batch.begin) % 4 != 0) {
+                first.push_back(count);
+                second.push_back(count);
+                restLength.push_back(0.0f);
+            }
+            batch.end = (int) first.size();
+            batches.push_back(batch);
+            for (int k = batch.begin; k < batch.end; k += 4) {
+                bool next = true;
+                for (int lane = 1; lane < 4; lane++)
+                    next = next && first[k + lane] == first[k] + lane && second[k + lane] == second[k] + lane;
+                contiguous.push_back(next);
+            }
+        };
+        for (int parity = 0; parity < 2; parity++) {
+            addBatch(false, 1, 0, [=](int column, int) { return column % 2 == parity; });
+            addBatch(false, 0, 1, [=](int, int row) { return row % 2 == parity; });
+            addBatch(false, 1, 1, [=](int, int row) { return row % 2 == parity; });
+            addBatch(false, -1, 1, [=](int, int row) { return row % 2 == parity; });
+            addBatch(true, 2, 0, [=](int column, int) { return column / 2 % 2 == parity; });
+            addBatch(true, 0, 2, [=](int, int row) { return row / 2 % 2 == parity; });
+        }
+        updateNormals();
+        updateBounds();
+    }
+
+    int columns() const { return gridColumns; }
+
+    int rows() const { return gridRows; }
+
+    int particleCount() const { return gridColumns * gridRows; }
+
+    int constraintCount() const { return (int) first.size(); }
+
+    // moves the held edge along with the transform
+    void setTransform(const glm::mat4& transform) {
+        for (int row = 0; row < gridRows; row++) {
+            int i = index(0, row);
+            glm::vec3 position = restPosition(0, row, transform);
+            x[i] = previousX[i] = position.x;
+            y[i] = previousY[i] = position.y;
+            z[i] = previousZ[i] = position.z;
+        }
+    }
+
+    // steps of 1 / params.stepRate, the first at the given time
+    void simulate(const ClothParams& params, float time, int steps) {
+        if (steps > 0) {
+            drawnX = x;
+            drawnY = y;
+            drawnZ = z;
+        }
+        float stepTime = 1.0f / params.stepRate;
+        // the stiffness of one iteration that adds up to the one asked for over all of them
+        auto perIteration = [&](float stiffness) {
+            return stiffness >= 1.0f ? 1.0f : 1.0f - std::pow(1.0f - stiffness, 1.0f / (float) params.iterations);
+        };
+        float stretch = perIteration(params.stretchStiffness), bend = perIteration(params.bendStiffness);
+        for (int step = 0; step < steps; step++) {
+            accumulateForces(params, time + step * stepTime, stepTime);
+            if (params.simd)
+                integrateSimd(params, stepTime);
+            else
+                integrateScalar(params, stepTime);
+            for (int iteration = 0; iteration < params.iterations; iteration++)
+                for (const Batch& batch: batches) {
+                    float stiffness = batch.bending ? bend : stretch;
+                    if (params.simd)
+                        solveSimd(batch, stiffness);
+                    else
+                        solveScalar(batch, stiffness);
+                }
+            updateNormals();
+        }
+        updateBounds();
+    }
+
+    // position, normal and the position before the last simulate() of every particle, then all of them again with
+    // the normal turned around for the back
+    void writeVertices(float* out) const {
+        int count = particleCount();
+        for (int side = 0; side < 2; side++) {
+            float sign = side == 0 ? 1.0f : -1.0f;
+            for (int i = 0; i < count; i++) {
+                out[0] = x[i];
+                out[1] = y[i];
+                out[2] = z[i];
+                out[3] = normalX[i] * sign;
+                out[4] = normalY[i] * sign;
+                out[5] = normalZ[i] * sign;
+                out[6] = drawnX[i];
+                out[7] = drawnY[i];
+                out[8] = drawnZ[i];
+                out += 9;
+            }
+        }
+    }
+
+    glm::vec3 position(int column, int row) const {
+        int i = index(column, row);
+        return glm::vec3(x[i], y[i], z[i]);
+    }
+
+    // center and radius of a sphere around the cloth as it was after the last step
+    glm::vec4 bounds() const { return boundingSphere; }
+
+private:
+    struct Batch {
+        int begin, end;
+        bool bending;
+    };
+
+    int gridColumns, gridRows, padded;
+    glm::vec3 corner, across, down;
+    std::vector<float> x, y, z, previousX, previousY, previousZ;
+    // the positions before the steps of the last simulate(), where the frame before drew the cloth
+    std::vector<float> drawnX, drawnY, drawnZ;
+    // acceleration of the current step
+    std::vector<float> forceX, forceY, forceZ;
+    std::vector<float> normalX, normalY, normalZ;
+    // 0 for the held particles and the spare one
+    std::vector<float> inverseMass;
+    std::vector<int> first, second;
+    std::vector<float> restLength;
+    // for every four constraints, whether both of their ends are four particles in a row, which are loaded and
+    // stored whole rather than gathered and scattered
+    std::vector<bool> contiguous;
+    std::vector<Batch> batches;
+    glm::vec4 boundingSphere = glm::vec4(0.0f);
+
+    int index(int column, int row) const { return row * gridColumns + column; }
+
+    glm::vec3 restPosition(int column, int row, const glm::mat4& transform) const {
+        glm::vec3 local = corner + across * ((float) column / (float) (gridColumns - 1)) +
+                          down * ((float) row / (float) (gridRows - 1));
+        return glm::vec3(transform * glm::vec4(local, 1.0f));
+    }
+
+    // gravity and the wind, which only pushes on the cloth as far as it blows across it
+    void accumulateForces(const ClothParams& params, float time, float stepTime) {
+        float windSpeed = glm::length(params.wind);
+        glm::vec3 windDirection = windSpeed > 0.0f ? params.wind / windSpeed : glm::vec3(0.0f);
+        for (int i = 0, count = particleCount(); i < count; i++) {
+            glm::vec3 position(x[i], y[i], z[i]);
+            float along = glm::dot(position, windDirection);
+            float gust = 1.0f + params.gustiness * std::sin(along * 0.9f + position.y * 0.7f - time * 2.3f);
+            glm::vec3 velocity = (position - glm::vec3(previousX[i], previousY[i], previousZ[i])) / stepTime;
+            glm::vec3 normal(normalX[i], normalY[i], normalZ[i]);
+            float crossing = glm::dot(params.wind * gust - velocity, normal);
+            glm::vec3 force = normal * (params.aerodynamics * crossing);
+            forceX[i] = force.x;
+            forceY[i] = force.y - params.gravity;
+            forceZ[i] = force.z;
+        }
+    }
+
+    void integrateScalar(const ClothParams& params, float stepTime) {
+        float keep = 1.0f - params.damping, stepSquared = stepTime * stepTime;
+        for (int i = 0; i < padded; i++) {
+            float nextX = x[i] + ((x[i] - previousX[i]) * keep + forceX[i] * stepSquared) * inverseMass[i];
+            float nextY = y[i] + ((y[i] - previousY[i]) * keep + forceY[i] * stepSquared) * inverseMass[i];
+            float nextZ = z[i] + ((z[i] - previousZ[i]) * keep + forceZ[i] * stepSquared) * inverseMass[i];
+            previousX[i] = x[i];
+            previousY[i] = y[i];
+            previousZ[i] = z[i];
+            x[i] = nextX;
+            y[i] = nextY;
+            z[i] = nextZ;
+        }
+    }
+
+    void integrateSimd(const ClothParams& params, float stepTime) {
+        __m128 keep = _mm_set1_ps(1.0f - params.damping), stepSquared = _mm_set1_ps(stepTime * stepTime);
+        auto axis = [&](float* position, float* previous, const float* force, int i) {
+            __m128 current = _mm_loadu_ps(position + i);
+            __m128 velocity = _mm_mul_ps(_mm_sub_ps(current, _mm_loadu_ps(previous + i)), keep);
+            __m128 move = _mm_add_ps(velocity, _mm_mul_ps(_mm_loadu_ps(force + i), stepSquared));
+            _mm_storeu_ps(previous + i, current);
+            _mm_storeu_ps(position + i, _mm_add_ps(current, _mm_mul_ps(move, _mm_loadu_ps(&inverseMass[i]))));
+        };
+        for (int i = 0; i < padded; i += 4) {
+            axis(&x[0], &previousX[0], &forceX[0], i);
+            axis(&y[0], &previousY[0], &forceY[0], i);
+            axis(&z[0], &previousZ[0], &forceZ[0], i);
+        }
+    }
+
+    void solveScalar(const Batch& batch, float stiffness) {
+        for (int k = batch.begin; k < batch.end; k++) {
+            int a = first[k], b = second[k];
+            float dx = x[b] - x[a], dy = y[b] - y[a], dz = z[b] - z[a];
+            float length = std::sqrt(std::max(dx * dx + dy * dy + dz * dz, 1e-12f));
+            float weights = std::max(inverseMass[a] + inverseMass[b], 1e-12f);
+            float correction = stiffness * (length - restLength[k]) / (length * weights);
+            float moveA = correction * inverseMass[a], moveB = correction * inverseMass[b];
+            x[a] += dx * moveA;
+            y[a] += dy * moveA;
+            z[a] += dz * moveA;
+            x[b] -= dx * moveB;
+            y[b] -= dy * moveB;
+            z[b] -= dz * moveB;
+        }
+    }
+
+    void solveSimd(const Batch& batch, float stiffness) {
+        const __m128 tiny = _mm_set1_ps(1e-12f), strength = _mm_set1_ps(stiffness);
+        // four particles in a row are loaded and stored whole, any others gathered and scattered
+        auto load = [](const std::vector<float>& array, const int* indices, bool whole) {
+            if (whole)
+                return _mm_loadu_ps(&array[indices[0]]);
+            return _mm_setr_ps(array[indices[0]], array[indices[1]], array[indices[2]], array[indices[3]]);
+        };
+        auto store = [](std::vector<float>& array, const int* indices, bool whole, __m128 values) {
+            if (whole) {
+                _mm_storeu_ps(&array[indices[0]], values);
+                return;
+            }
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, values);
+            for (int lane = 0; lane < 4; lane++)
+                array[indices[lane]] = lanes[lane];
+        };
+        for (int k = batch.begin; k < batch.end; k += 4) {
+            const int* a = &first[k];
+            const int* b = &second[k];
+            bool whole = contiguous[k / 4];
+            __m128 ax = load(x, a, whole), ay = load(y, a, whole), az = load(z, a, whole);
+            __m128 bx = load(x, b, whole), by = load(y, b, whole), bz = load(z, b, whole);
+            __m128 weightA = load(inverseMass, a, whole), weightB = load(inverseMass, b, whole);
+            __m128 dx = _mm_sub_ps(bx, ax), dy = _mm_sub_ps(by, ay), dz = _mm_sub_ps(bz, az);
+            __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            __m128 length = _mm_sqrt_ps(_mm_max_ps(lengthSquared, tiny));
+            __m128 weights = _mm_max_ps(_mm_add_ps(weightA, weightB), tiny);
+            __m128 correction = _mm_div_ps(_mm_mul_ps(strength, _mm_sub_ps(length, _mm_loadu_ps(&restLength[k]))),
+                                           _mm_mul_ps(length, weights));
+            __m128 moveA = _mm_mul_ps(correction, weightA), moveB = _mm_mul_ps(correction, weightB);
+            store(x, a, whole, _mm_add_ps(ax, _mm_mul_ps(dx, moveA)));
+            store(y, a, whole, _mm_add_ps(ay, _mm_mul_ps(dy, moveA)));
+            store(z, a, whole, _mm_add_ps(az, _mm_mul_ps(dz, moveA)));
+            store(x, b, whole, _mm_sub_ps(bx, _mm_mul_ps(dx, moveB)));
+            store(y, b, whole, _mm_sub_ps(by, _mm_mul_ps(dy, moveB)));
+            store(z, b, whole, _mm_sub_ps(bz, _mm_mul_ps(dz, moveB)));
+        }
+    }
+
+    // from the neighbours on either side, one sided at the edges; they face the way the front triangles wind
+    void updateNormals() {
+        for (int row = 0; row < gridRows; row++)
+            for (int column = 0; column < gridColumns; column++) {
+                glm::vec3 alongAcross = position(std::min(column + 1, gridColumns - 1), row) -
+                                        position(std::max(column - 1, 0), row);
+                glm::vec3 alongDown = position(column, std::min(row + 1, gridRows - 1)) -
+                                      position(column, std::max(row - 1, 0));
+                glm::vec3 normal = glm::cross(alongDown, alongAcross);
+                float length = glm::length(normal);
+                normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+                int i = index(column, row);
+                normalX[i] = normal.x;
+                normalY[i] = normal.y;
+                normalZ[i] = normal.z;
+            }
+    }
+
+    void updateBounds() {
+        int count = particleCount();
+        glm::vec3 center(0.0f);
+        for (int i = 0; i < count; i++)
+            center += glm::vec3(x[i], y[i], z[i]);
+        center /= (float) count;
+        float radius = 0.0f;
+        for (int i = 0; i < count; i++)
+            radius = std::max(radius, glm::length(glm::vec3(x[i], y[i], z[i]) - center));
+        boundingSphere = glm::vec4(center, radius);
+    }
+};
+
+// Runs every cloth of the scene at a fixed step rate; the cloths are independent and spread over the job pool.
+class ClothSolver {
+public:
+    ClothParams params;
+
+    // how many steps the time since the last frame adds up to
+    int stepsFor(float deltaTime) {
+        pending += deltaTime * params.stepRate;
+        int steps = std::min((int) pending, params.maxSteps);
+        pending = std::min(pending - (float) steps, 1.0f);
+        return steps;
+    }
+
+    void simulate(std::vector<Cloth>& cloths, float time, int steps, JobPool* pool = nullptr) const {
+        auto job = [&](int i) { cloths[i].simulate(params, time, steps); };
+        if (pool)
+            pool->parallelFor((int) cloths.size(), job);
+        else
+            for (int i = 0; i < (int) cloths.size(); i++)
+                job(i);
+    }
+
+private:
+    float pending = 0.0f;
+};
+
+#endif //PROJECT_BASE_CLOTHSIMULATION_H
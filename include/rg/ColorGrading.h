@@ -0,0 +1,113 @@
+#ifndef PROJECT_BASE_COLORGRADING_H
+#define PROJECT_BASE_COLORGRADING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+struct ColorGradingParams {
+    float gamma = 1.4f;
+    float saturation = 1.0f;
+    float contrast = 1.0f;
+    glm::vec3 colorFilter = glm::vec3(1.0f);
+
+    bool operator==(const ColorGradingParams& other) const {
+        return gamma == other.gamma && saturation == other.saturation && contrast == other.contrast &&
+               colorFilter == other.colorFilter;
+    }
+};
+
+// Tonemapping, grading and gamma baked into a SIZE^3 lookup table, so the final pass does one 3D texture fetch
+// instead of evaluating them per pixel. The table is indexed by exposed HDR color encoded as log2 over
+// [MIN_LOG, MAX_LOG], which keeps the steps even in stops. It is rebuilt only when the parameters change.
+class ColorGradingLut {
+public:
+    static const int SIZE = 32;
+    constexpr static const float MIN_LOG = -12.0f;
+    constexpr static const float MAX_LOG = 4.0f;
+
+    ColorGradingLut() {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_3D, texture);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_3D, 0);
+    }
+
+    void destroy() {
+        glDeleteTextures(1, &texture);
+    }
+
+    ColorGradingLut(const ColorGradingLut&) = delete;
+    ColorGradingLut& operator=(const ColorGradingLut&) = delete;
+
+    // rebuilds the table if the parameters differ from the ones it was built with
+    void update(const ColorGradingParams& params) {
+        if (built && params == current)
+            return;
+        current = params;
+        built = true;
+        rebuilds++;
+
+        std::vector<glm::vec3> texels(SIZE * SIZE * SIZE);
+        for (int b = 0; b < SIZE; b++)
+            for (int g = 0; g < SIZE; g++)
+                for (int r = 0; r < SIZE; r++) {
+                    glm::vec3 encoded = glm::vec3(r, g, b) / (float) (SIZE - 1);
+                    texels[(b * SIZE + g) * SIZE + r] = grade(decode(encoded));
+                }
+
+        glBindTexture(GL_TEXTURE_3D, texture);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, SIZE, SIZE, SIZE, 0, GL_RGB, GL_FLOAT, &texels[0]);
+        glBindTexture(GL_TEXTURE_3D, 0);
+    }
+
+    // how many times the table was built, for the debug UI
+    int rebuildCount() const { return rebuilds; }
+
+    void bind(Shader& shader, int textureUnit) const {
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_3D, texture);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("colorLut", textureUnit);
+        shader.setFloat("lutMinLog", MIN_LOG);
+        shader.setFloat("lutLogRange", MAX_LOG - MIN_LOG);
+        shader.setFloat("lutSize", (float) SIZE);
+    }
+
+private:
+    unsigned int texture;
+    ColorGradingParams current;
+    bool built = false;
+    int rebuilds = 0;
+
+    static glm::vec3 decode(glm::vec3 encoded) {
+        return glm::vec3(std::exp2(MIN_LOG + encoded.x * (MAX_LOG - MIN_LOG)),
+                         std::exp2(MIN_LOG + encoded.y * (MAX_LOG - MIN_LOG)),
+                         std::exp2(MIN_LOG + encoded.z * (MAX_LOG - MIN_LOG)));
+    }
+
+    // the same exponential tonemap the final pass used to compute, followed by the grading
+    glm::vec3 grade(glm::vec3 hdr) const {
+        glm::vec3 color = glm::vec3(1.0f - std::exp(-hdr.x), 1.0f - std::exp(-hdr.y), 1.0f - std::exp(-hdr.z));
+        color *= current.colorFilter;
+        float luma = color.x * 0.2126f + color.y * 0.7152f + color.z * 0.0722f;
+        color = glm::vec3(luma) + (color - glm::vec3(luma)) * current.saturation;
+        glm::vec3 result;
+        for (int i = 0; i < 3; i++) {
+            float c = std::pow(std::max(color[i], 0.0f), 1.0f / current.gamma);
+            result[i] = std::min(std::max((c - 0.5f) * current.contrast + 0.5f, 0.0f), 1.0f);
+        }
+        return result;
+    }
+};
+
+#endif //PROJECT_BASE_COLORGRADING_H
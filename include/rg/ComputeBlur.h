@@ -0,0 +1,126 @@
+#ifndef PROJECT_BASE_COMPUTEBLUR_H
+#define PROJECT_BASE_COMPUTEBLUR_H
+
+#include <glad/glad.h>
+
+#include <common.h>
+#include <learnopengl/shader.h>
+#include <rg/GaussianKernel.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+// what glad, generated for GL 3.3, doesn't have of GL 4.3
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_FRAMEBUFFER_BARRIER_BIT
+#define GL_FRAMEBUFFER_BARRIER_BIT 0x00000400
+#endif
+
+// One direction of a separable Gaussian blur in a compute shader (blurCompute.cs). A work group blurs a run of
+// TILE pixels of a row or a column: it fetches the run and the kernel's radius on either side into shared memory,
+// every texel once and thresholded on its own in the bright pass, and each pixel then sums its taps from there.
+// That is (TILE + 2r) / TILE fetches per pixel and direction, against 2 ceil(r / 2) + 1 bilinear ones in the
+// fragment blur. It needs a GL 4.3 context, whose entry points are loaded here; when the context is older,
+// available() is false and the fragment blur (blurShader.fs) is the fallback.
+class ComputeBlur {
+public:
+    // must match local_size_x in blurCompute.cs
+    static const int TILE = 128;
+
+    // loader is the one glad was loaded with
+    explicit ComputeBlur(GLADloadproc loader) {
+        if (GLVersion.major < 4 || (GLVersion.major == 4 && GLVersion.minor < 3))
+            return;
+        dispatchCompute = (DispatchComputeProc) loader("glDispatchCompute");
+        bindImageTexture = (BindImageTextureProc) loader("glBindImageTexture");
+        memoryBarrier = (MemoryBarrierProc) loader("glMemoryBarrier");
+        if (dispatchCompute && bindImageTexture && memoryBarrier)
+            shaderSource = readFileContents("resources/shaders/blurCompute.cs");
+    }
+
+    void destroy() {
+        for (auto& program: programs)
+            glDeleteProgram(program.second.shader->ID);
+        programs.clear();
+    }
+
+    ComputeBlur(const ComputeBlur&) = delete;
+    ComputeBlur& operator=(const ComputeBlur&) = delete;
+
+    bool available() const { return !shaderSource.empty(); }
+
+    void setKernel(const GaussianKernel& newKernel) {
+        kernel.reset(new GaussianKernel(newKernel));
+        kernelVersion++;
+    }
+
+    // texture fetches per pixel of both directions
+    float fetches() const {
+        int radius = kernel ? kernel->radius() : 0;
+        return 2.0f * (float) (TILE + 2 * radius) / (float) TILE;
+    }
+
+    // blurs source into target, both width x height and target of the given format; with brightPass, only what is
+    // brighter than threshold
+    void blur(unsigned int source, unsigned int target, int width, int height, GLenum format, bool horizontal,
+              bool brightPass, float threshold) {
+        Program& program = programFor(format);
+        Shader& shader = *program.shader;
+        shader.use();
+        if (program.kernelVersion != kernelVersion && kernel) {
+            kernel->setTexels(shader);
+            program.kernelVersion = kernelVersion;
+        }
+        shader.setBool("horizontal", horizontal);
+        shader.setBool("brightPass", brightPass);
+        shader.setFloat("threshold", threshold);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, source);
+        bindImageTexture(0, target, 0, GL_FALSE, 0, GL_WRITE_ONLY, format);
+        int extent = horizontal ? width : height;
+        dispatchCompute((GLuint) ((extent + TILE - 1) / TILE), (GLuint) (horizontal ? height : width), 1);
+        // whatever comes next samples the result or renders into the texture
+        memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+    }
+
+private:
+    typedef void (APIENTRYP DispatchComputeProc)(GLuint, GLuint, GLuint);
+    typedef void (APIENTRYP BindImageTextureProc)(GLuint, GLuint, GLint, GLboolean, GLint, GLenum, GLenum);
+    typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield);
+
+    struct Program {
+        std::unique_ptr<Shader> shader;
+        int kernelVersion;
+    };
+
+    DispatchComputeProc dispatchCompute = nullptr;
+    BindImageTextureProc bindImageTexture = nullptr;
+    MemoryBarrierProc memoryBarrier = nullptr;
+    std::string shaderSource;
+    // the format of the image is part of the shader, a program for each format the bloom target had
+    std::map<GLenum, Program> programs;
+    std::unique_ptr<GaussianKernel> kernel;
+    int kernelVersion = 0;
+
+    Program& programFor(GLenum format) {
+        auto found = programs.find(format);
+        if (found != programs.end())
+            return found->second;
+        std::string imageFormat = format == GL_R11F_G11F_B10F ? "r11f_g11f_b10f" : "rgba16f";
+        size_t lineEnd = shaderSource.find('\n');
+        std::string code = shaderSource.substr(0, lineEnd + 1) + "#define IMAGE_FORMAT " + imageFormat + "\n" +
+                           shaderSource.substr(lineEnd + 1);
+        Program program;
+        program.shader.reset(new Shader(Shader::Compute(code)));
+        program.kernelVersion = -1;
+        return programs.emplace(format, std::move(program)).first->second;
+    }
+};
+
+#endif //PROJECT_BASE_COMPUTEBLUR_H
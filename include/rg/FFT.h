@@ -0,0 +1,195 @@
+#ifndef PROJECT_BASE_FFT_H
+#define PROJECT_BASE_FFT_H
+
+#include <rg/JobPool.h>
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Complex 2D FFT of a square, power of two sized grid, kept as separate planes of real and imaginary parts.
+// Lines are transformed with a Stockham autosort FFT (radix-4 stages, and one radix-2 stage when the size is not a
+// power of 4), so no bit reversal pass is needed. The grid is worked on in blocks of BLOCK lines: a block is copied
+// into a small buffer with the lines side by side, transformed there with every butterfly computed for four lines at
+// once with SSE, and copied back. The small buffer keeps the strided accesses of the butterflies in the cache, and
+// the blocks are independent, so they are split over the job pool. The columns are done first, then the rows, whose
+// blocks are transposed on the way in and out.
+// The size has to be at least 4. Neither direction is normalized: a forward and an inverse transform multiply the grid
+// by size * size.
+class FFT2D {
+public:
+    // lines per block, a multiple of the SSE width
+    static const int BLOCK = 16;
+
+    explicit FFT2D(int size) : n(size), width(std::min(size, BLOCK)), scratch(4 * size * size) {
+        const double pi = std::acos(-1.0);
+        for (int direction = 0; direction < 2; direction++) {
+            float sign = direction == 0 ? -1.0f : 1.0f;
+            for (int length = n; length > 1; length /= (length >= 4 ? 4 : 2)) {
+                Stage stage;
+                stage.length = length;
+                stage.radix = length >= 4 ? 4 : 2;
+                int quarter = length / stage.radix;
+                for (int p = 0; p < quarter; p++)
+                    for (int power = 1; power < stage.radix; power++) {
+                        double angle = sign * 2.0 * pi * (double) (p * power) / (double) length;
+                        stage.twiddleRe.push_back((float) std::cos(angle));
+                        stage.twiddleIm.push_back((float) std::sin(angle));
+                    }
+                stages[direction].push_back(stage);
+            }
+        }
+    }
+
+    int size() const { return n; }
+
+    // transforms the grid in place; re and im hold size * size floats each
+    void transform(float* re, float* im, bool inverse, JobPool* pool = nullptr) {
+        const std::vector<Stage>& plan = stages[inverse ? 1 : 0];
+        int blocks = n / width;
+        auto run = [&](const std::function<void(int)>& job) {
+            if (pool)
+                pool->parallelFor(blocks, job);
+            else
+                for (int i = 0; i < blocks; i++)
+                    job(i);
+        };
+
+        run([&](int block) {
+            float* local = &scratch[(size_t) block * 4 * n * width];
+            int x0 = block * width;
+            for (int y = 0; y < n; y++) {
+                std::memcpy(local + y * width, re + y * n + x0, width * sizeof(float));
+                std::memcpy(local + (n + y) * width, im + y * n + x0, width * sizeof(float));
+            }
+            lines(plan, local, inverse);
+            for (int y = 0; y < n; y++) {
+                std::memcpy(re + y * n + x0, local + y * width, width * sizeof(float));
+                std::memcpy(im + y * n + x0, local + (n + y) * width, width * sizeof(float));
+            }
+        });
+        run([&](int block) {
+            float* local = &scratch[(size_t) block * 4 * n * width];
+            int y0 = block * width;
+            for (int line = 0; line < width; line++)
+                for (int x = 0; x < n; x++) {
+                    local[x * width + line] = re[(y0 + line) * n + x];
+                    local[(n + x) * width + line] = im[(y0 + line) * n + x];
+                }
+            lines(plan, local, inverse);
+            for (int line = 0; line < width; line++)
+                for (int x = 0; x < n; x++) {
+                    re[(y0 + line) * n + x] = local[x * width + line];
+                    im[(y0 + line) * n + x] = local[(n + x) * width + line];
+                }
+        });
+    }
+
+    // floating point operations of one 2D transform by the usual 5 n log2(n) count per 1D transform
+    double flops() const {
+        return 2.0 * n * 5.0 * n * std::log2((double) n);
+    }
+
+private:
+    struct Stage {
+        int length;
+        int radix;
+        // w^1 .. w^(radix - 1) for every p
+        std::vector<float> twiddleRe, twiddleIm;
+    };
+
+    int n;
+    // lines per block, BLOCK unless the grid is smaller
+    int width;
+    std::vector<Stage> stages[2];
+    // four planes of size * width per block: real and imaginary part, and the same again to ping-pong with
+    std::vector<float> scratch;
+
+    // transforms the block at local: the real parts of its lines, size * width floats with element k of line l at
+    // k * width + l, followed by the imaginary parts and room for two more planes
+    void lines(const std::vector<Stage>& plan, float* local, bool inverse) const {
+        float* fromRe = local;
+        float* fromIm = local + n * width;
+        float* toRe = local + 2 * n * width;
+        float* toIm = local + 3 * n * width;
+        int stride = 1;
+        for (const Stage& stage: plan) {
+            if (stage.radix == 4)
+                radix4(stage, stride, fromRe, fromIm, toRe, toIm, inverse);
+            else
+                radix2(stage, stride, fromRe, fromIm, toRe, toIm);
+            stride *= stage.radix;
+            std::swap(fromRe, toRe);
+            std::swap(fromIm, toIm);
+        }
+        if (fromRe != local) {
+            std::memcpy(local, fromRe, n * width * sizeof(float));
+            std::memcpy(local + n * width, fromIm, n * width * sizeof(float));
+        }
+    }
+
+    // y[q + s (4p + j)] from x[q + s (p + j m)], with m = length / 4 and s the stride, four lines at a time
+    void radix4(const Stage& stage, int s, const float* xRe, const float* xIm, float* yRe, float* yIm,
+                bool inverse) const {
+        int m = stage.length / 4;
+        // the forward transform turns b - d by -i, the inverse by +i
+        const __m128 sign = _mm_set1_ps(inverse ? 1.0f : -1.0f);
+        for (int p = 0; p < m; p++) {
+            const __m128 w1Re = _mm_set1_ps(stage.twiddleRe[3 * p]), w1Im = _mm_set1_ps(stage.twiddleIm[3 * p]);
+            const __m128 w2Re = _mm_set1_ps(stage.twiddleRe[3 * p + 1]), w2Im = _mm_set1_ps(stage.twiddleIm[3 * p + 1]);
+            const __m128 w3Re = _mm_set1_ps(stage.twiddleRe[3 * p + 2]), w3Im = _mm_set1_ps(stage.twiddleIm[3 * p + 2]);
+            for (int q = 0; q < s; q++) {
+                int a = (q + s * p) * width, b = a + s * m * width, c = b + s * m * width, d = c + s * m * width;
+                int y0 = (q + s * 4 * p) * width, y1 = y0 + s * width, y2 = y1 + s * width, y3 = y2 + s * width;
+                for (int l = 0; l < width; l += 4) {
+                    __m128 aRe = _mm_load_ps(xRe + a + l), aIm = _mm_load_ps(xIm + a + l);
+                    __m128 bRe = _mm_load_ps(xRe + b + l), bIm = _mm_load_ps(xIm + b + l);
+                    __m128 cRe = _mm_load_ps(xRe + c + l), cIm = _mm_load_ps(xIm + c + l);
+                    __m128 dRe = _mm_load_ps(xRe + d + l), dIm = _mm_load_ps(xIm + d + l);
+                    __m128 apcRe = _mm_add_ps(aRe, cRe), apcIm = _mm_add_ps(aIm, cIm);
+                    __m128 amcRe = _mm_sub_ps(aRe, cRe), amcIm = _mm_sub_ps(aIm, cIm);
+                    __m128 bpdRe = _mm_add_ps(bRe, dRe), bpdIm = _mm_add_ps(bIm, dIm);
+                    // (b - d) turned by a quarter
+                    __m128 jbmdRe = _mm_mul_ps(sign, _mm_sub_ps(dIm, bIm));
+                    __m128 jbmdIm = _mm_mul_ps(sign, _mm_sub_ps(bRe, dRe));
+
+                    _mm_store_ps(yRe + y0 + l, _mm_add_ps(apcRe, bpdRe));
+                    _mm_store_ps(yIm + y0 + l, _mm_add_ps(apcIm, bpdIm));
+                    multiply(_mm_add_ps(amcRe, jbmdRe), _mm_add_ps(amcIm, jbmdIm), w1Re, w1Im, yRe + y1 + l, yIm + y1 + l);
+                    multiply(_mm_sub_ps(apcRe, bpdRe), _mm_sub_ps(apcIm, bpdIm), w2Re, w2Im, yRe + y2 + l, yIm + y2 + l);
+                    multiply(_mm_sub_ps(amcRe, jbmdRe), _mm_sub_ps(amcIm, jbmdIm), w3Re, w3Im, yRe + y3 + l, yIm + y3 + l);
+                }
+            }
+        }
+    }
+
+    void radix2(const Stage& stage, int s, const float* xRe, const float* xIm, float* yRe, float* yIm) const {
+        int m = stage.length / 2;
+        for (int p = 0; p < m; p++) {
+            const __m128 wRe = _mm_set1_ps(stage.twiddleRe[p]), wIm = _mm_set1_ps(stage.twiddleIm[p]);
+            for (int q = 0; q < s; q++) {
+                int a = (q + s * p) * width, b = a + s * m * width;
+                int y0 = (q + s * 2 * p) * width, y1 = y0 + s * width;
+                for (int l = 0; l < width; l += 4) {
+                    __m128 aRe = _mm_load_ps(xRe + a + l), aIm = _mm_load_ps(xIm + a + l);
+                    __m128 bRe = _mm_load_ps(xRe + b + l), bIm = _mm_load_ps(xIm + b + l);
+                    _mm_store_ps(yRe + y0 + l, _mm_add_ps(aRe, bRe));
+                    _mm_store_ps(yIm + y0 + l, _mm_add_ps(aIm, bIm));
+                    multiply(_mm_sub_ps(aRe, bRe), _mm_sub_ps(aIm, bIm), wRe, wIm, yRe + y1 + l, yIm + y1 + l);
+                }
+            }
+        }
+    }
+
+    static void multiply(__m128 re, __m128 im, __m128 wRe, __m128 wIm, float* outRe, float* outIm) {
+        _mm_store_ps(outRe, _mm_sub_ps(_mm_mul_ps(re, wRe), _mm_mul_ps(im, wIm)));
+        _mm_store_ps(outIm, _mm_add_ps(_mm_mul_ps(re, wIm), _mm_mul_ps(im, wRe)));
+    }
+};
+
+#endif //PROJECT_BASE_FFT_H
@@ -0,0 +1,417 @@
+#ifndef PROJECT_BASE_FRAMEGRAPH_H
+#define PROJECT_BASE_FRAMEGRAPH_H
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// size of a texel in video memory; 24 bit depth is padded to 32 bits by every driver that matters
+inline size_t bytesPerTexel(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_RGBA32F: return 16;
+        case GL_RGBA16F: return 8;
+        case GL_RGB16F: return 6;
+        case GL_R16F:
+        case GL_DEPTH_COMPONENT16: return 2;
+        case GL_R8: return 1;
+        // GL_R11F_G11F_B10F, GL_RGBA8, GL_SRGB8_ALPHA8, GL_RG16F, GL_R32F, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT32F
+        default: return 4;
+    }
+}
+
+struct RenderTargetDesc {
+    int width;
+    int height;
+    GLenum internalFormat;
+
+    bool operator==(const RenderTargetDesc& other) const {
+        return width == other.width && height == other.height && internalFormat == other.internalFormat;
+    }
+
+    size_t bytes() const { return (size_t) width * height * bytesPerTexel(internalFormat); }
+};
+
+// The textures frame graph passes render into. A texture is allocated once with a fixed size and format and never
+// respecified: a new window size simply asks for other textures, and the ones nobody asked for during the last
+// EVICT_AFTER_FRAMES frames are freed. Textures released during a frame can be handed out again in the same frame,
+// which is how passes that don't overlap end up sharing memory.
+class RenderTargetPool {
+public:
+    static const int EVICT_AFTER_FRAMES = 3;
+
+    RenderTargetPool() = default;
+
+    void destroy() {
+        for (Framebuffer& framebuffer: framebuffers)
+            glDeleteFramebuffers(1, &framebuffer.FBO);
+        framebuffers.clear();
+        for (Entry& entry: entries)
+            glDeleteTextures(1, &entry.texture);
+        entries.clear();
+    }
+
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    unsigned int acquire(const RenderTargetDesc& desc) {
+        for (Entry& entry: entries)
+            if (!entry.inUse && entry.desc == desc) {
+                entry.inUse = true;
+                entry.lastUsed = frame;
+                return entry.texture;
+            }
+
+        Entry entry;
+        entry.desc = desc;
+        entry.inUse = true;
+        entry.lastUsed = frame;
+        bool depth = isDepthFormat(desc.internalFormat);
+        glGenTextures(1, &entry.texture);
+        glBindTexture(GL_TEXTURE_2D, entry.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0,
+                     depth ? GL_DEPTH_COMPONENT : GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        entries.push_back(entry);
+        return entry.texture;
+    }
+
+    void release(unsigned int texture) {
+        for (Entry& entry: entries)
+            if (entry.texture == texture)
+                entry.inUse = false;
+    }
+
+    // a framebuffer with the given attachments, created the first time they are rendered to together
+    unsigned int framebuffer(const std::vector<unsigned int>& colors, unsigned int depth) {
+        for (Framebuffer& framebuffer: framebuffers)
+            if (framebuffer.colors == colors && framebuffer.depth == depth)
+                return framebuffer.FBO;
+
+        Framebuffer framebuffer;
+        framebuffer.colors = colors;
+        framebuffer.depth = depth;
+        glGenFramebuffers(1, &framebuffer.FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.FBO);
+        std::vector<GLenum> attachments;
+        for (size_t i = 0; i < colors.size(); i++) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colors[i], 0);
+            attachments.push_back(GL_COLOR_ATTACHMENT0 + i);
+        }
+        if (depth != 0)
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+        if (attachments.empty())
+            glDrawBuffer(GL_NONE);
+        else
+            glDrawBuffers((GLsizei) attachments.size(), &attachments[0]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Framebuffer not complete!" << std::endl;
+        framebuffers.push_back(framebuffer);
+        return framebuffer.FBO;
+    }
+
+    // frees what went unused for too long, together with the framebuffers it was attached to
+    void endFrame() {
+        for (size_t i = 0; i < entries.size();) {
+            if (!entries[i].inUse && frame - entries[i].lastUsed >= EVICT_AFTER_FRAMES) {
+                forgetFramebuffers(entries[i].texture);
+                glDeleteTextures(1, &entries[i].texture);
+                entries[i] = entries.back();
+                entries.pop_back();
+            } else {
+                i++;
+            }
+        }
+        frame++;
+    }
+
+    int textureCount() const { return (int) entries.size(); }
+
+    size_t bytes() const {
+        size_t total = 0;
+        for (const Entry& entry: entries)
+            total += entry.desc.bytes();
+        return total;
+    }
+
+private:
+    struct Entry {
+        unsigned int texture;
+        RenderTargetDesc desc;
+        bool inUse;
+        unsigned long long lastUsed;
+    };
+
+    struct Framebuffer {
+        unsigned int FBO;
+        std::vector<unsigned int> colors;
+        unsigned int depth;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<Framebuffer> framebuffers;
+    unsigned long long frame = 0;
+
+    void forgetFramebuffers(unsigned int texture) {
+        for (size_t i = 0; i < framebuffers.size();) {
+            bool attached = framebuffers[i].depth == texture;
+            for (unsigned int color: framebuffers[i].colors)
+                attached = attached || color == texture;
+            if (attached) {
+                glDeleteFramebuffers(1, &framebuffers[i].FBO);
+                framebuffers[i] = framebuffers.back();
+                framebuffers.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+
+    static bool isDepthFormat(GLenum internalFormat) {
+        return internalFormat == GL_DEPTH_COMPONENT16 || internalFormat == GL_DEPTH_COMPONENT24 ||
+               internalFormat == GL_DEPTH_COMPONENT32F || internalFormat == GL_DEPTH_COMPONENT;
+    }
+};
+
+typedef int FrameResource;
+const FrameResource NO_FRAME_RESOURCE = -1;
+
+// The passes of one frame and the render targets they read and write, rebuilt every frame.
+// Passes are run in the order they were added. A pass whose results nobody reads is culled, unless it is kept for
+// its side effects (drawing to the window, say). Transient targets get a texture from the pool right before their
+// first pass and give it back after their last one.
+// Every pass is charged the bytes of the targets it reads and writes, as if each texel went through memory once. That
+// ignores overdraw, filter taps and caches, but it is what changes when targets get smaller or their formats narrower.
+class FrameGraph {
+public:
+    class Context;
+
+    // estimated framebuffer traffic of an executed pass
+    struct PassTraffic {
+        std::string name;
+        size_t bytesRead;
+        size_t bytesWritten;
+    };
+
+    class Pass {
+    public:
+        // a new target this pass renders into first
+        FrameResource create(const std::string& name, const RenderTargetDesc& desc) {
+            FrameResource resource = graph->addResource(name, desc, 0);
+            write(resource);
+            return resource;
+        }
+
+        FrameResource write(FrameResource resource) {
+            writes.push_back(resource);
+            return resource;
+        }
+
+        FrameResource read(FrameResource resource) {
+            reads.push_back(resource);
+            return resource;
+        }
+
+        // never culled
+        void keep() { sideEffects = true; }
+
+    private:
+        friend class FrameGraph;
+        FrameGraph* graph;
+        std::string name;
+        std::function<void(Context&)> execute;
+        std::vector<FrameResource> reads;
+        std::vector<FrameResource> writes;
+        bool sideEffects = false;
+        int references = 0;
+    };
+
+    // what a running pass sees of the graph
+    class Context {
+    public:
+        unsigned int texture(FrameResource resource) const {
+            return graph->resources[resource].texture;
+        }
+
+        const RenderTargetDesc& desc(FrameResource resource) const {
+            return graph->resources[resource].desc;
+        }
+
+        // binds a framebuffer with the given targets and sets the viewport to their size;
+        // no colors and no depth binds the window
+        void bindTarget(const std::vector<FrameResource>& colors, FrameResource depth = NO_FRAME_RESOURCE) const {
+            if (colors.empty() && depth == NO_FRAME_RESOURCE) {
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glViewport(0, 0, graph->windowWidth, graph->windowHeight);
+                return;
+            }
+            std::vector<unsigned int> textures;
+            for (FrameResource color: colors)
+                textures.push_back(texture(color));
+            glBindFramebuffer(GL_FRAMEBUFFER, graph->pool->framebuffer(textures, depth == NO_FRAME_RESOURCE ? 0 : texture(depth)));
+            const RenderTargetDesc& size = desc(colors.empty() ? depth : colors[0]);
+            glViewport(0, 0, size.width, size.height);
+        }
+
+        // charges the running pass for traffic the graph can't see, to targets the pass keeps to itself
+        void traffic(size_t bytesRead, size_t bytesWritten) const {
+            current->bytesRead += bytesRead;
+            current->bytesWritten += bytesWritten;
+        }
+
+    private:
+        friend class FrameGraph;
+        FrameGraph* graph;
+        PassTraffic* current;
+    };
+
+    // the size of the window, what Context::bindTarget() uses for the default framebuffer
+    void setWindowSize(int width, int height) {
+        windowWidth = width;
+        windowHeight = height;
+    }
+
+    Pass& addPass(const std::string& name, const std::function<void(Context&)>& execute) {
+        passes.emplace_back(new Pass());
+        Pass& pass = *passes.back();
+        pass.graph = this;
+        pass.name = name;
+        pass.execute = execute;
+        return pass;
+    }
+
+    // a texture owned by someone else, it is never given back to the pool
+    FrameResource import(const std::string& name, unsigned int texture, const RenderTargetDesc& desc) {
+        return addResource(name, desc, texture);
+    }
+
+    // culls, runs the passes that are left and starts over with an empty graph
+    void execute(RenderTargetPool& targetPool) {
+        pool = &targetPool;
+        cull();
+
+        std::vector<int> firstUse(resources.size(), -1), lastUse(resources.size(), -1);
+        for (int p = 0; p < (int) passes.size(); p++) {
+            if (passes[p]->references == 0 && !passes[p]->sideEffects)
+                continue;
+            for (const std::vector<FrameResource>* list: {&passes[p]->writes, &passes[p]->reads})
+                for (FrameResource resource: *list) {
+                    if (firstUse[resource] < 0)
+                        firstUse[resource] = p;
+                    lastUse[resource] = p;
+                }
+        }
+
+        Context context;
+        context.graph = this;
+        lastExecuted.clear();
+        lastCulled.clear();
+        lastTraffic.clear();
+        for (int p = 0; p < (int) passes.size(); p++) {
+            Pass& pass = *passes[p];
+            if (pass.references == 0 && !pass.sideEffects) {
+                lastCulled.push_back(pass.name);
+                continue;
+            }
+            for (size_t r = 0; r < resources.size(); r++)
+                if (firstUse[r] == p && !resources[r].imported)
+                    resources[r].texture = pool->acquire(resources[r].desc);
+            PassTraffic traffic = {pass.name, 0, 0};
+            for (FrameResource resource: pass.reads)
+                traffic.bytesRead += resources[resource].desc.bytes();
+            for (FrameResource resource: pass.writes)
+                traffic.bytesWritten += resources[resource].desc.bytes();
+            context.current = &traffic;
+            pass.execute(context);
+            lastExecuted.push_back(pass.name);
+            lastTraffic.push_back(traffic);
+            for (size_t r = 0; r < resources.size(); r++)
+                if (lastUse[r] == p && !resources[r].imported)
+                    pool->release(resources[r].texture);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        pool->endFrame();
+        passes.clear();
+        resources.clear();
+    }
+
+    // names of the passes the last execute() ran and culled
+    const std::vector<std::string>& executedPasses() const { return lastExecuted; }
+    const std::vector<std::string>& culledPasses() const { return lastCulled; }
+
+    // traffic of the passes the last execute() ran, and its sum
+    const std::vector<PassTraffic>& passTraffic() const { return lastTraffic; }
+
+    size_t trafficBytes() const {
+        size_t total = 0;
+        for (const PassTraffic& traffic: lastTraffic)
+            total += traffic.bytesRead + traffic.bytesWritten;
+        return total;
+    }
+
+private:
+    struct Resource {
+        std::string name;
+        RenderTargetDesc desc;
+        unsigned int texture;
+        bool imported;
+        int references;
+    };
+
+    std::vector<std::unique_ptr<Pass>> passes;
+    std::vector<Resource> resources;
+    RenderTargetPool* pool = nullptr;
+    int windowWidth = 0, windowHeight = 0;
+    std::vector<std::string> lastExecuted;
+    std::vector<std::string> lastCulled;
+    std::vector<PassTraffic> lastTraffic;
+
+    FrameResource addResource(const std::string& name, const RenderTargetDesc& desc, unsigned int texture) {
+        Resource resource;
+        resource.name = name;
+        resource.desc = desc;
+        resource.texture = texture;
+        resource.imported = texture != 0;
+        resource.references = 0;
+        resources.push_back(resource);
+        return (FrameResource) resources.size() - 1;
+    }
+
+    // a pass is referenced by the resources it writes that somebody reads; passes without references are culled,
+    // which in turn may leave the resources they read unreferenced
+    void cull() {
+        for (auto& pass: passes) {
+            pass->references = (int) pass->writes.size();
+            for (FrameResource resource: pass->reads)
+                resources[resource].references++;
+        }
+        std::vector<FrameResource> unreferenced;
+        for (size_t r = 0; r < resources.size(); r++)
+            if (resources[r].references == 0)
+                unreferenced.push_back((FrameResource) r);
+        while (!unreferenced.empty()) {
+            FrameResource resource = unreferenced.back();
+            unreferenced.pop_back();
+            for (auto& pass: passes) {
+                bool writes = false;
+                for (FrameResource written: pass->writes)
+                    writes = writes || written == resource;
+                if (!writes || pass->sideEffects || --pass->references > 0)
+                    continue;
+                for (FrameResource read: pass->reads)
+                    if (--resources[read].references == 0)
+                        unreferenced.push_back(read);
+            }
+        }
+    }
+};
+
+#endif //PROJECT_BASE_FRAMEGRAPH_H
@@ -0,0 +1,71 @@
+#ifndef PROJECT_BASE_GAUSSIANKERNEL_H
+#define PROJECT_BASE_GAUSSIANKERNEL_H
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// One dimension of a Gaussian blur with the given sigma, prepared for linear sampling: two neighbouring texels are
+// read by a single bilinear fetch placed between them in proportion to their weights, so a kernel of radius r
+// needs 1 + ceil(r / 2) fetches instead of 2r + 1. Tap 0 is the center, every other tap is read on both sides.
+// The weights of the single texels are kept too, for the compute blur, which reads texels out of shared memory.
+struct GaussianKernel {
+    // must match MAX_TAPS in blurShader.fs
+    static const int MAX_TAPS = 16;
+    // must match MAX_RADIUS in blurCompute.cs
+    static const int MAX_RADIUS = 2 * (MAX_TAPS - 1);
+
+    std::vector<float> offsets;
+    std::vector<float> weights;
+    // texel i to either side of the center, from 0 to the radius
+    std::vector<float> texelWeights;
+
+    explicit GaussianKernel(float sigma) {
+        sigma = std::max(sigma, 0.1f);
+        int radius = std::min((int) std::ceil(3.0f * sigma), MAX_RADIUS);
+        std::vector<float> texel(radius + 1);
+        float sum = 0.0f;
+        for (int i = 0; i <= radius; i++) {
+            texel[i] = std::exp(-(float) (i * i) / (2.0f * sigma * sigma));
+            sum += i == 0 ? texel[i] : 2.0f * texel[i];
+        }
+        for (float& w: texel)
+            w /= sum;
+        texelWeights = texel;
+
+        offsets.push_back(0.0f);
+        weights.push_back(texel[0]);
+        for (int i = 1; i <= radius; i += 2) {
+            float a = texel[i];
+            float b = i + 1 <= radius ? texel[i + 1] : 0.0f;
+            offsets.push_back(((float) i * a + (float) (i + 1) * b) / (a + b));
+            weights.push_back(a + b);
+        }
+    }
+
+    int taps() const { return (int) offsets.size(); }
+
+    // texture fetches per pixel and direction
+    int fetches() const { return 2 * taps() - 1; }
+
+    int radius() const { return (int) texelWeights.size() - 1; }
+
+    void set(Shader& shader) const {
+        shader.setInt("taps", taps());
+        for (int i = 0; i < taps(); i++) {
+            shader.setFloat("offsets[" + std::to_string(i) + "]", offsets[i]);
+            shader.setFloat("weights[" + std::to_string(i) + "]", weights[i]);
+        }
+    }
+
+    void setTexels(Shader& shader) const {
+        shader.setInt("radius", radius());
+        for (int i = 0; i <= radius(); i++)
+            shader.setFloat("weights[" + std::to_string(i) + "]", texelWeights[i]);
+    }
+};
+
+#endif //PROJECT_BASE_GAUSSIANKERNEL_H
@@ -0,0 +1,67 @@
+#ifndef PROJECT_BASE_GPUTIMER_H
+#define PROJECT_BASE_GPUTIMER_H
+
+#include <glad/glad.h>
+
+// Measures GPU time spent between begin() and end() without ever stalling the CPU.
+// Timestamp queries (instead of GL_TIME_ELAPSED) are used so that timers may overlap,
+// and results are only collected once the query slot comes around again, LATENCY frames later.
+class GpuTimer {
+public:
+    static const int LATENCY = 4;
+
+    GpuTimer() {
+        glGenQueries(2 * LATENCY, queries);
+        for (int i = 0; i < LATENCY; i++)
+            issued[i] = false;
+    }
+
+    void destroy() {
+        glDeleteQueries(2 * LATENCY, queries);
+    }
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void begin() {
+        collect();
+        glQueryCounter(queries[2 * current], GL_TIMESTAMP);
+    }
+
+    void end() {
+        glQueryCounter(queries[2 * current + 1], GL_TIMESTAMP);
+        issued[current] = true;
+        current = (current + 1) % LATENCY;
+    }
+
+    // last measured time
+    float milliseconds() const { return lastMs; }
+    // exponentially smoothed time, better suited for displaying and for budgets
+    float averageMilliseconds() const { return averageMs; }
+
+private:
+    GLuint queries[2 * LATENCY];
+    bool issued[LATENCY];
+    int current = 0;
+    float lastMs = 0.0f;
+    float averageMs = 0.0f;
+
+    void collect() {
+        if (!issued[current])
+            return;
+        issued[current] = false;
+
+        GLint available = 0;
+        glGetQueryObjectiv(queries[2 * current + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return; // drop the sample rather than wait for it
+
+        GLuint64 start, stop;
+        glGetQueryObjectui64v(queries[2 * current], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[2 * current + 1], GL_QUERY_RESULT, &stop);
+        lastMs = (float) (stop - start) / 1000000.0f;
+        averageMs = averageMs == 0.0f ? lastMs : averageMs * 0.9f + lastMs * 0.1f;
+    }
+};
+
+#endif //PROJECT_BASE_GPUTIMER_H
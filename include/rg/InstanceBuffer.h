@@ -0,0 +1,176 @@
+#ifndef PROJECT_BASE_INSTANCEBUFFER_H
+#define PROJECT_BASE_INSTANCEBUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Instances of a model drawn with one call, each read by the vertex shader (the INSTANCED variant of a shader,
+// placed by instanceAnimation.glsl) from attributes 6 to 10. An instance is either static, its model matrix stored
+// as it is, or animated: the shader moves it along a closed spline by the time uniform, so nothing about it is
+// computed or uploaded after it is created. The two are told apart by the w of the first column, which is 0 in
+// every model matrix and the spline plus one in an animation.
+
+// closed loops to follow, xz in units of an instance's radius around its center and y in world units above it
+enum InstanceSpline {
+    // the unit circle
+    SPLINE_CIRCLE,
+    // a landing circuit: a descent along -z onto the water at the center, a run on it, a climb and a turn back
+    SPLINE_LANDING,
+    SPLINE_COUNT
+};
+
+// the size of splinePoints in the shader, which also has room for SPLINE_COUNT splines
+const int MAX_SPLINE_POINTS = 32;
+
+struct InstanceAnimation {
+    glm::vec3 center;
+    float radius;
+    // in loops, where on the spline the instance is at time 0
+    float phase;
+    // in loops per second, negative to fly the loop the other way
+    float speed;
+    InstanceSpline spline;
+    float scale;
+};
+
+struct InstanceData {
+    // the model matrix of a static instance, the animation of an animated one
+    glm::vec4 transform[4];
+    // rectangle of a static instance in the lightmap atlas, xy scale and zw offset
+    glm::vec4 lightmapScaleOffset;
+};
+
+inline InstanceData staticInstance(const glm::mat4& transform,
+                                   const glm::vec4& lightmapScaleOffset = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f)) {
+    return {{transform[0], transform[1], transform[2], transform[3]}, lightmapScaleOffset};
+}
+
+inline InstanceData animatedInstance(const InstanceAnimation& animation) {
+    return {{glm::vec4(animation.center, (float) animation.spline + 1.0f),
+             glm::vec4(animation.radius, animation.phase, animation.speed, animation.scale),
+             glm::vec4(0.0f), glm::vec4(0.0f)}, glm::vec4(1.0f, 1.0f, 0.0f, 0.0f)};
+}
+
+// the control points of every spline, one after the other in the order of InstanceSpline, each spline starting at
+// splineFirstPoint() and splinePointCount() long
+inline const std::vector<glm::vec3>& splinePoints() {
+    static const std::vector<glm::vec3> points = [] {
+        std::vector<glm::vec3> p;
+        // a Catmull-Rom spline through 12 points of a circle is off from it by less than 0.2%
+        for (int i = 0; i < 12; i++) {
+            float angle = glm::radians(30.0f * (float) i);
+            p.push_back(glm::vec3(std::cos(angle), 0.0f, -std::sin(angle)));
+        }
+        p.insert(p.end(), {
+                // final, touchdown and the run on the water
+                glm::vec3(0.0f, 1.2f, 2.6f), glm::vec3(0.0f, 0.4f, 1.6f), glm::vec3(0.0f, 0.1f, 0.6f),
+                glm::vec3(0.0f, 0.1f, -0.4f),
+                // take off, the turn out and the leg back at the height of the circuit
+                glm::vec3(0.0f, 0.5f, -1.4f), glm::vec3(0.0f, 1.6f, -2.4f), glm::vec3(0.8f, 2.8f, -3.0f),
+                glm::vec3(1.6f, 3.2f, -2.0f), glm::vec3(1.6f, 3.2f, 1.0f), glm::vec3(1.4f, 2.8f, 2.8f),
+                // the turn onto the final
+                glm::vec3(0.7f, 2.0f, 3.3f)
+        });
+        return p;
+    }();
+    return points;
+}
+
+inline int splineFirstPoint(InstanceSpline spline) { return spline == SPLINE_CIRCLE ? 0 : 12; }
+
+inline int splinePointCount(InstanceSpline spline) { return spline == SPLINE_CIRCLE ? 12 : 11; }
+
+// the splines for the INSTANCED variant, once per frame and shader like the lights
+inline void setInstanceSplines(Shader& shader) {
+    const std::vector<glm::vec3>& points = splinePoints();
+    for (size_t i = 0; i < points.size(); i++)
+        shader.setVec3("splinePoints[" + std::to_string(i) + "]", points[i]);
+    for (int i = 0; i < SPLINE_COUNT; i++) {
+        std::string spline = "splines[" + std::to_string(i) + "]";
+        glUniform2i(glGetUniformLocation(shader.ID, spline.c_str()), splineFirstPoint((InstanceSpline) i),
+                    splinePointCount((InstanceSpline) i));
+    }
+}
+
+// a sphere around everywhere the first count instances can be, with the model reaching modelRadius from the
+// origin of an instance at scale 1; an animation is bounded by the control points of its spline, with some slack
+// for the curve swinging out past them
+inline glm::vec4 instanceBounds(const std::vector<InstanceData>& instances, int count, float modelRadius) {
+    const std::vector<glm::vec3>& points = splinePoints();
+    glm::vec3 lower(1e30f), upper(-1e30f);
+    auto add = [&](const glm::vec3& position, float extent) {
+        lower = glm::min(lower, position - extent);
+        upper = glm::max(upper, position + extent);
+    };
+    count = std::min(count, (int) instances.size());
+    for (int i = 0; i < count; i++) {
+        const glm::vec4* transform = instances[i].transform;
+        if (transform[0].w == 0.0f) {
+            float scale = 0.0f;
+            for (int column = 0; column < 3; column++)
+                scale = std::max(scale, glm::length(glm::vec3(transform[column])));
+            add(glm::vec3(transform[3]), modelRadius * scale);
+            continue;
+        }
+        InstanceSpline spline = (InstanceSpline) ((int) transform[0].w - 1);
+        glm::vec3 stretch(transform[1].x, 1.0f, transform[1].x);
+        for (int p = splineFirstPoint(spline); p < splineFirstPoint(spline) + splinePointCount(spline); p++)
+            add(glm::vec3(transform[0]) + points[p] * stretch, modelRadius * transform[1].w);
+    }
+    if (count == 0)
+        return glm::vec4(0.0f);
+    return glm::vec4((lower + upper) * 0.5f, 0.55f * glm::length(upper - lower));
+}
+
+// The instances of one model, uploaded once. attach() points the vertex arrays of the model's meshes at them, so
+// the mesh is drawn with Mesh::DrawInstanced() like any other draw of it; a model whose vertex arrays are rebuilt
+// (for the lightmap layout) has to be attached after.
+class InstanceBuffer {
+public:
+    explicit InstanceBuffer(const std::vector<InstanceData>& instances) : instanceCount((int) instances.size()) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, bytes(), instances.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void destroy() {
+        glDeleteBuffers(1, &buffer);
+    }
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    void attach(Model& model) const {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (const Mesh& mesh: model.meshes) {
+            glBindVertexArray(mesh.VAO);
+            for (int i = 0; i < 5; i++) {
+                glEnableVertexAttribArray(6 + i);
+                glVertexAttribPointer(6 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                      (void*) (i * sizeof(glm::vec4)));
+                glVertexAttribDivisor(6 + i, 1);
+            }
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    int count() const { return instanceCount; }
+
+    size_t bytes() const { return (size_t) instanceCount * sizeof(InstanceData); }
+
+private:
+    unsigned int buffer = 0;
+    int instanceCount = 0;
+};
+
+#endif //PROJECT_BASE_INSTANCEBUFFER_H
@@ -0,0 +1,99 @@
+#ifndef PROJECT_BASE_JOBPOOL_H
+#define PROJECT_BASE_JOBPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for data parallel loops. parallelFor() hands out the indices one at a time,
+// so jobs of uneven cost balance themselves, and the calling thread works along with the pool.
+class JobPool {
+public:
+    // 0 threads means one per hardware thread
+    explicit JobPool(unsigned int threads = 0) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 1; i < threads; i++)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~JobPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread& worker: workers)
+            worker.join();
+    }
+
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    unsigned int threadCount() const { return (unsigned int) workers.size() + 1; }
+
+    // calls job(i) for every i in [0, count) and returns once all of them are done
+    void parallelFor(int count, const std::function<void(int)>& job) {
+        if (count <= 0)
+            return;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // a worker still looking for indices of the previous loop must not see this one half set up
+            idle.wait(lock, [this] { return active == 0; });
+            currentJob = &job;
+            jobCount = count;
+            finished = 0;
+            next = 0;
+            generation++;
+        }
+        wakeUp.notify_all();
+        work();
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return finished == jobCount && active == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable idle;
+    bool stopping = false;
+    unsigned long long generation = 0;
+    int active = 0;
+
+    const std::function<void(int)>* currentJob = nullptr;
+    int jobCount = 0;
+    std::atomic<int> next{0};
+    std::atomic<int> finished{0};
+
+    void work() {
+        int index;
+        while ((index = next.fetch_add(1)) < jobCount) {
+            (*currentJob)(index);
+            finished.fetch_add(1);
+        }
+    }
+
+    void workerLoop() {
+        unsigned long long seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wakeUp.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            active++;
+            lock.unlock();
+            work();
+            lock.lock();
+            active--;
+            idle.notify_all();
+        }
+    }
+};
+
+#endif //PROJECT_BASE_JOBPOOL_H
@@ -0,0 +1,89 @@
+#ifndef PROJECT_BASE_LIGHTMAP_H
+#define PROJECT_BASE_LIGHTMAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <rg/LightmapFile.h>
+#include <rg/StaticScene.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The lighting of the static instances as baked by tools/lightmap_baker.cpp.
+// Loading gives the meshes of the static models their lightmap layout, the other shaders keep working on them.
+class BakedLightmap {
+public:
+    // models in the order of StaticScene::models; returns false (and changes nothing) without an up to date bake
+    bool load(const StaticScene& scene, const std::vector<Model*>& models) {
+        uint64_t hash = hashStaticScene(scene);
+        std::string path = lightmapPath(hash);
+        LightmapData data;
+        if (!readLightmap(path, hash, data)) {
+            std::cout << "No baked lighting at " << path << ", run lightmap_baker to create it" << std::endl;
+            return false;
+        }
+        if (data.layouts.size() != models.size() || data.instanceScaleOffset.size() != scene.instances.size()) {
+            std::cout << "Baked lighting at " << path << " doesn't match the scene" << std::endl;
+            return false;
+        }
+        for (size_t m = 0; m < models.size(); m++)
+            if (data.layouts[m].size() != models[m]->meshes.size()) {
+                std::cout << "Baked lighting at " << path << " doesn't match " << scene.models[m] << std::endl;
+                return false;
+            }
+
+        for (size_t m = 0; m < models.size(); m++)
+            for (size_t i = 0; i < models[m]->meshes.size(); i++) {
+                const LightmapMeshLayout& layout = data.layouts[m][i];
+                models[m]->meshes[i].SetLightmapLayout(layout.remap, layout.coords, layout.indices);
+            }
+        scaleOffsets = data.instanceScaleOffset;
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, data.width, data.height, 0, GL_RGBA, GL_FLOAT, &data.texels[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        loaded = true;
+        return true;
+    }
+
+    bool isLoaded() const { return loaded; }
+
+    void destroy() {
+        if (loaded)
+            glDeleteTextures(1, &texture);
+    }
+
+    // binds the atlas, once per frame and shader
+    void bind(Shader& shader, int textureUnit) const {
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("lightmap", textureUnit);
+    }
+
+    // selects the rectangle of one static instance
+    void bindInstance(Shader& shader, int instance) const {
+        shader.setVec4("lightmapScaleOffset", scaleOffsets[instance]);
+    }
+
+    // the rectangle of one static instance, for drawing it from an InstanceBuffer; the whole atlas when nothing
+    // is loaded
+    glm::vec4 instanceScaleOffset(int instance) const {
+        return loaded ? scaleOffsets[instance] : glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+    }
+
+private:
+    unsigned int texture = 0;
+    bool loaded = false;
+    std::vector<glm::vec4> scaleOffsets;
+};
+
+#endif //PROJECT_BASE_LIGHTMAP_H
@@ -0,0 +1,174 @@
+#ifndef PROJECT_BASE_LIGHTMAPFILE_H
+#define PROJECT_BASE_LIGHTMAPFILE_H
+
+#include <glm/glm.hpp>
+
+#include <rg/StaticScene.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// The file written by the lightmap baker (tools/lightmap_baker.cpp) and read by the application.
+// Besides the atlas itself it holds the lightmap coordinates of every mesh of the static models: charts need
+// their own vertices along the seams, so each mesh comes with a new vertex list (as indices of the original
+// vertices), its lightmap coordinates in [0, 1] and new triangle indices. Every static instance gets a
+// rectangle of the atlas, its scale and offset map the coordinates of its model into it.
+// Files are named after a hash of everything that goes into the bake, stale ones are simply never found.
+
+const uint32_t LIGHTMAP_MAGIC = 0x504d4c52; // "RLMP"
+const uint32_t LIGHTMAP_VERSION = 2;
+const char* const LIGHTMAP_DIRECTORY = "resources/lightmaps";
+
+// bake settings, part of the hash
+const int LIGHTMAP_SAMPLES = 256;
+const int LIGHTMAP_BOUNCES = 2;
+const float LIGHTMAP_TEXELS_PER_UNIT = 24.0f;
+const int LIGHTMAP_MAX_RECT = 512;
+
+struct LightmapMeshLayout {
+    std::vector<uint32_t> remap;
+    std::vector<glm::vec2> coords;
+    std::vector<uint32_t> indices;
+};
+
+struct LightmapData {
+    int width = 0;
+    int height = 0;
+    // per model, per mesh in the order Model loads them
+    std::vector<std::vector<LightmapMeshLayout>> layouts;
+    // per static instance (StaticInstanceId), xy scale and zw offset into the atlas
+    std::vector<glm::vec4> instanceScaleOffset;
+    // rgb sun, sky and bounced light (to be multiplied by the albedo), a ambient occlusion
+    std::vector<glm::vec4> texels;
+};
+
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t hashFile(const std::string& path, uint64_t hash) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return fnv1a("missing", 7, hash);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return fnv1a(bytes.data(), bytes.size(), hash);
+}
+
+// hash of the model files, the placement of the instances, the sun and the bake settings
+inline uint64_t hashStaticScene(const StaticScene& scene) {
+    uint64_t hash = fnv1a(&LIGHTMAP_VERSION, sizeof(LIGHTMAP_VERSION));
+    hash = fnv1a(&LIGHTMAP_SAMPLES, sizeof(LIGHTMAP_SAMPLES), hash);
+    hash = fnv1a(&LIGHTMAP_BOUNCES, sizeof(LIGHTMAP_BOUNCES), hash);
+    hash = fnv1a(&LIGHTMAP_TEXELS_PER_UNIT, sizeof(LIGHTMAP_TEXELS_PER_UNIT), hash);
+    hash = fnv1a(&LIGHTMAP_MAX_RECT, sizeof(LIGHTMAP_MAX_RECT), hash);
+    for (const std::string& path: scene.models) {
+        hash = fnv1a(path.data(), path.size(), hash);
+        hash = hashFile(path, hash);
+        // gltf keeps the geometry next to the scene description
+        std::string directory = path.substr(0, path.find_last_of('/'));
+        hash = hashFile(directory + "/scene.bin", hash);
+    }
+    for (const StaticInstance& instance: scene.instances) {
+        hash = fnv1a(&instance.model, sizeof(instance.model), hash);
+        hash = fnv1a(&instance.transform[0][0], sizeof(glm::mat4), hash);
+    }
+    hash = fnv1a(&scene.sunDirection, sizeof(glm::vec3), hash);
+    hash = fnv1a(&scene.sunAmbient, sizeof(glm::vec3), hash);
+    hash = fnv1a(&scene.sunDiffuse, sizeof(glm::vec3), hash);
+    return hash;
+}
+
+inline std::string lightmapPath(uint64_t hash) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long) hash);
+    return std::string(LIGHTMAP_DIRECTORY) + "/" + name + ".lightmap";
+}
+
+namespace lightmapio {
+    template<typename T>
+    void write(std::ofstream& out, const T& value) {
+        out.write((const char*) &value, sizeof(T));
+    }
+
+    template<typename T>
+    void writeVector(std::ofstream& out, const std::vector<T>& values) {
+        uint32_t size = (uint32_t) values.size();
+        write(out, size);
+        out.write((const char*) values.data(), sizeof(T) * size);
+    }
+
+    template<typename T>
+    bool read(std::ifstream& in, T& value) {
+        return (bool) in.read((char*) &value, sizeof(T));
+    }
+
+    template<typename T>
+    bool readVector(std::ifstream& in, std::vector<T>& values) {
+        uint32_t size;
+        if (!read(in, size))
+            return false;
+        values.resize(size);
+        return (bool) in.read((char*) values.data(), sizeof(T) * size);
+    }
+}
+
+inline bool writeLightmap(const std::string& path, uint64_t hash, const LightmapData& data) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        return false;
+    lightmapio::write(out, LIGHTMAP_MAGIC);
+    lightmapio::write(out, LIGHTMAP_VERSION);
+    lightmapio::write(out, hash);
+    lightmapio::write(out, data.width);
+    lightmapio::write(out, data.height);
+    lightmapio::write(out, (uint32_t) data.layouts.size());
+    for (const std::vector<LightmapMeshLayout>& model: data.layouts) {
+        lightmapio::write(out, (uint32_t) model.size());
+        for (const LightmapMeshLayout& mesh: model) {
+            lightmapio::writeVector(out, mesh.remap);
+            lightmapio::writeVector(out, mesh.coords);
+            lightmapio::writeVector(out, mesh.indices);
+        }
+    }
+    lightmapio::writeVector(out, data.instanceScaleOffset);
+    lightmapio::writeVector(out, data.texels);
+    return (bool) out;
+}
+
+inline bool readLightmap(const std::string& path, uint64_t hash, LightmapData& data) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    uint32_t magic, version, modelCount;
+    uint64_t fileHash;
+    if (!lightmapio::read(in, magic) || magic != LIGHTMAP_MAGIC ||
+        !lightmapio::read(in, version) || version != LIGHTMAP_VERSION ||
+        !lightmapio::read(in, fileHash) || fileHash != hash ||
+        !lightmapio::read(in, data.width) || !lightmapio::read(in, data.height) ||
+        !lightmapio::read(in, modelCount))
+        return false;
+    data.layouts.resize(modelCount);
+    for (std::vector<LightmapMeshLayout>& model: data.layouts) {
+        uint32_t meshCount;
+        if (!lightmapio::read(in, meshCount))
+            return false;
+        model.resize(meshCount);
+        for (LightmapMeshLayout& mesh: model)
+            if (!lightmapio::readVector(in, mesh.remap) || !lightmapio::readVector(in, mesh.coords) ||
+                !lightmapio::readVector(in, mesh.indices))
+                return false;
+    }
+    return lightmapio::readVector(in, data.instanceScaleOffset) && lightmapio::readVector(in, data.texels) &&
+           data.texels.size() == (size_t) data.width * data.height;
+}
+
+#endif //PROJECT_BASE_LIGHTMAPFILE_H
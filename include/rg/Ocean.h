@@ -0,0 +1,209 @@
+#ifndef PROJECT_BASE_OCEAN_H
+#define PROJECT_BASE_OCEAN_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/JobPool.h>
+#include <rg/OceanSpectrum.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// The sea surface: an OceanSpectrum simulated on the CPU every frame, streamed into a displacement and a slope
+// texture, and a mesh of nested grids around the camera that is displaced by them.
+// The simulation writes straight into mapped pixel buffers, two per texture used in turns, so the upload from one
+// doesn't have to finish before the next frame maps the other.
+// The mesh has LEVELS square grids of CELLS x CELLS cells, each with twice the spacing of the one inside it and with
+// the middle quarter cut out where that one lies. The whole mesh moves with the camera in steps of the coarsest
+// spacing, so every vertex stays on its own level's grid and nothing swims. On the outer edge of a level every
+// other vertex is pulled onto the straight line between its neighbours, which are also the vertices of the coarser
+// level, so no cracks open between the two.
+class Ocean {
+public:
+    static const int LEVELS = 5;
+    static const int CELLS = 64;
+
+    // spacing of the finest grid, in world units
+    float spacing = 0.125f;
+
+    explicit Ocean(const OceanParams& params) {
+        glGenTextures(1, &displacement);
+        glBindTexture(GL_TEXTURE_2D, displacement);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glGenTextures(1, &slopes);
+        glBindTexture(GL_TEXTURE_2D, slopes);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenBuffers(2, displacementPBO);
+        glGenBuffers(2, slopePBO);
+        configure(params);
+        buildMesh();
+    }
+
+    void destroy() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        glDeleteBuffers(2, displacementPBO);
+        glDeleteBuffers(2, slopePBO);
+        glDeleteTextures(1, &displacement);
+        glDeleteTextures(1, &slopes);
+    }
+
+    Ocean(const Ocean&) = delete;
+    Ocean& operator=(const Ocean&) = delete;
+
+    // starts a new spectrum if the parameters changed, reallocating the textures if the size did
+    void configure(const OceanParams& params) {
+        if (spectrum && spectrum->parameters() == params) {
+            spectrum->setChoppiness(params.choppiness);
+            return;
+        }
+        int previousSize = spectrum ? spectrum->parameters().size : 0;
+        spectrum.reset(new OceanSpectrum(params));
+        if (params.size == previousSize)
+            return;
+
+        int n = params.size;
+        glBindTexture(GL_TEXTURE_2D, displacement);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, n, n, 0, GL_RGBA, GL_FLOAT, NULL);
+        glBindTexture(GL_TEXTURE_2D, slopes);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, n, n, 0, GL_RG, GL_FLOAT, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        for (int i = 0; i < 2; i++) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, displacementPBO[i]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr) n * n * 4 * sizeof(float), NULL, GL_STREAM_DRAW);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slopePBO[i]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr) n * n * 2 * sizeof(float), NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // simulates the surface at the given time and uploads it
+    void update(float time, JobPool* pool) {
+        int n = spectrum->parameters().size;
+        spectrum->evaluate(time, pool);
+
+        current = 1 - current;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, displacementPBO[current]);
+        float* mappedDisplacement = (float*) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr) n * n * 4 * sizeof(float),
+                                                              GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slopePBO[current]);
+        float* mappedSlopes = (float*) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr) n * n * 2 * sizeof(float),
+                                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mappedDisplacement && mappedSlopes)
+            spectrum->write(mappedDisplacement, mappedSlopes, pool);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, displacementPBO[current]);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // with a pixel unpack buffer bound, the data pointer is an offset into it
+        glBindTexture(GL_TEXTURE_2D, displacement);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RGBA, GL_FLOAT, (void*) 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slopePBO[current]);
+        glBindTexture(GL_TEXTURE_2D, slopes);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RG, GL_FLOAT, (void*) 0);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // binds the textures and sets what the ocean shaders need to place the mesh
+    void bind(Shader& shader, const glm::vec3& cameraPosition, float level, int displacementUnit, int slopeUnit) const {
+        glActiveTexture(GL_TEXTURE0 + displacementUnit);
+        glBindTexture(GL_TEXTURE_2D, displacement);
+        glActiveTexture(GL_TEXTURE0 + slopeUnit);
+        glBindTexture(GL_TEXTURE_2D, slopes);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("displacement", displacementUnit);
+        shader.setInt("slopes", slopeUnit);
+        shader.setFloat("patchLength", spectrum->parameters().patchLength);
+        shader.setFloat("level", level);
+        shader.setFloat("extent", extent());
+        float step = spacing * (float) (1 << (LEVELS - 1));
+        shader.setVec2("center", glm::vec2(std::floor(cameraPosition.x / step) * step,
+                                           std::floor(cameraPosition.z / step) * step));
+    }
+
+    void draw() const {
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
+
+    // half the side of the area the mesh covers
+    float extent() const { return spacing * (float) (1 << (LEVELS - 1)) * CELLS / 2; }
+
+    int triangleCount() const { return indexCount / 3; }
+
+    // bytes uploaded by every update()
+    size_t uploadBytes() const {
+        size_t n = (size_t) spectrum->parameters().size;
+        return n * n * 6 * sizeof(float);
+    }
+
+private:
+    std::unique_ptr<OceanSpectrum> spectrum;
+    unsigned int displacement, slopes;
+    unsigned int displacementPBO[2], slopePBO[2];
+    int current = 0;
+    unsigned int VAO, VBO, EBO;
+    int indexCount = 0;
+
+    void buildMesh() {
+        // position in the xz plane relative to the center, and the offset to the two neighbours it is pulled between
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        const int half = CELLS / 2;
+        const int side = CELLS + 1;
+        for (int level = 0; level < LEVELS; level++) {
+            float step = spacing * (float) (1 << level);
+            unsigned int first = (unsigned int) (vertices.size() / 4);
+            for (int j = -half; j <= half; j++)
+                for (int i = -half; i <= half; i++) {
+                    glm::vec2 morph = glm::vec2(0.0f);
+                    bool outer = level + 1 < LEVELS;
+                    if (outer && (i == -half || i == half) && (j & 1))
+                        morph = glm::vec2(0.0f, step);
+                    else if (outer && (j == -half || j == half) && (i & 1))
+                        morph = glm::vec2(step, 0.0f);
+                    vertices.insert(vertices.end(), {i * step, j * step, morph.x, morph.y});
+                }
+            for (int j = -half; j < half; j++)
+                for (int i = -half; i < half; i++) {
+                    // the middle is covered by the finer level
+                    if (level > 0 && i >= -half / 2 && i < half / 2 && j >= -half / 2 && j < half / 2)
+                        continue;
+                    unsigned int v00 = first + (j + half) * side + (i + half);
+                    unsigned int v10 = v00 + 1, v01 = v00 + side, v11 = v01 + 1;
+                    indices.insert(indices.end(), {v00, v01, v10, v10, v01, v11});
+                }
+        }
+        indexCount = (int) indices.size();
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*) 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*) (2 * sizeof(float)));
+        glBindVertexArray(0);
+    }
+};
+
+#endif //PROJECT_BASE_OCEAN_H
@@ -0,0 +1,169 @@
+#ifndef PROJECT_BASE_OCEANSPECTRUM_H
+#define PROJECT_BASE_OCEANSPECTRUM_H
+
+#include <glm/glm.hpp>
+
+#include <rg/FFT.h>
+#include <rg/JobPool.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+struct OceanParams {
+    // grid resolution, a power of two
+    int size = 256;
+    // side of the square patch the grid covers, in world units; the surface repeats after it
+    float patchLength = 32.0f;
+    float windSpeed = 6.0f;
+    glm::vec2 windDirection = glm::vec2(1.0f, 0.4f);
+    // scales the Phillips spectrum
+    float amplitude = 2e-5f;
+    // horizontal displacement relative to the height, 0 for round waves
+    float choppiness = 1.0f;
+    // waves shorter than this are damped away
+    float smallWaveLength = 0.05f;
+    unsigned int seed = 1;
+
+    bool operator==(const OceanParams& other) const {
+        return size == other.size && patchLength == other.patchLength && windSpeed == other.windSpeed &&
+               windDirection == other.windDirection && amplitude == other.amplitude &&
+               smallWaveLength == other.smallWaveLength && seed == other.seed;
+    }
+};
+
+// Tessendorf's ocean ("Simulating Ocean Water"): a Phillips spectrum of random wave amplitudes is made once, and every
+// frame each wave is advanced by the deep water dispersion relation and the surface is brought back from frequency
+// space by inverse FFTs. The heights, the horizontal displacements of choppy waves and the slopes are all real, so
+// they are transformed two at a time, as the real and the imaginary part of one complex grid.
+// No GL in here, the benchmark tool uses it as well.
+class OceanSpectrum {
+public:
+    static constexpr float GRAVITY = 9.81f;
+
+    explicit OceanSpectrum(const OceanParams& params) : params(params), fft(params.size) {
+        int n = params.size;
+        h0Re.resize(n * n);
+        h0Im.resize(n * n);
+        omega.resize(n * n);
+        for (int i = 0; i < 3; i++) {
+            re[i].resize(n * n);
+            im[i].resize(n * n);
+        }
+
+        std::mt19937 random(params.seed);
+        std::normal_distribution<float> gaussian(0.0f, 1.0f);
+        for (int z = 0; z < n; z++)
+            for (int x = 0; x < n; x++) {
+                float amplitude = std::sqrt(phillips(wave(x, z)) * 0.5f);
+                h0Re[z * n + x] = gaussian(random) * amplitude;
+                h0Im[z * n + x] = gaussian(random) * amplitude;
+                omega[z * n + x] = std::sqrt(GRAVITY * glm::length(wave(x, z)));
+            }
+    }
+
+    OceanSpectrum(const OceanSpectrum&) = delete;
+    OceanSpectrum& operator=(const OceanSpectrum&) = delete;
+
+    const OceanParams& parameters() const { return params; }
+
+    // only scales what write() outputs, so it can change without a new spectrum
+    void setChoppiness(float choppiness) { params.choppiness = choppiness; }
+
+    // the surface at the given time, kept until write()
+    void evaluate(float time, JobPool* pool = nullptr) {
+        int n = params.size;
+        auto row = [&](int z) {
+            for (int x = 0; x < n; x++) {
+                glm::vec2 k = wave(x, z);
+                float length = glm::length(k);
+                int i = z * n + x;
+                float c = std::cos(omega[i] * time), s = std::sin(omega[i] * time);
+                // h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t), with -k at the mirrored index
+                int mirrored = ((n - z) % n) * n + (n - x) % n;
+                float hRe = (h0Re[i] + h0Re[mirrored]) * c - (h0Im[i] + h0Im[mirrored]) * s;
+                float hIm = (h0Re[i] - h0Re[mirrored]) * s + (h0Im[i] - h0Im[mirrored]) * c;
+
+                // horizontal displacement -i k / |k| h, slope i k h
+                glm::vec2 direction = length > 0.0f ? k / length : glm::vec2(0.0f);
+                float dxRe = direction.x * hIm, dxIm = -direction.x * hRe;
+                float dzRe = direction.y * hIm, dzIm = -direction.y * hRe;
+                float sxRe = -k.x * hIm, sxIm = k.x * hRe;
+                float szRe = -k.y * hIm, szIm = k.y * hRe;
+
+                // height + i dx, dz + i sx, sz
+                re[0][i] = hRe - dxIm;
+                im[0][i] = hIm + dxRe;
+                re[1][i] = dzRe - sxIm;
+                im[1][i] = dzIm + sxRe;
+                re[2][i] = szRe;
+                im[2][i] = szIm;
+            }
+        };
+        if (pool)
+            pool->parallelFor(n, row);
+        else
+            for (int z = 0; z < n; z++)
+                row(z);
+
+        for (int i = 0; i < 3; i++)
+            fft.transform(&re[i][0], &im[i][0], true, pool);
+    }
+
+    // writes what evaluate() computed: size * size RGBA displacements (x, height, z, 0) and RG slopes (x, z)
+    void write(float* displacement, float* slopes, JobPool* pool = nullptr) const {
+        int n = params.size;
+        float choppiness = params.choppiness;
+        auto row = [&](int z) {
+            for (int x = 0; x < n; x++) {
+                int i = z * n + x;
+                // the spectrum is centered on the middle of the grid, which shifts every other texel by half a turn
+                float sign = ((x + z) & 1) ? -1.0f : 1.0f;
+                displacement[4 * i] = sign * im[0][i] * choppiness;
+                displacement[4 * i + 1] = sign * re[0][i];
+                displacement[4 * i + 2] = sign * re[1][i] * choppiness;
+                displacement[4 * i + 3] = 0.0f;
+                slopes[2 * i] = sign * im[1][i];
+                slopes[2 * i + 1] = sign * re[2][i];
+            }
+        };
+        if (pool)
+            pool->parallelFor(n, row);
+        else
+            for (int z = 0; z < n; z++)
+                row(z);
+    }
+
+    // floating point operations of the transforms of one evaluate()
+    double fftFlops() const { return 3.0 * fft.flops(); }
+
+private:
+    OceanParams params;
+    FFT2D fft;
+    std::vector<float> h0Re, h0Im;
+    // angular frequency of every wave, by the deep water dispersion relation
+    std::vector<float> omega;
+    std::vector<float> re[3], im[3];
+
+    glm::vec2 wave(int x, int z) const {
+        const float twoPi = 6.28318530718f;
+        int n = params.size;
+        return glm::vec2(x - n / 2, z - n / 2) * (twoPi / params.patchLength);
+    }
+
+    float phillips(glm::vec2 k) const {
+        float length = glm::length(k);
+        if (length < 1e-6f)
+            return 0.0f;
+        float largest = params.windSpeed * params.windSpeed / GRAVITY;
+        float alignment = glm::dot(k / length, glm::normalize(params.windDirection));
+        float spectrum = params.amplitude * std::exp(-1.0f / (length * largest * length * largest)) /
+                         (length * length * length * length) * alignment * alignment;
+        // waves going against the wind are mostly gone
+        if (alignment < 0.0f)
+            spectrum *= 0.07f;
+        return spectrum * std::exp(-length * length * params.smallWaveLength * params.smallWaveLength);
+    }
+};
+
+#endif //PROJECT_BASE_OCEANSPECTRUM_H
@@ -0,0 +1,176 @@
+#ifndef PROJECT_BASE_PARTICLESYSTEM_H
+#define PROJECT_BASE_PARTICLESYSTEM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/GpuTimer.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+enum ParticleBehaviour {
+    // pushed around by gravity (or buoyancy, when it is negative), wind and a little turbulence
+    PARTICLE_DRIFT,
+    // circling around the emitter at the distance of its extent, the wings flapping
+    PARTICLE_FLOCK,
+};
+
+// where and how the particles of a system are born, and how they move and look; part of the scene, so the
+// application may move an emitter every frame
+struct ParticleEmitter {
+    ParticleBehaviour behaviour = PARTICLE_DRIFT;
+    glm::vec3 position = glm::vec3(0.0f);
+    // half the size of the box particles are born in
+    glm::vec3 extent = glm::vec3(0.0f);
+    glm::vec3 velocity = glm::vec3(0.0f);
+    // random speed added in a random direction
+    float velocitySpread = 0.0f;
+    float minLife = 1.0f;
+    float maxLife = 1.0f;
+    // downwards acceleration
+    float gravity = 0.0f;
+    // velocity lost per second
+    float drag = 0.0f;
+    float turbulence = 0.0f;
+    // side of a billboard in world units, at birth
+    float size = 0.1f;
+    glm::vec3 color = glm::vec3(1.0f);
+    // additive particles give off light, the others cover what is behind them
+    bool additive = true;
+    // whether the particles may be bright enough to bloom
+    bool bloom = true;
+};
+
+// A GPU particle system: the particles never leave video memory. Every frame a vertex shader advances all of them
+// from one buffer into the other with transform feedback, nothing is rasterized, and the buffer written last is
+// drawn as instanced billboards, a particle per instance. Particles that die are born again at the emitter right
+// away, so the count stays fixed and there is nothing to allocate or compact; at first they are unborn, with
+// random negative ages, so they don't all start at once.
+class ParticleSystem {
+public:
+    ParticleEmitter emitter;
+    // the update and the draw of this system
+    GpuTimer timer;
+
+    ParticleSystem(const ParticleEmitter& emitter, int count) : emitter(emitter) {
+        glGenBuffers(2, buffers);
+        glGenVertexArrays(2, updateVAO);
+        glGenVertexArrays(2, drawVAO);
+        for (int i = 0; i < 2; i++) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+            // the same layout for both, the particles are vertices of the update and instances of the draw
+            for (unsigned int vao: {updateVAO[i], drawVAO[i]}) {
+                glBindVertexArray(vao);
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*) 0);
+                glEnableVertexAttribArray(1);
+                glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*) sizeof(glm::vec4));
+                if (vao == drawVAO[i]) {
+                    glVertexAttribDivisor(0, 1);
+                    glVertexAttribDivisor(1, 1);
+                }
+            }
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        resize(count);
+    }
+
+    void destroy() {
+        glDeleteVertexArrays(2, drawVAO);
+        glDeleteVertexArrays(2, updateVAO);
+        glDeleteBuffers(2, buffers);
+        timer.destroy();
+    }
+
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+    // starts over with the given number of unborn particles, the only time particles are uploaded
+    void resize(int count) {
+        if (count == particleCount)
+            return;
+        particleCount = count;
+        std::vector<Particle> particles(count);
+        std::mt19937 random(count);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (Particle& particle: particles) {
+            particle.positionAge = glm::vec4(emitter.position, -unit(random) * emitter.maxLife);
+            particle.velocityLife = glm::vec4(0.0f);
+        }
+        for (int i = 0; i < 2; i++) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+            glBufferData(GL_ARRAY_BUFFER, count * sizeof(Particle), particles.data(), GL_DYNAMIC_COPY);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    int count() const { return particleCount; }
+
+    // advances every particle by deltaTime
+    void update(Shader& updateShader, float time, float deltaTime, const glm::vec3& wind, float waterLevel) {
+        updateShader.use();
+        updateShader.setFloat("time", time);
+        updateShader.setFloat("deltaTime", deltaTime);
+        updateShader.setInt("behaviour", emitter.behaviour);
+        updateShader.setVec3("emitterPosition", emitter.position);
+        updateShader.setVec3("emitterExtent", emitter.extent);
+        updateShader.setVec3("emitterVelocity", emitter.velocity);
+        updateShader.setFloat("velocitySpread", emitter.velocitySpread);
+        updateShader.setVec2("lifeRange", emitter.minLife, emitter.maxLife);
+        updateShader.setFloat("gravity", emitter.gravity);
+        updateShader.setFloat("drag", emitter.drag);
+        updateShader.setFloat("turbulence", emitter.turbulence);
+        updateShader.setVec3("wind", wind);
+        updateShader.setFloat("waterLevel", waterLevel);
+        updateShader.setInt("frame", (int) frame++);
+
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(updateVAO[current]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[1 - current]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, particleCount);
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        current = 1 - current;
+    }
+
+    // over the bound target, with the scene's depth bound to unit 0 of drawShader's "depth" for the soft edges and
+    // the depth test; sets its own blend state
+    void draw(Shader& drawShader, float maxLuminance) {
+        drawShader.use();
+        drawShader.setInt("behaviour", emitter.behaviour);
+        drawShader.setFloat("size", emitter.size);
+        drawShader.setVec3("color", emitter.color);
+        drawShader.setBool("additive", emitter.additive);
+        drawShader.setFloat("maxLuminance", emitter.bloom ? 1e9f : maxLuminance);
+        // premultiplied alpha: additive particles add all of their color and cover nothing
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        glBindVertexArray(drawVAO[current]);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, particleCount);
+        glBindVertexArray(0);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    size_t bufferBytes() const { return 2 * (size_t) particleCount * sizeof(Particle); }
+
+private:
+    struct Particle {
+        // age is negative until the particle is born
+        glm::vec4 positionAge;
+        glm::vec4 velocityLife;
+    };
+
+    unsigned int buffers[2];
+    unsigned int updateVAO[2], drawVAO[2];
+    int current = 0;
+    int particleCount = 0;
+    unsigned int frame = 0;
+};
+
+#endif //PROJECT_BASE_PARTICLESYSTEM_H
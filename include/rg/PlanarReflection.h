@@ -0,0 +1,162 @@
+#ifndef PROJECT_BASE_PLANARREFLECTION_H
+#define PROJECT_BASE_PLANARREFLECTION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rg/FrameGraph.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Reflection in a horizontal plane, rendered by a camera mirrored in it. The projection of that camera gets an
+// oblique near plane lying in the water, so whatever is below the surface is clipped for free, without a clip
+// distance in every shader.
+// The reflection is cached: it is only rendered again once the camera or one of the dynamic objects moved or turned
+// more than a threshold since the last time. The water samples it with the view projection it was rendered with,
+// so a cached reflection stays in place on the surface instead of sliding with the screen. On top of that the
+// updates are spread out so their GPU time averages to at most budgetMs a frame.
+class PlanarReflection {
+public:
+    // height of the plane
+    float level;
+    // how far the camera and the dynamic objects may move, and the camera turn, before the reflection is redrawn
+    float positionThreshold = 0.05f;
+    float angleThreshold = glm::radians(0.5f);
+    // average GPU time per frame the reflection may take
+    float budgetMs = 0.5f;
+
+    explicit PlanarReflection(float level) : level(level) {
+        glGenTextures(1, &color);
+        glBindTexture(GL_TEXTURE_2D, color);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glGenRenderbuffers(1, &depth);
+        glGenFramebuffers(1, &FBO);
+    }
+
+    void destroy() {
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteRenderbuffers(1, &depth);
+        glDeleteTextures(1, &color);
+    }
+
+    PlanarReflection(const PlanarReflection&) = delete;
+    PlanarReflection& operator=(const PlanarReflection&) = delete;
+
+    // reallocates the target, the cached reflection is lost
+    void resize(int width, int height, GLenum internalFormat) {
+        if (width == size.width && height == size.height && internalFormat == size.internalFormat)
+            return;
+        size = {width, height, internalFormat};
+        glBindTexture(GL_TEXTURE_2D, color);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        valid = false;
+    }
+
+    // decides whether this frame renders the reflection; gpuMs is the smoothed time an update takes
+    bool needsUpdate(const glm::mat4& view, const glm::mat4& projection, const std::vector<glm::vec3>& dynamicPositions,
+                     float gpuMs) {
+        framesSinceUpdate++;
+        glm::mat4 camera = glm::inverse(view);
+        glm::vec3 cameraPosition = glm::vec3(camera[3]);
+        glm::vec3 cameraFront = -glm::normalize(glm::vec3(camera[2]));
+        bool moved = !valid || projection != renderedProjection ||
+                     glm::length(cameraPosition - renderedPosition) > positionThreshold ||
+                     glm::dot(cameraFront, renderedFront) < std::cos(angleThreshold) ||
+                     dynamicPositions.size() != renderedDynamic.size();
+        for (size_t i = 0; !moved && i < dynamicPositions.size(); i++)
+            moved = glm::length(dynamicPositions[i] - renderedDynamic[i]) > positionThreshold;
+        if (!moved)
+            return false;
+
+        // an update costing n budgets may happen every n frames
+        int interval = budgetMs > 0.0f ? (int) std::ceil(gpuMs / budgetMs) : 1;
+        if (valid && framesSinceUpdate < interval)
+            return false;
+
+        valid = true;
+        framesSinceUpdate = 0;
+        renderedPosition = cameraPosition;
+        renderedFront = cameraFront;
+        renderedProjection = projection;
+        renderedViewProjection = projection * view;
+        renderedDynamic = dynamicPositions;
+        return true;
+    }
+
+    // forgets the cached reflection, e.g. when it was switched off for a while
+    void invalidate() { valid = false; }
+
+    // view of the camera mirrored in the plane; it renders with the winding reversed
+    glm::mat4 reflectedView(const glm::mat4& view) const {
+        glm::mat4 mirror = glm::mat4(1.0f);
+        mirror[1][1] = -1.0f;
+        mirror[3][1] = 2.0f * level;
+        return view * mirror;
+    }
+
+    // projection whose near plane is the reflecting plane, as seen from the mirrored view
+    // (Lengyel, "Oblique View Frustum Depth Projection and Clipping")
+    glm::mat4 obliqueProjection(const glm::mat4& projection, const glm::mat4& mirroredView) const {
+        glm::vec4 plane = glm::transpose(glm::inverse(mirroredView)) * glm::vec4(0.0f, 1.0f, 0.0f, -level);
+        glm::vec4 corner;
+        corner.x = (sign(plane.x) + projection[2][0]) / projection[0][0];
+        corner.y = (sign(plane.y) + projection[2][1]) / projection[1][1];
+        corner.z = -1.0f;
+        corner.w = (1.0f + projection[2][2]) / projection[3][2];
+        glm::vec4 scaled = plane * (2.0f / glm::dot(plane, corner));
+
+        glm::mat4 oblique = projection;
+        oblique[0][2] = scaled.x;
+        oblique[1][2] = scaled.y;
+        oblique[2][2] = scaled.z + 1.0f;
+        oblique[3][2] = scaled.w;
+        return oblique;
+    }
+
+    // binds and clears the target, with the viewport set to it
+    void begin(const glm::vec3& clearColor) const {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, size.width, size.height);
+        glClearColor(clearColor.r, clearColor.g, clearColor.b, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    unsigned int texture() const { return color; }
+
+    // the view projection of the camera when the reflection was rendered, what the water projects itself with
+    const glm::mat4& viewProjection() const { return renderedViewProjection; }
+
+    RenderTargetDesc desc() const { return size; }
+
+    // size of the depth buffer, which only the reflection itself sees
+    size_t depthBytes() const { return RenderTargetDesc{size.width, size.height, GL_DEPTH_COMPONENT24}.bytes(); }
+
+private:
+    unsigned int color, depth, FBO;
+    RenderTargetDesc size = {0, 0, 0};
+    bool valid = false;
+    int framesSinceUpdate = 0;
+    glm::vec3 renderedPosition = glm::vec3(0.0f);
+    glm::vec3 renderedFront = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::mat4 renderedProjection = glm::mat4(1.0f);
+    glm::mat4 renderedViewProjection = glm::mat4(1.0f);
+    std::vector<glm::vec3> renderedDynamic;
+
+    static float sign(float value) {
+        return value > 0.0f ? 1.0f : (value < 0.0f ? -1.0f : 0.0f);
+    }
+};
+
+#endif //PROJECT_BASE_PLANARREFLECTION_H
@@ -0,0 +1,241 @@
+#ifndef PROJECT_BASE_POINTSHADOWMAPS_H
+#define PROJECT_BASE_POINTSHADOWMAPS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/CascadedShadowMap.h>
+#include <rg/ShaderVariants.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Omnidirectional shadows for point lights.
+// Every light owns six consecutive layers of one depth array (cube map arrays need GL 4.0), which hold the
+// distance to the light divided by its radius. A light is rendered in a single pass: the geometry shader
+// sends each triangle to the cube faces it can touch. Lights are only re-rendered when they move or when a
+// dynamic caster moves inside their radius, and at most updatesPerFrame of them per frame, oldest first.
+class PointShadowMaps {
+public:
+    static const int MAX_LIGHTS = 4;
+
+    int resolution;
+    int updatesPerFrame = 1;
+    float nearPlane = 0.05f;
+
+    explicit PointShadowMaps(int resolution = 512) : resolution(resolution) {
+        glGenTextures(1, &depthArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, 6 * MAX_LIGHTS, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        // the layered framebuffer is drawn to, the per layer ones are only used to clear a single light
+        glGenFramebuffers(1, &layeredFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, layeredFBO);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Point shadow framebuffer not complete!" << std::endl;
+
+        glGenFramebuffers(6 * MAX_LIGHTS, layerFBO);
+        for (int i = 0; i < 6 * MAX_LIGHTS; i++) {
+            glBindFramebuffer(GL_FRAMEBUFFER, layerFBO[i]);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, i);
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void destroy() {
+        glDeleteFramebuffers(1, &layeredFBO);
+        glDeleteFramebuffers(6 * MAX_LIGHTS, layerFBO);
+        glDeleteTextures(1, &depthArray);
+    }
+
+    PointShadowMaps(const PointShadowMaps&) = delete;
+    PointShadowMaps& operator=(const PointShadowMaps&) = delete;
+
+    // returns the index of the new light, or -1 if all the slots are taken
+    int addLight(glm::vec3 position, float radius) {
+        if ((int) lights.size() == MAX_LIGHTS)
+            return -1;
+        Light light;
+        light.position = position;
+        light.radius = radius;
+        light.dirty = true;
+        light.dirtySince = frame;
+        lights.push_back(light);
+        return (int) lights.size() - 1;
+    }
+
+    void setLight(int index, glm::vec3 position, float radius) {
+        Light& light = lights[index];
+        if (light.position != position || light.radius != radius) {
+            light.position = position;
+            light.radius = radius;
+            markDirty(light);
+        }
+    }
+
+    // lights that still wait for an update because of the budget
+    int pendingUpdates() const {
+        int pending = 0;
+        for (const Light& light: lights)
+            pending += light.dirty;
+        return pending;
+    }
+
+    int updatesLastFrame() const { return lastUpdates; }
+
+    // dynamic casters have to be passed in the same order every frame, that is how their movement is detected
+    void update(ShaderVariants& depthShaders, const std::function<void(Shader&)>& drawStatic,
+                const std::vector<ShadowCaster>& dynamicCasters) {
+        frame++;
+        for (size_t i = 0; i < dynamicCasters.size(); i++) {
+            const ShadowCaster& caster = dynamicCasters[i];
+            bool moved = caster.animated || i >= previousCasters.size() ||
+                         previousCasters[i] != glm::vec4(caster.center, caster.radius);
+            if (!moved)
+                continue;
+            for (Light& light: lights) {
+                // a caster leaving the radius has to be erased from the shadow as well
+                if (touches(light, caster.center, caster.radius) ||
+                    (i < previousCasters.size() && touches(light, glm::vec3(previousCasters[i]), previousCasters[i].w)))
+                    markDirty(light);
+            }
+        }
+        previousCasters.resize(dynamicCasters.size());
+        for (size_t i = 0; i < dynamicCasters.size(); i++)
+            previousCasters[i] = glm::vec4(dynamicCasters[i].center, dynamicCasters[i].radius);
+
+        lastUpdates = 0;
+        while (lastUpdates < updatesPerFrame) {
+            int oldest = -1;
+            for (int i = 0; i < (int) lights.size(); i++)
+                if (lights[i].dirty && (oldest == -1 || lights[i].dirtySince < lights[oldest].dirtySince))
+                    oldest = i;
+            if (oldest == -1)
+                break;
+            if (lastUpdates == 0)
+                beginRendering();
+            renderLight(oldest, depthShaders, drawStatic, dynamicCasters);
+            lastUpdates++;
+        }
+        if (lastUpdates > 0)
+            endRendering();
+    }
+
+    // sets the uniforms CalcPointShadow() reads for one light, prefix is the name of its uniform struct
+    void bind(Shader& shader, int textureUnit, const std::string& prefix, int index) const {
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("pointShadowMap", textureUnit);
+        shader.setInt(prefix + ".shadowLayer", index < 0 ? -1 : 6 * index);
+        shader.setFloat(prefix + ".shadowFarPlane", index < 0 ? 1.0f : lights[index].radius);
+    }
+
+private:
+    struct Light {
+        glm::vec3 position;
+        float radius;
+        bool dirty;
+        unsigned int dirtySince;
+    };
+
+    unsigned int depthArray;
+    unsigned int layeredFBO;
+    unsigned int layerFBO[6 * MAX_LIGHTS];
+    std::vector<Light> lights;
+    std::vector<glm::vec4> previousCasters;
+    unsigned int frame = 0;
+    int lastUpdates = 0;
+    GLint savedViewport[4];
+
+    void markDirty(Light& light) {
+        if (!light.dirty) {
+            light.dirty = true;
+            light.dirtySince = frame;
+        }
+    }
+
+    static bool touches(const Light& light, glm::vec3 center, float radius) {
+        return glm::length(center - light.position) < light.radius + radius;
+    }
+
+    void beginRendering() {
+        glGetIntegerv(GL_VIEWPORT, savedViewport);
+        glViewport(0, 0, resolution, resolution);
+        // no polygon offset, it doesn't apply to depth written by the fragment shader
+        glDisable(GL_CULL_FACE);
+    }
+
+    void endRendering() {
+        glEnable(GL_CULL_FACE);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    }
+
+    void renderLight(int index, ShaderVariants& depthShaders, const std::function<void(Shader&)>& drawStatic,
+                     const std::vector<ShadowCaster>& dynamicCasters) {
+        Light& light = lights[index];
+        // clearing the layered framebuffer would wipe every light, so the six layers are cleared one by one
+        for (int face = 0; face < 6; face++) {
+            glBindFramebuffer(GL_FRAMEBUFFER, layerFBO[6 * index + face]);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+
+        // same orientation of the faces as in a cube map, CalcPointShadow() depends on it
+        static const glm::vec3 directions[6] = {
+                glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+                glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+                glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+        };
+        static const glm::vec3 ups[6] = {
+                glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+                glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+        };
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, light.radius);
+        glm::mat4 shadowMatrices[6];
+        for (int face = 0; face < 6; face++)
+            shadowMatrices[face] = projection * glm::lookAt(light.position, light.position + directions[face],
+                                                            ups[face]);
+        // the same light for every variant the casters are drawn with
+        auto useShader = [&](unsigned int keywords) -> Shader& {
+            Shader& shader = depthShaders.get(keywords);
+            shader.use();
+            for (int face = 0; face < 6; face++)
+                shader.setMat4("shadowMatrices[" + std::to_string(face) + "]", shadowMatrices[face]);
+            shader.setInt("baseLayer", 6 * index);
+            shader.setVec3("lightPosition", light.position);
+            shader.setFloat("farPlane", light.radius);
+            return shader;
+        };
+
+        glBindFramebuffer(GL_FRAMEBUFFER, layeredFBO);
+        Shader& depthShader = useShader(0);
+        drawStatic(depthShader);
+        for (const ShadowCaster& caster: dynamicCasters)
+            if (touches(light, caster.center, caster.radius)) {
+                Shader& casterShader = caster.keywords == 0 ? depthShader : useShader(caster.keywords);
+                casterShader.use();
+                caster.draw(casterShader);
+            }
+
+        light.dirty = false;
+    }
+};
+
+#endif //PROJECT_BASE_POINTSHADOWMAPS_H
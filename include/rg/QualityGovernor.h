@@ -0,0 +1,110 @@
+#ifndef PROJECT_BASE_QUALITYGOVERNOR_H
+#define PROJECT_BASE_QUALITYGOVERNOR_H
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The knobs the governor turns, cheapest last.
+struct QualitySettings {
+    // size of the offscreen targets relative to the window
+    float renderScale;
+    int bloomLevels;
+    // added to the mip level material textures are sampled at
+    float textureLodBias;
+    // point shadow maps are refreshed every this many frames
+    int shadowUpdateInterval;
+};
+
+// Steps through a ladder of QualitySettings to keep the GPU frame time around a target.
+// The frame time it is fed should already be smoothed (GpuTimer::averageMilliseconds()). Going down is quick and
+// going up is slow, and the thresholds for the two are apart, so a frame time close to the target settles instead
+// of oscillating between two steps. After every step the governor waits for the timers to catch up before judging
+// again. Every decision is written to stdout, with the numbers that led to it.
+class QualityGovernor {
+public:
+    float targetMs = 16.6f;
+    // step down when above targetMs * (1 + downMargin) for downDelay seconds
+    float downMargin = 0.05f;
+    double downDelay = 0.5;
+    // step up when below targetMs * (1 - upMargin) for upDelay seconds
+    float upMargin = 0.2f;
+    double upDelay = 3.0;
+    // after a step, nothing is decided for this long
+    double settleTime = 1.0;
+
+    QualityGovernor() {
+        ladder = {
+                {0.50f, 3, 1.0f, 4},
+                {0.60f, 4, 1.0f, 4},
+                {0.70f, 4, 0.5f, 2},
+                {0.80f, 5, 0.5f, 2},
+                {0.90f, 5, 0.0f, 1},
+                {1.00f, 6, 0.0f, 1},
+        };
+        level = (int) ladder.size() - 1;
+    }
+
+    const QualitySettings& settings() const { return ladder[level]; }
+
+    int currentLevel() const { return level; }
+
+    int levelCount() const { return (int) ladder.size(); }
+
+    // back to the best quality, e.g. when the governor is switched on again
+    void reset(double now) {
+        level = (int) ladder.size() - 1;
+        overSince = underSince = -1.0;
+        lastChange = now;
+    }
+
+    // returns true when the settings changed
+    bool update(float gpuMs, double now) {
+        if (gpuMs <= 0.0f || now - lastChange < settleTime)
+            return false;
+
+        float downThreshold = targetMs * (1.0f + downMargin);
+        float upThreshold = targetMs * (1.0f - upMargin);
+        overSince = gpuMs > downThreshold ? (overSince < 0.0 ? now : overSince) : -1.0;
+        underSince = gpuMs < upThreshold ? (underSince < 0.0 ? now : underSince) : -1.0;
+
+        if (overSince >= 0.0 && now - overSince >= downDelay && level > 0) {
+            step(-1, gpuMs, downThreshold, now - overSince, now);
+            return true;
+        }
+        if (underSince >= 0.0 && now - underSince >= upDelay && level + 1 < (int) ladder.size()) {
+            step(+1, gpuMs, upThreshold, now - underSince, now);
+            return true;
+        }
+        return false;
+    }
+
+    static std::string describe(const QualitySettings& settings) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << "scale " << settings.renderScale
+            << ", bloom " << settings.bloomLevels << " levels, lod bias " << settings.textureLodBias
+            << ", shadows every " << settings.shadowUpdateInterval << " frames";
+        return out.str();
+    }
+
+private:
+    std::vector<QualitySettings> ladder;
+    int level;
+    double overSince = -1.0;
+    double underSince = -1.0;
+    double lastChange = 0.0;
+
+    void step(int direction, float gpuMs, float threshold, double duration, double now) {
+        std::cout << std::fixed << std::setprecision(2) << "Quality governor: GPU " << gpuMs << " ms "
+                  << (direction < 0 ? ">" : "<") << " " << threshold << " ms for " << duration << " s, level "
+                  << level << " -> " << level + direction << " (" << describe(ladder[level + direction]) << ")"
+                  << std::endl;
+        level += direction;
+        overSince = underSince = -1.0;
+        lastChange = now;
+    }
+};
+
+#endif //PROJECT_BASE_QUALITYGOVERNOR_H
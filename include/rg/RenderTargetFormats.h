@@ -0,0 +1,43 @@
+#ifndef PROJECT_BASE_RENDERTARGETFORMATS_H
+#define PROJECT_BASE_RENDERTARGETFORMATS_H
+
+#include <glad/glad.h>
+
+enum RenderTargetPrecision {
+    // what every target used to be, kept to compare against
+    PRECISION_RGBA16F,
+    // no pass reads the alpha of an HDR target, so three floats packed into 32 bits are enough
+    PRECISION_PACKED,
+    PRECISION_COUNT
+};
+
+// The formats the frame's render targets are created with, one per kind of target.
+// The TAA history stays RGBA16F under every policy: it is blended into for dozens of frames, and the 5 and 6 bit
+// mantissas of the packed format would drift in hue long before that. Nothing offscreen holds display referred
+// color, the final pass writes straight to the window, so there is no target RGBA8 or sRGB would fit yet.
+struct RenderTargetFormats {
+    GLenum hdrColor;
+    GLenum bloom;
+    GLenum velocity;
+    GLenum depth;
+
+    static RenderTargetFormats select(RenderTargetPrecision precision, bool depth32) {
+        RenderTargetFormats formats;
+        bool packed = precision == PRECISION_PACKED;
+        formats.hdrColor = packed ? GL_R11F_G11F_B10F : GL_RGBA16F;
+        formats.bloom = packed ? GL_R11F_G11F_B10F : GL_RGBA16F;
+        formats.velocity = GL_RG16F;
+        formats.depth = depth32 ? GL_DEPTH_COMPONENT32F : GL_DEPTH_COMPONENT24;
+        return formats;
+    }
+
+    static const char* name(RenderTargetPrecision precision) {
+        switch (precision) {
+            case PRECISION_RGBA16F: return "RGBA16F";
+            case PRECISION_PACKED: return "R11F_G11F_B10F";
+            default: return "";
+        }
+    }
+};
+
+#endif //PROJECT_BASE_RENDERTARGETFORMATS_H
@@ -0,0 +1,148 @@
+#ifndef PROJECT_BASE_RIPPLESIMULATION_H
+#define PROJECT_BASE_RIPPLESIMULATION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/FrameGraph.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+// something pushing the water, in world units; strength is how far it lifts the surface in one tick
+struct RippleSource {
+    glm::vec2 position;
+    float radius;
+    float strength;
+};
+
+// Small waves on the water, from the 2D wave equation stepped on a height field in a fragment pass. Every texel
+// holds the height of this tick and of the one before, which is all the explicit integration needs, and two such
+// textures are rendered into in turns.
+// The field covers a square around the camera that follows it in whole texels: a step reads the last state
+// shifted by the texels the square moved, so the waves stay where they are in the world, and what comes in over
+// the edge starts flat. Ticks run at a fixed rate however long the frames take, at most maxTicks of them a frame,
+// so the waves travel at the same speed at any frame rate and a long frame doesn't make the next one longer.
+class RippleSimulation {
+public:
+    static const int MAX_SOURCES = 8;
+
+    float tickRate = 60.0f;
+    int maxTicks = 4;
+    // (speed * tick / texel)^2, at most 0.5 or the integration blows up
+    float courant = 0.35f;
+    // height kept per tick
+    float damping = 0.99f;
+
+    RippleSimulation(int resolution, float size) : resolution(resolution), size(size) {
+        glGenTextures(2, state);
+        glGenFramebuffers(2, FBO);
+        const float border[] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int i = 0; i < 2; i++) {
+            glBindTexture(GL_TEXTURE_2D, state[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, resolution, resolution, 0, GL_RG, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            // whatever is outside the square is calm water
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+            glBindFramebuffer(GL_FRAMEBUFFER, FBO[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, state[i], 0);
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void destroy() {
+        glDeleteFramebuffers(2, FBO);
+        glDeleteTextures(2, state);
+    }
+
+    RippleSimulation(const RippleSimulation&) = delete;
+    RippleSimulation& operator=(const RippleSimulation&) = delete;
+
+    // how many ticks the time since the last frame adds up to
+    int ticksFor(float deltaTime) {
+        pending += deltaTime * tickRate;
+        int ticks = std::min((int) pending, maxTicks);
+        pending = std::min(pending - (float) ticks, 1.0f);
+        return ticks;
+    }
+
+    // runs the ticks around the camera, with the sources pushing during each of them; leaves framebuffer 0 bound
+    void step(int ticks, const glm::vec3& cameraPosition, const std::vector<RippleSource>& sources, Shader& stepShader,
+              const std::function<void()>& drawQuad) {
+        // the square only moves with a tick that shifts the waves along
+        if (ticks == 0)
+            return;
+        float texel = size / (float) resolution;
+        glm::ivec2 corner = glm::ivec2((int) std::floor(cameraPosition.x / texel), (int) std::floor(cameraPosition.z / texel)) -
+                            glm::ivec2(resolution / 2);
+        glm::ivec2 shift = corner - this->corner;
+        this->corner = corner;
+
+        glViewport(0, 0, resolution, resolution);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        stepShader.use();
+        stepShader.setInt("state", 0);
+        stepShader.setVec2("texel", glm::vec2(1.0f / (float) resolution));
+        stepShader.setFloat("courant", courant);
+        stepShader.setFloat("damping", damping);
+        int count = std::min((int) sources.size(), MAX_SOURCES);
+        stepShader.setInt("sourceCount", count);
+        for (int i = 0; i < count; i++) {
+            const RippleSource& source = sources[i];
+            stepShader.setVec4("sources[" + std::to_string(i) + "]",
+                               glm::vec4((source.position - origin()) / size, source.radius / size, source.strength));
+        }
+        glActiveTexture(GL_TEXTURE0);
+        for (int tick = 0; tick < ticks; tick++) {
+            // only the first tick of a frame sees the square move
+            stepShader.setVec2("shift", tick == 0 ? glm::vec2(shift) / (float) resolution : glm::vec2(0.0f));
+            glBindFramebuffer(GL_FRAMEBUFFER, FBO[1 - current]);
+            glBindTexture(GL_TEXTURE_2D, state[current]);
+            drawQuad();
+            current = 1 - current;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+    }
+
+    // binds the height field and sets where it lies for a water shader
+    void bind(Shader& shader, int unit) const {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, state[current]);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("ripples", unit);
+        shader.setVec2("rippleOrigin", origin());
+        shader.setFloat("rippleSize", size);
+    }
+
+    unsigned int texture() const { return state[current]; }
+
+    RenderTargetDesc desc() const { return {resolution, resolution, GL_RG32F}; }
+
+    // world position of the corner of the square with the lowest coordinates
+    glm::vec2 origin() const { return glm::vec2(corner) * (size / (float) resolution); }
+
+private:
+    int resolution;
+    float size;
+    unsigned int state[2], FBO[2];
+    int current = 0;
+    // the square's corner, in texels from the world origin
+    glm::ivec2 corner = glm::ivec2(0);
+    // fraction of a tick left over from the last frames
+    float pending = 0.0f;
+};
+
+#endif //PROJECT_BASE_RIPPLESIMULATION_H
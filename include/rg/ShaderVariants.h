@@ -0,0 +1,198 @@
+#ifndef PROJECT_BASE_SHADERVARIANTS_H
+#define PROJECT_BASE_SHADERVARIANTS_H
+
+#include <glad/glad.h>
+
+#include <common.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+// Feature keywords a shader can be specialized for. A shader declares the ones it understands with
+//     #pragma keywords HAS_SPECULAR_MAP NUM_POINT_LIGHTS ...
+// and every variant is compiled with the matching #defines injected after #version. Boolean keywords are
+// defined only when set, NUM_POINT_LIGHTS is always defined to the light count. INSTANCED also puts the
+// instance animation (INSTANCE_ANIMATION_PATH) in front of the vertex shader, the one place it is written.
+enum ShaderKeyword : unsigned int {
+    HAS_SPECULAR_MAP = 1u << 0,
+    FOG = 1u << 1,
+    SHADOWS = 1u << 2,
+    LIGHTMAP = 1u << 3,
+    // bits 4 and 5 hold NUM_POINT_LIGHTS
+    FXAA = 1u << 6,
+    VIGNETTE = 1u << 7,
+    CAUSTICS = 1u << 8,
+    // the model matrix (or the animation) is read per instance from an rg/InstanceBuffer.h
+    INSTANCED = 1u << 9,
+    // the vertices are a simulated rg/Cloth.h, which also carry where they were the frame before
+    CLOTH = 1u << 10,
+};
+
+// instanceTransform() and the instance attributes, see rg/InstanceBuffer.h
+const char* const INSTANCE_ANIMATION_PATH = "resources/shaders/instanceAnimation.glsl";
+
+const int NUM_POINT_LIGHTS_SHIFT = 4;
+const unsigned int NUM_POINT_LIGHTS_MASK = 3u << NUM_POINT_LIGHTS_SHIFT;
+const int MAX_POINT_LIGHTS = 3;
+
+inline unsigned int pointLightsKeyword(int count) {
+    return (unsigned int) count << NUM_POINT_LIGHTS_SHIFT;
+}
+
+// keywords decided by the material of a mesh, the rest of a key comes from the pass
+inline unsigned int materialKeywords(const Mesh& mesh) {
+    for (const Texture& texture: mesh.textures)
+        if (texture.type == "texture_specular")
+            return HAS_SPECULAR_MAP;
+    return 0;
+}
+
+// All the variants of one vertex/fragment (and optionally geometry) shader, compiled on first use and cached by
+// keyword bitmask. Keywords a shader doesn't declare are dropped from the key, so keys that only differ in them
+// share a program.
+class ShaderVariants {
+public:
+    ShaderVariants(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+            : vertexSource(readFileContents(vertexPath)), fragmentSource(readFileContents(fragmentPath)),
+              geometrySource(geometryPath ? readFileContents(geometryPath) : "") {
+        declared = parseKeywords(vertexSource) | parseKeywords(fragmentSource) | parseKeywords(geometrySource);
+        if (declared & INSTANCED)
+            instanceAnimation = readFileContents(INSTANCE_ANIMATION_PATH);
+    }
+
+    void destroy() {
+        for (auto& variant: variants)
+            glDeleteProgram(variant.second.shader->ID);
+        variants.clear();
+    }
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    Shader& get(unsigned int key) {
+        return *variant(key).shader;
+    }
+
+    // makes the variant current; setup runs the first time a variant is used in a frame and sets the uniforms
+    // shared by everything drawn with it
+    Shader& use(unsigned int key, const std::function<void(Shader&)>& setup) {
+        Variant& v = variant(key);
+        Shader& shader = *v.shader;
+        shader.use();
+        if (v.setupFrame != frame) {
+            v.setupFrame = frame;
+            setup(shader);
+        }
+        return shader;
+    }
+
+    void nextFrame() { frame++; }
+
+    size_t compiledCount() const { return variants.size(); }
+
+private:
+    struct Variant {
+        std::unique_ptr<Shader> shader;
+        unsigned long long setupFrame;
+    };
+
+    std::string vertexSource;
+    std::string fragmentSource;
+    std::string geometrySource;
+    std::string instanceAnimation;
+    unsigned int declared = 0;
+    std::unordered_map<unsigned int, Variant> variants;
+    unsigned long long frame = 1;
+
+    Variant& variant(unsigned int key) {
+        key &= declared;
+        auto found = variants.find(key);
+        if (found != variants.end())
+            return found->second;
+        std::string defines = definesFor(key);
+        Variant v;
+        std::string vertexCode = inject(vertexSource, key & INSTANCED ? defines + instanceAnimation : defines);
+        std::string geometryCode = geometrySource.empty() ? "" : inject(geometrySource, defines);
+        v.shader.reset(new Shader(Shader::FromSource(vertexCode, inject(fragmentSource, defines), geometryCode)));
+        v.setupFrame = 0;
+        return variants.emplace(key, std::move(v)).first->second;
+    }
+
+    static unsigned int parseKeywords(const std::string& source) {
+        unsigned int mask = 0;
+        std::istringstream lines(source);
+        std::string line;
+        while (std::getline(lines, line)) {
+            std::istringstream words(line);
+            std::string pragma, keywords, name;
+            if (!(words >> pragma >> keywords) || pragma != "#pragma" || keywords != "keywords")
+                continue;
+            while (words >> name) {
+                if (name == "HAS_SPECULAR_MAP")
+                    mask |= HAS_SPECULAR_MAP;
+                else if (name == "FOG")
+                    mask |= FOG;
+                else if (name == "SHADOWS")
+                    mask |= SHADOWS;
+                else if (name == "LIGHTMAP")
+                    mask |= LIGHTMAP;
+                else if (name == "FXAA")
+                    mask |= FXAA;
+                else if (name == "VIGNETTE")
+                    mask |= VIGNETTE;
+                else if (name == "CAUSTICS")
+                    mask |= CAUSTICS;
+                else if (name == "INSTANCED")
+                    mask |= INSTANCED;
+                else if (name == "CLOTH")
+                    mask |= CLOTH;
+                else if (name == "NUM_POINT_LIGHTS")
+                    mask |= NUM_POINT_LIGHTS_MASK;
+                else
+                    std::cout << "Unknown shader keyword " << name << std::endl;
+            }
+        }
+        return mask;
+    }
+
+    std::string definesFor(unsigned int key) const {
+        std::string defines;
+        if (key & HAS_SPECULAR_MAP)
+            defines += "#define HAS_SPECULAR_MAP\n";
+        if (key & FOG)
+            defines += "#define FOG\n";
+        if (key & SHADOWS)
+            defines += "#define SHADOWS\n";
+        if (key & LIGHTMAP)
+            defines += "#define LIGHTMAP\n";
+        if (key & FXAA)
+            defines += "#define FXAA\n";
+        if (key & VIGNETTE)
+            defines += "#define VIGNETTE\n";
+        if (key & CAUSTICS)
+            defines += "#define CAUSTICS\n";
+        if (key & INSTANCED)
+            defines += "#define INSTANCED\n";
+        if (key & CLOTH)
+            defines += "#define CLOTH\n";
+        if (declared & NUM_POINT_LIGHTS_MASK)
+            defines += "#define NUM_POINT_LIGHTS " + std::to_string((key & NUM_POINT_LIGHTS_MASK) >> NUM_POINT_LIGHTS_SHIFT) + "\n";
+        return defines;
+    }
+
+    // #version has to stay the first statement, the defines go right after it
+    static std::string inject(const std::string& source, const std::string& defines) {
+        size_t version = source.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : source.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return defines + source;
+        return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+    }
+};
+
+#endif //PROJECT_BASE_SHADERVARIANTS_H
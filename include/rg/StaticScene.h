@@ -0,0 +1,125 @@
+#ifndef PROJECT_BASE_STATICSCENE_H
+#define PROJECT_BASE_STATICSCENE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <rg/TransformHierarchy.h>
+
+#include <string>
+#include <vector>
+
+// The part of the scene that never moves: the sun and the placement of the buildings, the boat, the flag,
+// the pole and the seabed. It is shared by the application and the lightmap baker, which have to agree on it
+// exactly, since the baked lightmaps are looked up by a hash of it.
+
+enum StaticModelId {
+    MODEL_CITY,
+    MODEL_FLAG,
+    MODEL_BOAT,
+    // the seabed is not a model but the plane quad, scaled by the instance transform
+    MODEL_SEABED = -1
+};
+
+enum StaticInstanceId {
+    CITY_FAR_FAR,
+    CITY_FAR,
+    CITY_MIDDLE,
+    CITY_NEAR,
+    CITY_SMALL_NEAR,
+    BOAT,
+    FLAG,
+    POLE,
+    SEABED,
+    STATIC_INSTANCE_COUNT
+};
+
+struct StaticInstance {
+    int model;
+    glm::mat4 transform;
+};
+
+struct StaticScene {
+    std::vector<std::string> models;
+    std::vector<StaticInstance> instances;
+
+    glm::vec3 sunDirection;
+    glm::vec3 sunAmbient;
+    glm::vec3 sunDiffuse;
+    glm::vec3 sunSpecular;
+};
+
+// The cloth of the flag model is simulated (rg/ClothSimulation.h), so it is left out of the model wherever the model
+// is drawn or baked. It is the only part textured from the right half of the palette: a triangle stays when all its
+// texture coordinates are in the left half.
+inline bool isFlagPoleTriangle(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) {
+    return a.x < 0.5f && b.x < 0.5f && c.x < 0.5f;
+}
+
+inline StaticScene buildStaticScene() {
+    StaticScene scene;
+    scene.models = {
+            "resources/objects/building_06/scene.gltf",
+            "resources/objects/red_flag/scene.gltf",
+            "resources/objects/victorian_row_boat/scene.gltf"
+    };
+    scene.instances.resize(STATIC_INSTANCE_COUNT);
+
+    scene.sunDirection = glm::vec3(-0.2f, -1.0f, -0.3f);
+    scene.sunAmbient = glm::vec3(0.4f);
+    scene.sunDiffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+    scene.sunSpecular = glm::vec3(0.2f, 0.2f, 0.2f);
+
+    // every instance is placed (moved and scaled) and then, for the models that need it, turned in its own frame by
+    // a child node, which keeps the scale along the world axes like the chains of glm calls this used to be
+    TransformHierarchy hierarchy;
+    int nodes[STATIC_INSTANCE_COUNT];
+    auto place = [&](StaticInstanceId instance, const glm::vec3& position, const glm::vec3& scale) {
+        int node = hierarchy.add();
+        hierarchy.setPosition(node, position);
+        hierarchy.setScale(node, scale);
+        nodes[instance] = node;
+        return node;
+    };
+    auto turn = [&](StaticInstanceId instance) {
+        nodes[instance] = hierarchy.add(nodes[instance]);
+        return nodes[instance];
+    };
+
+    //city models, far far to small near
+    const glm::vec3 cityPositions[] = {glm::vec3(0.0f, 1.0f, -5.0f), glm::vec3(0.0f, 1.0f, -3.0f),
+                                       glm::vec3(0.0f, 1.0f, -1.0f), glm::vec3(0.0f, 1.0f, 1.0f),
+                                       glm::vec3(0.0f, 1.0f, 3.0f)};
+    const float cityHeights[] = {0.5f, 0.7f, 1.0f, 1.3f, 1.0f};
+    for (int city = CITY_FAR_FAR; city <= CITY_SMALL_NEAR; city++) {
+        place((StaticInstanceId) city, cityPositions[city], glm::vec3(1.0f, cityHeights[city], 1.0f));
+        hierarchy.setRotation(turn((StaticInstanceId) city), glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    //boat model
+    place(BOAT, glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(6.0f));
+
+    //flag and pole, the same model stood up the same way
+    place(FLAG, glm::vec3(0.0f, 7.0f, 1.0f), glm::vec3(1.5f, 1.0f, 1.5f));
+    place(POLE, glm::vec3(0.0f, -1.2f, 1.0f), glm::vec3(3.0f));
+    for (StaticInstanceId instance: {FLAG, POLE}) {
+        int node = turn(instance);
+        hierarchy.setRotation(node, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        hierarchy.rotate(node, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        hierarchy.rotate(node, glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    //seabed, the 100x100 plane quad at y = -1 moved down
+    place(SEABED, glm::vec3(0.0f, -5.0f, 0.0f), glm::vec3(1.0f));
+
+    hierarchy.update();
+    for (int instance = 0; instance < STATIC_INSTANCE_COUNT; instance++) {
+        int model = instance <= CITY_SMALL_NEAR ? MODEL_CITY : instance == BOAT ? MODEL_BOAT
+                  : instance == SEABED ? MODEL_SEABED : MODEL_FLAG;
+        scene.instances[instance] = {model, hierarchy.world(nodes[instance])};
+    }
+
+    return scene;
+}
+
+#endif //PROJECT_BASE_STATICSCENE_H
@@ -0,0 +1,140 @@
+#ifndef PROJECT_BASE_TEMPORALAA_H
+#define PROJECT_BASE_TEMPORALAA_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/FrameGraph.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// Temporal anti-aliasing: every frame the projection is shifted by a different subpixel offset from a Halton (2, 3)
+// sequence, and the resolve blends the new frame into a history reprojected along the velocity buffer. The history
+// is clamped to the colors around the pixel in the new frame, which rejects what was disoccluded or changed.
+// The history has the output size, which may be larger than the size the scene is rendered at: then more
+// jitter positions are cycled through and the accumulation doubles as temporal upscaling.
+class TemporalAA {
+public:
+    // how much of the history is kept each frame
+    float feedback = 0.9f;
+
+    TemporalAA() {
+        glGenTextures(2, history);
+        for (int i = 0; i < 2; i++) {
+            glBindTexture(GL_TEXTURE_2D, history[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        glGenFramebuffers(2, historyFBO);
+    }
+
+    void destroy() {
+        glDeleteFramebuffers(2, historyFBO);
+        glDeleteTextures(2, history);
+    }
+
+    TemporalAA(const TemporalAA&) = delete;
+    TemporalAA& operator=(const TemporalAA&) = delete;
+
+    // reallocates the history for a new output size; the history starts over
+    void resize(int width, int height) {
+        if (width == outputWidth && height == outputHeight)
+            return;
+        outputWidth = width;
+        outputHeight = height;
+        for (int i = 0; i < 2; i++) {
+            glBindTexture(GL_TEXTURE_2D, history[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+            glBindFramebuffer(GL_FRAMEBUFFER, historyFBO[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, history[i], 0);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        reset();
+    }
+
+    // forgets the history, e.g. after a camera cut or when TAA is switched back on
+    void reset() { historyValid = false; }
+
+    // moves on to the next frame, with the next jitter position and the other history texture;
+    // returns projection shifted by the jitter, for a target of the given size
+    glm::mat4 jitter(const glm::mat4& projection, int width, int height) {
+        // the fewer pixels are rendered per output pixel, the more positions it takes to cover them
+        float scale = std::min((float) width / (float) std::max(outputWidth, 1), 1.0f);
+        int period = std::min(std::max((int) std::ceil(8.0f / (scale * scale)), 8), 64);
+        sampleIndex = sampleIndex % period + 1;
+        current = 1 - current;
+        glm::vec2 offset = glm::vec2(halton(sampleIndex, 2) - 0.5f, halton(sampleIndex, 3) - 0.5f);
+
+        glm::mat4 jittered = projection;
+        jittered[2][0] += offset.x * 2.0f / (float) width;
+        jittered[2][1] += offset.y * 2.0f / (float) height;
+        return jittered;
+    }
+
+    // blends the scene into the history of the last frame; leaves framebuffer 0 bound
+    void resolve(unsigned int scene, unsigned int velocity, Shader& resolveShader,
+                         const std::function<void()>& drawQuad) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, historyFBO[current]);
+        glViewport(0, 0, outputWidth, outputHeight);
+        resolveShader.use();
+        resolveShader.setInt("scene", 0);
+        resolveShader.setInt("history", 1);
+        resolveShader.setInt("velocity", 2);
+        resolveShader.setInt("historyValid", historyValid);
+        resolveShader.setFloat("feedback", feedback);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, scene);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, history[1 - current]);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, velocity);
+        glActiveTexture(GL_TEXTURE0);
+        drawQuad();
+        historyValid = true;
+
+        if (blend)
+            glEnable(GL_BLEND);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    // the history of this frame, what resolve() writes to
+    unsigned int texture() const { return history[current]; }
+
+    RenderTargetDesc desc() const { return {outputWidth, outputHeight, GL_RGBA16F}; }
+
+private:
+    unsigned int history[2];
+    unsigned int historyFBO[2];
+    int current = 0;
+    int outputWidth = 0, outputHeight = 0;
+    bool historyValid = false;
+    int sampleIndex = 0;
+
+    static float halton(int index, int base) {
+        float result = 0.0f;
+        float fraction = 1.0f;
+        while (index > 0) {
+            fraction /= (float) base;
+            result += fraction * (float) (index % base);
+            index /= base;
+        }
+        return result;
+    }
+};
+
+#endif //PROJECT_BASE_TEMPORALAA_H
@@ -0,0 +1,344 @@
+#ifndef PROJECT_BASE_TERRAIN_H
+#define PROJECT_BASE_TERRAIN_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/TerrainFile.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// The seabed as a CDLOD terrain (Strugar, "Continuous Distance-Dependent Level of Detail for Rendering Heightmaps")
+// over the tile pyramid of rg/TerrainFile.h. Every frame a quadtree of tiles is walked from the single coarsest
+// one: a node that is out of the frustum is dropped, one closer to the camera than its level's range is split
+// into its four children, and the rest are drawn, all with the same grid mesh of one tile. Towards the end of its
+// range a node's grid is morphed into the grid of the next coarser level, so neighbours of different levels meet
+// without cracks and switching levels doesn't pop.
+// Tiles are read from disk on a thread of their own and kept in a texture array of CACHE_TILES layers that is
+// reused in least recently used order, so memory doesn't grow with the size of the terrain. A node whose children
+// aren't loaded yet is drawn whole in the meantime, and only the coarsest tile has to be there from the start.
+class Terrain {
+public:
+    // layers of the tile cache
+    static const int CACHE_TILES = 256;
+    // tiles waiting to be read or uploaded at most
+    static const int MAX_PENDING = 32;
+    // tiles uploaded per frame at most
+    static const int UPLOADS_PER_FRAME = 8;
+
+    // distance from the camera within which level 0 is drawn, doubling with every level
+    float lodDistance = 40.0f;
+    // fraction of a level's range after which its grid starts morphing into the coarser one
+    float morphStart = 0.7f;
+
+    explicit Terrain(const std::string& path) : path(path) {
+        std::ifstream in(path, std::ios::binary);
+        TerrainTile root;
+        if (!readTerrainHeader(in, header) || !readTerrainTile(in, header, header.levels - 1, 0, 0, root))
+            return;
+
+        glGenTextures(1, &heights);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, heights);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R16, TERRAIN_TILE_SAMPLES, TERRAIN_TILE_SAMPLES, CACHE_TILES, 0,
+                     GL_RED, GL_UNSIGNED_SHORT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        slots.resize(CACHE_TILES);
+        upload(tileKey(header.levels - 1, 0, 0), root);
+        buildGrid();
+
+        loader = std::thread([this]() { load(); });
+        loaded = true;
+    }
+
+    ~Terrain() {
+        if (!loader.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        loader.join();
+    }
+
+    void destroy() {
+        if (!loaded)
+            return;
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        glDeleteTextures(1, &heights);
+    }
+
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+    // false when there is no terrain file, the flat seabed has to do then
+    bool available() const { return loaded; }
+
+    // picks the nodes to draw, uploads what the loader read for the next frames and asks for the tiles still missing
+    void update(const glm::vec3& cameraPosition, const glm::mat4& viewProjection) {
+        frame++;
+        extractPlanes(viewProjection);
+        camera = cameraPosition;
+        nodes.clear();
+        wanted.clear();
+        culled = 0;
+        select(header.levels - 1, 0, 0);
+        // coarse tiles first, every finer one waits for its parent anyway
+        std::stable_sort(wanted.begin(), wanted.end(), [](uint32_t a, uint32_t b) { return (a >> 26) > (b >> 26); });
+
+        // only now, so what this frame draws is known and stays in the cache
+        std::vector<std::pair<uint32_t, TerrainTile>> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (!finished.empty() && (int) ready.size() < UPLOADS_PER_FRAME) {
+                ready.push_back(std::move(finished.front()));
+                finished.pop_front();
+            }
+        }
+        for (auto& tile: ready)
+            upload(tile.first, tile.second);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.clear();
+            for (uint32_t key: wanted) {
+                if ((int) requests.size() >= MAX_PENDING)
+                    break;
+                bool done = std::any_of(finished.begin(), finished.end(),
+                                        [&](const std::pair<uint32_t, TerrainTile>& tile) { return tile.first == key; });
+                if (!done && key != reading)
+                    requests.push_back(key);
+            }
+            pending = (int) (requests.size() + finished.size());
+        }
+        wake.notify_one();
+    }
+
+    // draws the nodes picked by update() with a shader made from terrain.vs
+    void draw(Shader& shader, int unit) const {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, heights);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("heights", unit);
+        shader.setFloat("heightMin", header.heightMin);
+        shader.setFloat("heightRange", header.heightRange);
+        shader.setFloat("cells", (float) (TERRAIN_TILE_SAMPLES - 1));
+        glBindVertexArray(VAO);
+        for (const Node& node: nodes) {
+            float size = header.tileSize * (float) (1 << node.level);
+            float range = lodDistance * (float) (1 << node.level);
+            shader.setVec2("nodeOrigin", glm::vec2(header.originX + node.x * size, header.originZ + node.z * size));
+            shader.setFloat("nodeSize", size);
+            shader.setFloat("layer", (float) node.slot);
+            shader.setVec2("morphRange", glm::vec2(range * morphStart, range));
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+        }
+        glBindVertexArray(0);
+    }
+
+    int drawnNodes() const { return (int) nodes.size(); }
+    int culledNodes() const { return culled; }
+    int pendingTiles() const { return pending; }
+    int residentTiles() const { return (int) resident.size(); }
+    size_t cacheBytes() const {
+        return (size_t) CACHE_TILES * TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES * sizeof(uint16_t);
+    }
+
+private:
+    struct Slot {
+        uint32_t key = 0;
+        bool used = false;
+        int lastUsed = 0;
+        float minHeight = 0.0f, maxHeight = 0.0f;
+    };
+
+    struct Node {
+        int level, x, z, slot;
+    };
+
+    std::string path;
+    TerrainHeader header;
+    bool loaded = false;
+    unsigned int heights = 0;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    int indexCount = 0;
+
+    std::vector<Slot> slots;
+    std::unordered_map<uint32_t, int> resident;
+    int frame = 0;
+
+    glm::vec4 planes[6];
+    glm::vec3 camera = glm::vec3(0.0f);
+    std::vector<Node> nodes;
+    std::vector<uint32_t> wanted;
+    int culled = 0;
+    int pending = 0;
+
+    // shared with the loader thread
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<uint32_t> requests;
+    std::deque<std::pair<uint32_t, TerrainTile>> finished;
+    uint32_t reading = UINT32_MAX;
+    bool quit = false;
+
+    static uint32_t tileKey(int level, int x, int z) {
+        return (uint32_t) level << 26 | (uint32_t) z << 13 | (uint32_t) x;
+    }
+
+    void load() {
+        std::ifstream in(path, std::ios::binary);
+        while (true) {
+            uint32_t key;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                // reading ahead is pointless while the uploads lag behind
+                wake.wait(lock, [this]() { return quit || (!requests.empty() && (int) finished.size() < MAX_PENDING); });
+                if (quit)
+                    return;
+                key = requests.front();
+                requests.pop_front();
+                reading = key;
+            }
+            TerrainTile tile;
+            bool read = readTerrainTile(in, header, key >> 26, key & 0x1fff, (key >> 13) & 0x1fff, tile);
+            std::lock_guard<std::mutex> lock(mutex);
+            reading = UINT32_MAX;
+            if (read)
+                finished.emplace_back(key, std::move(tile));
+        }
+    }
+
+    // puts a tile into the least recently used layer that no node of this frame needs, of those the finest one, as
+    // the coarser tiles are the ones everything else hangs off; with none left the tile is read again later
+    void upload(uint32_t key, const TerrainTile& tile) {
+        if (resident.count(key))
+            return;
+        uint32_t root = tileKey(header.levels - 1, 0, 0);
+        int slot = -1;
+        for (int i = 0; i < CACHE_TILES; i++) {
+            if (!slots[i].used) {
+                slot = i;
+                break;
+            }
+            if (slots[i].key == root || slots[i].lastUsed >= frame)
+                continue;
+            if (slot < 0 || slots[i].lastUsed < slots[slot].lastUsed ||
+                (slots[i].lastUsed == slots[slot].lastUsed && (slots[i].key >> 26) < (slots[slot].key >> 26)))
+                slot = i;
+        }
+        if (slot < 0)
+            return;
+        if (slots[slot].used)
+            resident.erase(slots[slot].key);
+        slots[slot] = {key, true, frame, tile.minHeight, tile.maxHeight};
+        resident[key] = slot;
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, heights);
+        // rows of 33 16 bit samples are not a multiple of 4 bytes long
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slot, TERRAIN_TILE_SAMPLES, TERRAIN_TILE_SAMPLES, 1, GL_RED,
+                        GL_UNSIGNED_SHORT, tile.samples.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    void select(int level, int x, int z) {
+        int slot = resident.at(tileKey(level, x, z));
+        float size = header.tileSize * (float) (1 << level);
+        glm::vec3 low = glm::vec3(header.originX + x * size, slots[slot].minHeight, header.originZ + z * size);
+        glm::vec3 high = glm::vec3(low.x + size, slots[slot].maxHeight, low.z + size);
+        if (!visible(low, high)) {
+            culled++;
+            return;
+        }
+        slots[slot].lastUsed = frame;
+
+        glm::vec3 closest = glm::clamp(camera, low, high);
+        if (level > 0 && glm::length(camera - closest) < lodDistance * (float) (1 << (level - 1))) {
+            bool childrenResident = true;
+            for (int i = 0; i < 4; i++) {
+                uint32_t child = tileKey(level - 1, 2 * x + (i & 1), 2 * z + (i >> 1));
+                if (!resident.count(child)) {
+                    childrenResident = false;
+                    wanted.push_back(child);
+                }
+            }
+            if (childrenResident) {
+                for (int i = 0; i < 4; i++)
+                    select(level - 1, 2 * x + (i & 1), 2 * z + (i >> 1));
+                return;
+            }
+        }
+        nodes.push_back({level, x, z, slot});
+    }
+
+    // planes of the view frustum, pointing inwards (Gribb and Hartmann)
+    void extractPlanes(const glm::mat4& m) {
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+            rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+        for (int i = 0; i < 3; i++) {
+            planes[2 * i] = rows[3] + rows[i];
+            planes[2 * i + 1] = rows[3] - rows[i];
+        }
+    }
+
+    bool visible(const glm::vec3& low, const glm::vec3& high) const {
+        for (const glm::vec4& plane: planes) {
+            // the corner furthest along the plane's normal
+            glm::vec3 corner = glm::vec3(plane.x > 0.0f ? high.x : low.x, plane.y > 0.0f ? high.y : low.y,
+                                         plane.z > 0.0f ? high.z : low.z);
+            if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    // the grid of one tile, in sample coordinates from 0 to TERRAIN_TILE_SAMPLES - 1
+    void buildGrid() {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        const int side = TERRAIN_TILE_SAMPLES;
+        for (int z = 0; z < side; z++)
+            for (int x = 0; x < side; x++)
+                vertices.insert(vertices.end(), {(float) x, (float) z});
+        for (int z = 0; z + 1 < side; z++)
+            for (int x = 0; x + 1 < side; x++) {
+                unsigned int v00 = z * side + x, v10 = v00 + 1, v01 = v00 + side, v11 = v01 + 1;
+                indices.insert(indices.end(), {v00, v01, v10, v10, v01, v11});
+            }
+        indexCount = (int) indices.size();
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*) 0);
+        glBindVertexArray(0);
+    }
+};
+
+#endif //PROJECT_BASE_TERRAIN_H
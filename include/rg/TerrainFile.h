@@ -0,0 +1,84 @@
+#ifndef PROJECT_BASE_TERRAINFILE_H
+#define PROJECT_BASE_TERRAINFILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// The seabed heights written by the terrain builder (tools/terrain_builder.cpp) and streamed by rg/Terrain.h.
+// The terrain is a pyramid of square tiles of TERRAIN_TILE_SAMPLES x TERRAIN_TILE_SAMPLES heights: level 0 has the
+// finest spacing and the most tiles, every level above it has half as many tiles on a side, each covering twice
+// the ground with the same number of samples, up to a single tile over everything. Neighbouring tiles share their
+// edge samples, and a coarser tile takes every other sample of the finer ones, so the vertices of a coarse grid
+// lie exactly on those of the finer grids.
+// All tiles are the same size, so the one to read is found by its index alone, without a table of offsets.
+
+const uint32_t TERRAIN_MAGIC = 0x4e525452; // "RTRN"
+const uint32_t TERRAIN_VERSION = 1;
+const char* const TERRAIN_PATH = "resources/terrain/seabed.terrain";
+
+// samples on a side of every tile, one more than the cells of the grid drawn over it
+const int TERRAIN_TILE_SAMPLES = 33;
+
+struct TerrainHeader {
+    uint32_t magic = TERRAIN_MAGIC;
+    uint32_t version = TERRAIN_VERSION;
+    int32_t levels = 0;
+    // side of a level 0 tile in world units
+    float tileSize = 0.0f;
+    // world position of the corner with the lowest x and z
+    float originX = 0.0f;
+    float originZ = 0.0f;
+    // heights are stored as 16 bit fractions of this range
+    float heightMin = 0.0f;
+    float heightRange = 1.0f;
+
+    int tilesPerSide(int level) const { return 1 << (levels - 1 - level); }
+};
+
+struct TerrainTile {
+    // bounds of the full resolution heights under the tile, not only of its own samples, so that they hold for
+    // every tile below it as well
+    float minHeight = 0.0f;
+    float maxHeight = 0.0f;
+    std::vector<uint16_t> samples;
+};
+
+inline size_t terrainTileBytes() {
+    return 2 * sizeof(float) + TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES * sizeof(uint16_t);
+}
+
+// position of a tile in the file, counting from the coarsest level
+inline size_t terrainTileIndex(const TerrainHeader& header, int level, int x, int z) {
+    size_t index = 0;
+    for (int coarser = header.levels - 1; coarser > level; coarser--)
+        index += (size_t) header.tilesPerSide(coarser) * header.tilesPerSide(coarser);
+    return index + (size_t) z * header.tilesPerSide(level) + x;
+}
+
+inline size_t terrainTileOffset(const TerrainHeader& header, int level, int x, int z) {
+    return sizeof(TerrainHeader) + terrainTileIndex(header, level, x, z) * terrainTileBytes();
+}
+
+inline bool readTerrainHeader(std::ifstream& in, TerrainHeader& header) {
+    in.seekg(0);
+    return in.read((char*) &header, sizeof(header)) && header.magic == TERRAIN_MAGIC &&
+           header.version == TERRAIN_VERSION && header.levels > 0 && header.levels <= 16;
+}
+
+inline bool readTerrainTile(std::ifstream& in, const TerrainHeader& header, int level, int x, int z, TerrainTile& tile) {
+    in.clear();
+    in.seekg((std::streamoff) terrainTileOffset(header, level, x, z));
+    tile.samples.resize(TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES);
+    return in.read((char*) &tile.minHeight, sizeof(float)) && in.read((char*) &tile.maxHeight, sizeof(float)) &&
+           in.read((char*) tile.samples.data(), tile.samples.size() * sizeof(uint16_t));
+}
+
+// tiles have to be written in the order of terrainTileIndex, right after the header
+inline void writeTerrainTile(std::ofstream& out, const TerrainTile& tile) {
+    out.write((const char*) &tile.minHeight, sizeof(float));
+    out.write((const char*) &tile.maxHeight, sizeof(float));
+    out.write((const char*) tile.samples.data(), tile.samples.size() * sizeof(uint16_t));
+}
+
+#endif //PROJECT_BASE_TERRAINFILE_H
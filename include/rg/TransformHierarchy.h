@@ -0,0 +1,144 @@
+#ifndef PROJECT_BASE_TRANSFORMHIERARCHY_H
+#define PROJECT_BASE_TRANSFORMHIERARCHY_H
+
+#include <glm/glm.hpp>
+
+#include <xmmintrin.h>
+
+#include <cmath>
+#include <vector>
+
+// a * b for column major matrices, a column of the result at a time: the columns of a scaled by the four entries
+// of a column of b and summed, four rows at once with SSE
+inline void multiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& result) {
+    __m128 a0 = _mm_loadu_ps(&a[0][0]), a1 = _mm_loadu_ps(&a[1][0]);
+    __m128 a2 = _mm_loadu_ps(&a[2][0]), a3 = _mm_loadu_ps(&a[3][0]);
+    for (int column = 0; column < 4; column++) {
+        const float* entries = &b[column][0];
+        __m128 first = _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(entries[0])), _mm_mul_ps(a1, _mm_set1_ps(entries[1])));
+        __m128 second = _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(entries[2])), _mm_mul_ps(a3, _mm_set1_ps(entries[3])));
+        _mm_storeu_ps(&result[column][0], _mm_add_ps(first, second));
+    }
+}
+
+// A tree of transforms. Every node has a local translation, rotation and scale, applied to its children in that
+// order from the outside in (translate * rotate * scale, like the chains of glm calls they replace), and a world
+// matrix that is its parent's world matrix times its local one. The local parts are kept as structure of arrays.
+// Changing a node marks it dirty; update() then recomputes the world matrices of the dirty nodes and everything
+// below them, and nothing else, so what never moves is computed once. Parents are always added before their
+// children, which lets update() do it all in one pass in the order the nodes were added.
+class TransformHierarchy {
+public:
+    static const int NO_PARENT = -1;
+
+    // a node at the origin of its parent, not rotated or scaled
+    int add(int parent = NO_PARENT) {
+        int node = (int) parents.size();
+        parents.push_back(parent);
+        for (std::vector<float>* array: {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ})
+            array->push_back(0.0f);
+        for (std::vector<float>* array: {&rotationW, &scaleX, &scaleY, &scaleZ})
+            array->push_back(1.0f);
+        worlds.push_back(glm::mat4(1.0f));
+        dirty.push_back(true);
+        changed.push_back(false);
+        anyDirty = true;
+        return node;
+    }
+
+    int size() const { return (int) parents.size(); }
+
+    int parent(int node) const { return parents[node]; }
+
+    void setPosition(int node, const glm::vec3& position) {
+        positionX[node] = position.x;
+        positionY[node] = position.y;
+        positionZ[node] = position.z;
+        markDirty(node);
+    }
+
+    void setScale(int node, const glm::vec3& scale) {
+        scaleX[node] = scale.x;
+        scaleY[node] = scale.y;
+        scaleZ[node] = scale.z;
+        markDirty(node);
+    }
+
+    // replaces the rotation with angle radians around axis
+    void setRotation(int node, float angle, const glm::vec3& axis) {
+        rotationX[node] = rotationY[node] = rotationZ[node] = 0.0f;
+        rotationW[node] = 1.0f;
+        rotate(node, angle, axis);
+    }
+
+    // follows the rotation with another one of angle radians around axis, in the node's rotated space like
+    // glm::rotate()
+    void rotate(int node, float angle, const glm::vec3& axis) {
+        glm::vec3 unit = glm::normalize(axis) * std::sin(angle * 0.5f);
+        float w = std::cos(angle * 0.5f);
+        float x0 = rotationX[node], y0 = rotationY[node], z0 = rotationZ[node], w0 = rotationW[node];
+        rotationX[node] = w0 * unit.x + x0 * w + y0 * unit.z - z0 * unit.y;
+        rotationY[node] = w0 * unit.y - x0 * unit.z + y0 * w + z0 * unit.x;
+        rotationZ[node] = w0 * unit.z + x0 * unit.y - y0 * unit.x + z0 * w;
+        rotationW[node] = w0 * w - x0 * unit.x - y0 * unit.y - z0 * unit.z;
+        markDirty(node);
+    }
+
+    // recomputes the world matrices of what changed since the last update
+    void update() {
+        updated = 0;
+        if (!anyDirty)
+            return;
+        for (int node = 0, count = size(); node < count; node++) {
+            int parent = parents[node];
+            changed[node] = dirty[node] || (parent != NO_PARENT && changed[parent]);
+            if (!changed[node])
+                continue;
+            if (parent == NO_PARENT)
+                worlds[node] = local(node);
+            else
+                multiplyMatrices(worlds[parent], local(node), worlds[node]);
+            dirty[node] = false;
+            updated++;
+        }
+        anyDirty = false;
+    }
+
+    // as of the last update
+    const glm::mat4& world(int node) const { return worlds[node]; }
+
+    // world matrices recomputed by the last update
+    int updatedLastFrame() const { return updated; }
+
+private:
+    std::vector<int> parents;
+    std::vector<float> positionX, positionY, positionZ;
+    // a unit quaternion
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<glm::mat4> worlds;
+    std::vector<bool> dirty, changed;
+    bool anyDirty = false;
+    int updated = 0;
+
+    void markDirty(int node) {
+        dirty[node] = true;
+        anyDirty = true;
+    }
+
+    // translate * rotate * scale
+    glm::mat4 local(int node) const {
+        float x = rotationX[node], y = rotationY[node], z = rotationZ[node], w = rotationW[node];
+        glm::mat4 matrix(1.0f);
+        matrix[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f);
+        matrix[1] = glm::vec4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f);
+        matrix[2] = glm::vec4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f);
+        matrix[0] *= scaleX[node];
+        matrix[1] *= scaleY[node];
+        matrix[2] *= scaleZ[node];
+        matrix[3] = glm::vec4(positionX[node], positionY[node], positionZ[node], 1.0f);
+        return matrix;
+    }
+};
+
+#endif //PROJECT_BASE_TRANSFORMHIERARCHY_H
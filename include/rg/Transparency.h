@@ -0,0 +1,148 @@
+#ifndef PROJECT_BASE_TRANSPARENCY_H
+#define PROJECT_BASE_TRANSPARENCY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+#include <rg/FrameGraph.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+enum TransparencyMode {
+    // weighted blended order independent transparency, nothing is sorted
+    TRANSPARENCY_WEIGHTED,
+    // back to front with plain alpha blending, exact as long as the draws don't intersect
+    TRANSPARENCY_SORTED,
+};
+
+// Draws with alpha blending, collected during the frame and drawn after the opaque scene.
+// A draw is told whether it is drawn for weighted blending, its shader then writes with WriteTransparent() (see
+// blendingShader.fs) into the two targets of WeightedBlendedOIT instead of blending over the scene.
+// For now the only draw is the water, and only while refraction is off; the particles blend on their own after it,
+// since they sample the depth buffer the queue's passes have attached.
+class TransparentQueue {
+public:
+    void clear() { draws.clear(); }
+
+    // viewDepth is the distance in front of the camera the draw is sorted by
+    void submit(float viewDepth, const std::function<void(bool weighted)>& draw) {
+        draws.push_back({viewDepth, draw});
+    }
+
+    bool empty() const { return draws.empty(); }
+
+    size_t size() const { return draws.size(); }
+
+    // in any order, into the targets bound by WeightedBlendedOIT::beginAccumulation()
+    void drawWeighted() const {
+        for (const Draw& draw: draws)
+            draw.draw(true);
+    }
+
+    // back to front over the scene, with the blend state the rest of the scene uses
+    void drawSorted() {
+        sortBackToFront();
+        glDepthMask(GL_FALSE);
+        for (const Draw& draw: draws)
+            draw.draw(false);
+        glDepthMask(GL_TRUE);
+    }
+
+private:
+    struct Draw {
+        float viewDepth;
+        std::function<void(bool)> draw;
+    };
+
+    std::vector<Draw> draws;
+    std::vector<uint32_t> keys, scratchKeys;
+    std::vector<uint32_t> order, scratchOrder;
+
+    // a least significant digit radix sort of the depths, a byte per pass; the bits of a float are made to compare
+    // like unsigned integers by flipping all of them for negative numbers and only the sign for the others, and all
+    // of them once more to have the farthest first
+    void sortBackToFront() {
+        size_t count = draws.size();
+        keys.resize(count);
+        scratchKeys.resize(count);
+        order.resize(count);
+        scratchOrder.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t bits;
+            std::memcpy(&bits, &draws[i].viewDepth, sizeof(bits));
+            bits ^= (bits & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+            keys[i] = ~bits;
+            order[i] = (uint32_t) i;
+        }
+        for (int shift = 0; shift < 32; shift += 8) {
+            size_t offsets[257] = {};
+            for (size_t i = 0; i < count; i++)
+                offsets[((keys[i] >> shift) & 0xff) + 1]++;
+            for (int digit = 0; digit < 256; digit++)
+                offsets[digit + 1] += offsets[digit];
+            for (size_t i = 0; i < count; i++) {
+                size_t to = offsets[(keys[i] >> shift) & 0xff]++;
+                scratchKeys[to] = keys[i];
+                scratchOrder[to] = order[i];
+            }
+            keys.swap(scratchKeys);
+            order.swap(scratchOrder);
+        }
+        std::vector<Draw> sorted;
+        sorted.reserve(count);
+        for (uint32_t i: order)
+            sorted.push_back(std::move(draws[i]));
+        draws.swap(sorted);
+    }
+};
+
+// Weighted blended order independent transparency (McGuire and Bavoil, "Weighted Blended Order-Independent
+// Transparency"): every transparent fragment adds its premultiplied color and its coverage, weighted by how close
+// it is, and multiplies in how much of the scene it lets through. The composite divides the sums by the total
+// weight and blends that average over the scene by what the fragments together let through.
+// GL 3.3 has a single blend function for all draw buffers, so the three sums are spread over the targets by what
+// blending they need: the accumulation target adds in rgb and multiplies in alpha, which holds what is let
+// through, and the total weight is added up in a float target of its own.
+class WeightedBlendedOIT {
+public:
+    static RenderTargetDesc accumulationDesc(int width, int height) { return {width, height, GL_RGBA16F}; }
+
+    static RenderTargetDesc weightDesc(int width, int height) { return {width, height, GL_R16F}; }
+
+    // clears the targets bound for the accumulation, which are tested against the depth of the opaque scene but
+    // never write it
+    static void beginAccumulation() {
+        const float nothing[] = {0.0f, 0.0f, 0.0f, 1.0f};
+        const float zero[] = {0.0f, 0.0f, 0.0f, 0.0f};
+        glClearBufferfv(GL_COLOR, 0, nothing);
+        glClearBufferfv(GL_COLOR, 1, zero);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_BLEND);
+        glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    static void endAccumulation() {
+        glDepthMask(GL_TRUE);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    // over the scene target that is bound
+    static void composite(Shader& compositeShader, unsigned int accumulation, unsigned int weight,
+                          const std::function<void()>& drawQuad) {
+        glDisable(GL_DEPTH_TEST);
+        compositeShader.use();
+        compositeShader.setInt("accumulation", 0);
+        compositeShader.setInt("weight", 1);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, weight);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, accumulation);
+        drawQuad();
+        glEnable(GL_DEPTH_TEST);
+    }
+};
+
+#endif //PROJECT_BASE_TRANSPARENCY_H
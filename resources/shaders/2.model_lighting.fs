@@ -1,7 +1,6 @@
 #version 330 core
-//out vec4 FragColor;
-layout (location = 0) out vec4 FragColor;
-layout (location = 1) out vec4 BrightColor;
+#pragma keywords HAS_SPECULAR_MAP NUM_POINT_LIGHTS FOG SHADOWS LIGHTMAP
+out vec4 FragColor;
 
 struct PointLight {
     vec3 position;
@@ -13,6 +12,10 @@ struct PointLight {
     float constant;
     float linear;
     float quadratic;
+
+    // first of the six layers in pointShadowMap, -1 when the light casts no shadows
+    int shadowLayer;
+    float shadowFarPlane;
 };
 
 struct DirLight {
@@ -25,7 +28,9 @@ struct DirLight {
 
 struct Material {
     sampler2D texture_diffuse1;
+#ifdef HAS_SPECULAR_MAP
     sampler2D texture_specular1;
+#endif
 
     float shininess;
 };
@@ -33,65 +38,173 @@ in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
 
-uniform PointLight pointLight;
-uniform DirLight dirLight;
 uniform Material material;
 
 uniform vec3 viewPosition;
+uniform mat4 view;
+
+#ifdef LIGHTMAP
+in vec2 LightmapCoords;
+// rgb sun, sky and bounced light, a ambient occlusion, see tools/lightmap_baker.cpp
+uniform sampler2D lightmap;
+#else
+uniform DirLight dirLight;
+#endif
+
+#if NUM_POINT_LIGHTS > 0
+uniform PointLight pointLights[NUM_POINT_LIGHTS];
+#endif
+
+#ifdef FOG
+uniform vec3 fogColor;
+uniform float fogDensity;
+#endif
+
+#if defined(SHADOWS) && !defined(LIGHTMAP)
+const int NUM_CASCADES = 4;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 cascadeMatrices[NUM_CASCADES];
+uniform float cascadeSplits[NUM_CASCADES];
+uniform float shadowTexelSize;
+
+// 0 when the fragment is in the sun's shadow, 1 when it is fully lit
+float CalcShadow(vec3 fragPos)
+{
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int cascade = 0;
+    while (cascade < NUM_CASCADES && depth > cascadeSplits[cascade])
+        cascade++;
+    if (cascade == NUM_CASCADES)
+        return 1.0;
+
+    vec4 lightSpacePos = cascadeMatrices[cascade] * vec4(fragPos, 1.0);
+    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+    if (projCoords.z > 1.0)
+        return 1.0;
+    // 3x3 PCF, every tap is additionally filtered by the hardware comparison
+    float shadow = 0.0;
+    for (int x = -1; x <= 1; ++x)
+        for (int y = -1; y <= 1; ++y)
+            shadow += texture(shadowMap, vec4(projCoords.xy + vec2(x, y) * shadowTexelSize, float(cascade), projCoords.z - 0.0005));
+    return shadow / 9.0;
+}
+#else
+float CalcShadow(vec3 fragPos)
+{
+    return 1.0;
+}
+#endif
+
+#if defined(SHADOWS) && NUM_POINT_LIGHTS > 0
+uniform sampler2DArrayShadow pointShadowMap;
+
+// 0 when the fragment is in the shadow of the point light, 1 when it is lit
+float CalcPointShadow(PointLight light, vec3 fragPos)
+{
+    if (light.shadowLayer < 0)
+        return 1.0;
+    vec3 fragToLight = fragPos - light.position;
+    float depth = length(fragToLight) / light.shadowFarPlane;
+    if (depth > 1.0)
+        return 1.0;
+
+    // pick the cube face and its coordinates the same way cube map lookups do
+    vec3 a = abs(fragToLight);
+    int face;
+    float major;
+    vec2 st;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = fragToLight.x > 0.0 ? 0 : 1;
+        major = a.x;
+        st = vec2(fragToLight.x > 0.0 ? -fragToLight.z : fragToLight.z, -fragToLight.y);
+    } else if (a.y >= a.z) {
+        face = fragToLight.y > 0.0 ? 2 : 3;
+        major = a.y;
+        st = vec2(fragToLight.x, fragToLight.y > 0.0 ? fragToLight.z : -fragToLight.z);
+    } else {
+        face = fragToLight.z > 0.0 ? 4 : 5;
+        major = a.z;
+        st = vec2(fragToLight.z > 0.0 ? fragToLight.x : -fragToLight.x, -fragToLight.y);
+    }
+    vec2 uv = st / major * 0.5 + 0.5;
+    return texture(pointShadowMap, vec4(uv, float(light.shadowLayer + face), depth - 0.005));
+}
+#else
+float CalcPointShadow(PointLight light, vec3 fragPos)
+{
+    return 1.0;
+}
+#endif
+
 // calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, float occlusion)
 {
     vec3 lightDir = normalize(light.position - fragPos);
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    //float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
     // attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
     // attenuation (use quadratic as we have gamma correction)
     //result *= 1.0 / (distance * distance);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
+    vec3 ambient = light.ambient * albedo * occlusion;
+    vec3 diffuse = light.diffuse * diff * albedo;
+#ifdef HAS_SPECULAR_MAP
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
     vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords).xxx);
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
-    return (ambient + diffuse + specular);
+#else
+    vec3 specular = vec3(0.0);
+#endif
+    float shadow = CalcPointShadow(light, fragPos);
+    return attenuation * (ambient + shadow * (diffuse + specular));
 }
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+#ifndef LIGHTMAP
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 albedo, float shadow)
 {
     vec3 lightDir = normalize(-light.direction);
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
+    // combine results
+    vec3 ambient  = light.ambient  * albedo;
+    vec3 diffuse  = light.diffuse  * diff * albedo;
+#ifdef HAS_SPECULAR_MAP
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // combine results
-    vec3 ambient  = light.ambient  * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.texture_diffuse1, TexCoords));
     vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
-    return (ambient + diffuse + specular);
+#else
+    vec3 specular = vec3(0.0);
+#endif
+    return (ambient + shadow * (diffuse + specular));
 }
+#endif
 
 void main()
 {
     vec3 normal = normalize(Normal);
     vec3 viewDir = normalize(viewPosition - FragPos);
-    vec3 result = CalcDirLight(dirLight, normal, viewDir);
-    result += CalcPointLight(pointLight, normal, FragPos, viewDir);
-
-    // check whether result is higher than some threshold, if so, output as bloom threshold color
-    float brightness = dot(result, vec3(0.2126, 0.7152, 0.0722));
-    if(brightness > 1.3)
-        BrightColor = vec4(result, 1.0);
-    else
-        BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
+    vec3 albedo = vec3(texture(material.texture_diffuse1, TexCoords));
+#ifdef LIGHTMAP
+    // the sun, the sky and what bounces off the static objects were baked
+    vec4 baked = texture(lightmap, LightmapCoords);
+    vec3 result = baked.rgb * albedo;
+    float occlusion = baked.a;
+#else
+    vec3 result = CalcDirLight(dirLight, normal, viewDir, albedo, CalcShadow(FragPos));
+    float occlusion = 1.0;
+#endif
+#if NUM_POINT_LIGHTS > 0
+    for (int i = 0; i < NUM_POINT_LIGHTS; i++)
+        result += CalcPointLight(pointLights[i], normal, FragPos, viewDir, albedo, occlusion);
+#endif
+#ifdef FOG
+    float fogDistance = length(viewPosition - FragPos) * fogDensity;
+    result = mix(fogColor, result, exp(-fogDistance * fogDistance));
+#endif
 
     FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+}
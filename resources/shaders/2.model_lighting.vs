@@ -1,4 +1,5 @@
 #version 330 core
+#pragma keywords LIGHTMAP INSTANCED
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
@@ -11,10 +12,35 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+#ifdef LIGHTMAP
+layout (location = 5) in vec2 aLightmapCoords;
+out vec2 LightmapCoords;
+#ifndef INSTANCED
+// rectangle of this instance in the lightmap atlas, xy scale and zw offset
+uniform vec4 lightmapScaleOffset;
+#endif
+#endif
+
+#ifdef INSTANCED
+// instanceTransform() and the attributes at 6 to 9 come from instanceAnimation.glsl; model places the mesh within
+// the instance
+#ifdef LIGHTMAP
+layout (location = 10) in vec4 lightmapScaleOffset;
+#endif
+#endif
+
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+#ifdef INSTANCED
+    mat4 world = instanceTransform(time) * model;
+#else
+    mat4 world = model;
+#endif
+    FragPos = vec3(world * vec4(aPos, 1.0));
     Normal = aNormal;
     TexCoords = aTexCoords;    
+#ifdef LIGHTMAP
+    LightmapCoords = aLightmapCoords * lightmapScaleOffset.xy + lightmapScaleOffset.zw;
+#endif
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
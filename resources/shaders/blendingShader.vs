@@ -3,6 +3,7 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
 
 out vec2 TexCoords;
+out vec3 WorldPos;
 
 uniform mat4 model;
 uniform mat4 view;
@@ -11,5 +12,6 @@ uniform mat4 projection;
 void main()
 {
     TexCoords = aTexCoords;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    WorldPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(WorldPos, 1.0);
+}
@@ -0,0 +1,86 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+uniform vec2 sourceTexelSize;
+// the first level reads the scene: it keeps only what is brighter than threshold and uses the Karis average
+uniform bool firstLevel;
+uniform float threshold;
+
+float KarisWeight(vec3 color)
+{
+    return 1.0 / (1.0 + dot(color, vec3(0.2126, 0.7152, 0.0722)));
+}
+
+// the first level thresholds each of the 6x6 scene texels the taps cover on its own, before any of them are
+// filtered together, and does the bilinear filtering of the taps by hand: a bilinear fetch would mix a bright texel
+// with its neighbours before the threshold and let it through at a fraction of its strength, or not at all
+vec3 texels[36];
+vec2 fraction;
+
+void FetchBright()
+{
+    vec2 position = TexCoords / sourceTexelSize - 0.5;
+    ivec2 first = ivec2(floor(position)) - 2;
+    ivec2 last = textureSize(source, 0) - 1;
+    fraction = fract(position);
+    for (int y = 0; y < 6; y++)
+        for (int x = 0; x < 6; x++) {
+            vec3 color = texelFetch(source, clamp(first + ivec2(x, y), ivec2(0), last), 0).rgb;
+            texels[y * 6 + x] = dot(color, vec3(0.2126, 0.7152, 0.0722)) <= threshold ? vec3(0.0) : color;
+        }
+}
+
+// a tap offset texels away
+vec3 Sample(vec2 offset)
+{
+    if (!firstLevel)
+        return texture(source, TexCoords + sourceTexelSize * offset).rgb;
+    int i = (int(offset.y) + 2) * 6 + int(offset.x) + 2;
+    return mix(mix(texels[i], texels[i + 1], fraction.x), mix(texels[i + 6], texels[i + 7], fraction.x), fraction.y);
+}
+
+// 13 bilinear taps covering a 6x6 texel area, weighted as five overlapping 2x2 boxes
+void main()
+{
+    if (firstLevel)
+        FetchBright();
+    vec3 a = Sample(vec2(-2.0,  2.0));
+    vec3 b = Sample(vec2( 0.0,  2.0));
+    vec3 c = Sample(vec2( 2.0,  2.0));
+    vec3 d = Sample(vec2(-2.0,  0.0));
+    vec3 e = Sample(vec2( 0.0,  0.0));
+    vec3 f = Sample(vec2( 2.0,  0.0));
+    vec3 g = Sample(vec2(-2.0, -2.0));
+    vec3 h = Sample(vec2( 0.0, -2.0));
+    vec3 i = Sample(vec2( 2.0, -2.0));
+    vec3 j = Sample(vec2(-1.0,  1.0));
+    vec3 k = Sample(vec2( 1.0,  1.0));
+    vec3 l = Sample(vec2(-1.0, -1.0));
+    vec3 m = Sample(vec2( 1.0, -1.0));
+
+    vec3 center = (j + k + l + m) * 0.25;
+    vec3 topLeft = (a + b + d + e) * 0.25;
+    vec3 topRight = (b + c + e + f) * 0.25;
+    vec3 bottomLeft = (d + e + g + h) * 0.25;
+    vec3 bottomRight = (e + f + h + i) * 0.25;
+
+    vec3 result;
+    if (firstLevel) {
+        float wc = 0.5 * KarisWeight(center);
+        float wtl = 0.125 * KarisWeight(topLeft);
+        float wtr = 0.125 * KarisWeight(topRight);
+        float wbl = 0.125 * KarisWeight(bottomLeft);
+        float wbr = 0.125 * KarisWeight(bottomRight);
+        result = (center * wc + topLeft * wtl + topRight * wtr + bottomLeft * wbl + bottomRight * wbr)
+                 / (wc + wtl + wtr + wbl + wbr);
+    } else {
+        result = center * 0.5 + (topLeft + topRight + bottomLeft + bottomRight) * 0.125;
+    }
+    // nothing bright around, the pixel stays cleared and isn't counted by the occlusion query
+    if (firstLevel && result == vec3(0.0))
+        discard;
+    FragColor = vec4(max(result, vec3(0.0001)), 1.0);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+uniform float filterRadius;
+
+// 3x3 tent, the result is added onto the larger level by blending
+void main()
+{
+    float x = filterRadius;
+    float y = filterRadius;
+    vec3 result = texture(source, TexCoords).rgb * 4.0;
+    result += (texture(source, TexCoords + vec2(-x, 0.0)).rgb + texture(source, TexCoords + vec2(x, 0.0)).rgb
+             + texture(source, TexCoords + vec2(0.0, -y)).rgb + texture(source, TexCoords + vec2(0.0, y)).rgb) * 2.0;
+    result += texture(source, TexCoords + vec2(-x, -y)).rgb + texture(source, TexCoords + vec2(x, -y)).rgb
+            + texture(source, TexCoords + vec2(-x, y)).rgb + texture(source, TexCoords + vec2(x, y)).rgb;
+    FragColor = vec4(result / 16.0, 1.0);
+}
@@ -0,0 +1,48 @@
+#version 430 core
+// a work group blurs TILE (rg/ComputeBlur.h) pixels of one row, or of one column for the vertical pass
+layout (local_size_x = 128) in;
+
+layout (binding = 0) uniform sampler2D image;
+// IMAGE_FORMAT is defined by rg/ComputeBlur.h to the format of the target
+layout (binding = 0, IMAGE_FORMAT) uniform writeonly image2D result;
+
+uniform bool horizontal;
+// the first pass reads the scene and keeps only the texels brighter than threshold
+uniform bool brightPass;
+uniform float threshold;
+
+// Gaussian weights of single texels built at runtime, see rg/GaussianKernel.h
+const int MAX_RADIUS = 30;
+uniform int radius;
+uniform float weights[MAX_RADIUS + 1];
+
+// the run of pixels and the radius on either side of it, every texel fetched once for the whole group
+shared vec3 tile[128 + 2 * MAX_RADIUS];
+
+void main()
+{
+    const int TILE = 128;
+    ivec2 size = textureSize(image, 0);
+    ivec2 along = horizontal ? ivec2(1, 0) : ivec2(0, 1);
+    ivec2 line = (ivec2(1) - along) * int(gl_WorkGroupID.y);
+    int extent = horizontal ? size.x : size.y;
+    int start = int(gl_WorkGroupID.x) * TILE;
+    int local = int(gl_LocalInvocationID.x);
+
+    for (int i = local; i < TILE + 2 * radius; i += TILE) {
+        int position = clamp(start - radius + i, 0, extent - 1);
+        vec3 color = texelFetch(image, line + along * position, 0).rgb;
+        if (brightPass && dot(color, vec3(0.2126, 0.7152, 0.0722)) <= threshold)
+            color = vec3(0.0);
+        tile[i] = color;
+    }
+    barrier();
+
+    if (start + local >= extent)
+        return;
+    int center = local + radius;
+    vec3 sum = tile[center] * weights[0];
+    for (int i = 1; i <= radius; i++)
+        sum += (tile[center - i] + tile[center + i]) * weights[i];
+    imageStore(result, line + along * (start + local), vec4(sum, 1.0));
+}
@@ -6,27 +6,46 @@ in vec2 TexCoords;
 uniform sampler2D image;
 
 uniform bool horizontal;
-uniform float weight[5] = float[] (0.2270270270, 0.1945945946, 0.1216216216, 0.0540540541, 0.0162162162);
+// the first pass reads the scene and keeps only what is brighter than threshold
+uniform bool brightPass;
+uniform float threshold;
 
-void main()
+// linear sampled Gaussian built at runtime, see rg/GaussianKernel.h
+const int MAX_TAPS = 16;
+uniform int taps;
+uniform float offsets[MAX_TAPS];
+uniform float weights[MAX_TAPS];
+
+// the scene texel at the given offset, if it is brighter than threshold
+vec3 Bright(ivec2 texel)
+{
+     vec3 color = texelFetch(image, clamp(texel, ivec2(0), textureSize(image, 0) - 1), 0).rgb;
+     return dot(color, vec3(0.2126, 0.7152, 0.0722)) <= threshold ? vec3(0.0) : color;
+}
+
+// a tap offset texels away along the blur. The bright pass thresholds the two texels of a linear sampled tap each
+// on its own and blends them by hand, a bilinear fetch would mix a bright texel with its neighbour before the
+// threshold and let it through at a fraction of its strength, or not at all
+vec3 Sample(float offset)
 {
      vec2 tex_offset = 1.0 / textureSize(image, 0); // gets size of single texel
-     vec3 result = texture(image, TexCoords).rgb * weight[0];
-     if(horizontal)
-     {
-         for(int i = 1; i < 5; ++i)
-         {
-            result += texture(image, TexCoords + vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
-            result += texture(image, TexCoords - vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
-         }
-     }
-     else
+     vec2 direction = horizontal ? vec2(tex_offset.x, 0.0) : vec2(0.0, tex_offset.y);
+     if (!brightPass)
+          return texture(image, TexCoords + direction * offset).rgb;
+     // the target is the size of the scene, every pixel is at the center of a scene texel
+     ivec2 texel = ivec2(gl_FragCoord.xy);
+     ivec2 along = horizontal ? ivec2(1, 0) : ivec2(0, 1);
+     float first = floor(offset);
+     return mix(Bright(texel + along * int(first)), Bright(texel + along * (int(first) + 1)), offset - first);
+}
+
+void main()
+{
+     vec3 result = (brightPass ? Bright(ivec2(gl_FragCoord.xy)) : Sample(0.0)) * weights[0];
+     for(int i = 1; i < taps; ++i)
      {
-         for(int i = 1; i < 5; ++i)
-         {
-             result += texture(image, TexCoords + vec2(0.0, tex_offset.y * i)).rgb * weight[i];
-             result += texture(image, TexCoords - vec2(0.0, tex_offset.y * i)).rgb * weight[i];
-         }
+         result += Sample(offsets[i]) * weights[i];
+         result += Sample(-offsets[i]) * weights[i];
      }
      FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+}
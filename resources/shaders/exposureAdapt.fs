@@ -0,0 +1,52 @@
+#version 330 core
+out float Exposure;
+
+uniform sampler2D histogram;
+uniform sampler2D previousExposure;
+uniform int bins;
+uniform float minLogLuminance;
+uniform float logLuminanceRange;
+uniform float lowPercentile;
+uniform float highPercentile;
+uniform float key;
+uniform float compensation;
+uniform float minExposure;
+uniform float maxExposure;
+uniform float speedUp;
+uniform float speedDown;
+uniform float deltaTime;
+
+void main()
+{
+    float total = 0.0;
+    for (int i = 0; i < bins; i++)
+        total += texelFetch(histogram, ivec2(i, 0), 0).r;
+
+    // average log luminance of the part of the histogram between the two percentiles
+    float low = lowPercentile * total;
+    float high = highPercentile * total;
+    float below = 0.0;
+    float sum = 0.0;
+    float weight = 0.0;
+    for (int i = 0; i < bins; i++) {
+        float count = texelFetch(histogram, ivec2(i, 0), 0).r;
+        float inside = max(min(below + count, high) - max(below, low), 0.0);
+        float logLuminance = minLogLuminance + (float(i) + 0.5) / float(bins) * logLuminanceRange;
+        sum += inside * logLuminance;
+        weight += inside;
+        below += count;
+    }
+
+    float previous = texelFetch(previousExposure, ivec2(0, 0), 0).r;
+    if (weight <= 0.0) {
+        Exposure = previous;
+        return;
+    }
+    float averageLuminance = exp2(sum / weight);
+    float target = clamp(key * exp2(compensation) / averageLuminance, minExposure, maxExposure);
+
+    // adapt in log space so brightening and darkening by the same factor take the same time
+    float speed = target > previous ? speedUp : speedDown;
+    float blend = 1.0 - exp(-deltaTime * speed);
+    Exposure = exp2(mix(log2(previous), log2(target), blend));
+}
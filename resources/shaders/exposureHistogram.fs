@@ -0,0 +1,8 @@
+#version 330 core
+out float Count;
+
+// added up by blending, see rg/AutoExposure.h
+void main()
+{
+    Count = 1.0;
+}
@@ -0,0 +1,14 @@
+#version 330 core
+// one point per texel of the luminance texture, no vertex attributes
+uniform sampler2D luminance;
+uniform int bins;
+uniform float minLogLuminance;
+uniform float logLuminanceRange;
+
+void main()
+{
+    ivec2 size = textureSize(luminance, 0);
+    float logLuminance = texelFetch(luminance, ivec2(gl_VertexID % size.x, gl_VertexID / size.x), 0).r;
+    float bin = floor(clamp((logLuminance - minLogLuminance) / logLuminanceRange, 0.0, 0.999999) * float(bins));
+    gl_Position = vec4((bin + 0.5) / float(bins) * 2.0 - 1.0, 0.0, 0.0, 1.0);
+}
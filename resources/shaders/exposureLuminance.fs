@@ -0,0 +1,24 @@
+#version 330 core
+out float LogLuminance;
+
+in vec2 TexCoords;
+
+uniform sampler2D scene;
+// size of the block of the scene one output texel stands for, in texture coordinates
+uniform vec2 blockSize;
+
+float LogLuminanceAt(vec2 coords)
+{
+    vec3 color = texture(scene, coords).rgb;
+    return log2(max(dot(color, vec3(0.2126, 0.7152, 0.0722)), 0.00001));
+}
+
+// four bilinear taps spread over the block
+void main()
+{
+    vec2 quarter = 0.25 * blockSize;
+    LogLuminance = 0.25 * (LogLuminanceAt(TexCoords + vec2(-quarter.x, -quarter.y))
+                         + LogLuminanceAt(TexCoords + vec2( quarter.x, -quarter.y))
+                         + LogLuminanceAt(TexCoords + vec2(-quarter.x,  quarter.y))
+                         + LogLuminanceAt(TexCoords + vec2( quarter.x,  quarter.y)));
+}
@@ -1,23 +1,86 @@
 #version 330 core
+#pragma keywords FXAA VIGNETTE
 out vec4 FragColor;
 
 in vec2 TexCoords;
 
+// everything after the bloom in one pass: bloom composite, exposure, then tonemapping, grading and gamma through
+// the lookup table of rg/ColorGrading.h, and the optional effects as variants
 uniform sampler2D scene;
 uniform sampler2D bloomBlur;
 uniform bool bloom;
+uniform float bloomStrength;
 uniform float exposure;
+// 1x1 exposure written by the auto exposure passes, see rg/AutoExposure.h
+uniform bool autoExposure;
+uniform sampler2D exposureTexture;
 
-void main()
+uniform sampler3D colorLut;
+uniform float lutMinLog;
+uniform float lutLogRange;
+uniform float lutSize;
+
+#ifdef VIGNETTE
+uniform float vignetteIntensity;
+#endif
+
+float sceneExposure;
+
+// final display color at a point of the scene
+vec3 Graded(vec2 coords)
 {
-    const float gamma = 1.4;
-    vec3 hdrColor = texture(scene, TexCoords).rgb;
-    vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
+    vec3 hdrColor = texture(scene, coords).rgb;
     if(bloom)
-        hdrColor += bloomColor; // additive blending
-    // tone mapping
-    vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
-    // also gamma correct while we're at it
-    result = pow(result, vec3(1.0 / gamma));
+        hdrColor += texture(bloomBlur, coords).rgb * bloomStrength; // additive blending
+    vec3 encoded = clamp((log2(max(hdrColor * sceneExposure, vec3(1e-8))) - lutMinLog) / lutLogRange, 0.0, 1.0);
+    // keep to the texel centers at the ends of the table
+    return texture(colorLut, encoded * ((lutSize - 1.0) / lutSize) + 0.5 / lutSize).rgb;
+}
+
+#ifdef FXAA
+const float FXAA_SPAN_MAX = 8.0;
+const float FXAA_REDUCE_MUL = 1.0 / 8.0;
+const float FXAA_REDUCE_MIN = 1.0 / 128.0;
+const vec3 LUMA = vec3(0.299, 0.587, 0.114);
+
+// the low quality FXAA: the local contrast picks the edge direction, then two or four taps along it are blended
+vec3 Fxaa(vec2 coords)
+{
+    vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+    vec3 rgbM = Graded(coords);
+    float lumaNW = dot(Graded(coords + vec2(-1.0, -1.0) * texel), LUMA);
+    float lumaNE = dot(Graded(coords + vec2( 1.0, -1.0) * texel), LUMA);
+    float lumaSW = dot(Graded(coords + vec2(-1.0,  1.0) * texel), LUMA);
+    float lumaSE = dot(Graded(coords + vec2( 1.0,  1.0) * texel), LUMA);
+    float lumaM = dot(rgbM, LUMA);
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    if (lumaMax - lumaMin < max(0.0312, lumaMax * 0.125))
+        return rgbM;
+
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * (0.25 * FXAA_REDUCE_MUL), FXAA_REDUCE_MIN);
+    float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, vec2(-FXAA_SPAN_MAX), vec2(FXAA_SPAN_MAX)) * texel;
+
+    vec3 rgbA = 0.5 * (Graded(coords + dir * (1.0 / 3.0 - 0.5)) + Graded(coords + dir * (2.0 / 3.0 - 0.5)));
+    vec3 rgbB = rgbA * 0.5 + 0.25 * (Graded(coords - dir * 0.5) + Graded(coords + dir * 0.5));
+    float lumaB = dot(rgbB, LUMA);
+    return lumaB < lumaMin || lumaB > lumaMax ? rgbA : rgbB;
+}
+#endif
+
+void main()
+{
+    sceneExposure = autoExposure ? texelFetch(exposureTexture, ivec2(0, 0), 0).r : exposure;
+#ifdef FXAA
+    vec3 result = Fxaa(TexCoords);
+#else
+    vec3 result = Graded(TexCoords);
+#endif
+#ifdef VIGNETTE
+    vec2 fromCenter = TexCoords - 0.5;
+    result *= 1.0 - vignetteIntensity * smoothstep(0.2, 0.8, dot(fromCenter, fromCenter) * 2.0);
+#endif
     FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,52 @@
+// Placing an instance of rg/InstanceBuffer.h, put in front of every INSTANCED vertex shader by rg/ShaderVariants.h,
+// so whatever draws the instances (color, reflection, velocity, shadows) places them the same way.
+
+// a model matrix, or for an animation the center and the spline plus one, then radius, phase, speed and scale
+layout (location = 6) in vec4 aInstance0;
+layout (location = 7) in vec4 aInstance1;
+layout (location = 8) in vec4 aInstance2;
+layout (location = 9) in vec4 aInstance3;
+uniform float time;
+// closed Catmull-Rom splines, the control points of spline i from splines[i].x on, splines[i].y of them
+uniform vec3 splinePoints[32];
+uniform ivec2 splines[2];
+
+// position, velocity and acceleration u loops into a spline, the derivatives per loop
+void evaluateSpline(int id, float u, out vec3 position, out vec3 velocity, out vec3 acceleration)
+{
+    ivec2 spline = splines[id];
+    float segment = fract(u) * float(spline.y);
+    int i = min(int(segment), spline.y - 1);
+    float t = segment - float(i);
+    vec3 p0 = splinePoints[spline.x + (i + spline.y - 1) % spline.y];
+    vec3 p1 = splinePoints[spline.x + i];
+    vec3 p2 = splinePoints[spline.x + (i + 1) % spline.y];
+    vec3 p3 = splinePoints[spline.x + (i + 2) % spline.y];
+    vec3 b = p2 - p0;
+    vec3 c = 2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3;
+    vec3 d = 3.0 * (p1 - p2) + p3 - p0;
+    position = p1 + 0.5 * t * (b + t * (c + t * d));
+    velocity = 0.5 * (b + t * (2.0 * c + t * 3.0 * d)) * float(spline.y);
+    acceleration = (c + 3.0 * t * d) * float(spline.y * spline.y);
+}
+
+// the transform of the instance at the given time, time itself for where it is drawn this frame
+mat4 instanceTransform(float atTime)
+{
+    if (aInstance0.w == 0.0)
+        return mat4(aInstance0, aInstance1, aInstance2, aInstance3);
+    float radius = aInstance1.x, speed = aInstance1.z, scale = aInstance1.w;
+    vec3 position, velocity, acceleration;
+    evaluateSpline(int(aInstance0.w) - 1, aInstance1.y + speed * atTime, position, velocity, acceleration);
+    vec3 stretch = vec3(radius, 1.0, radius);
+    // facing along the path (the other way round when flown backwards), banked into the turns by the pull
+    // sideways, at most about 45 degrees
+    vec3 forward = normalize(velocity * stretch * sign(speed));
+    vec3 side = normalize(cross(vec3(0.0, 1.0, 0.0), forward));
+    vec3 up = cross(forward, side);
+    float bank = clamp(dot(acceleration * stretch, side) * speed * speed / 9.81, -0.8, 0.8);
+    vec3 bankedSide = cos(bank) * side - sin(bank) * up;
+    vec3 bankedUp = cos(bank) * up + sin(bank) * side;
+    return mat4(vec4(bankedSide * scale, 0.0), vec4(bankedUp * scale, 0.0), vec4(forward * scale, 0.0),
+                vec4(aInstance0.xyz + position * stretch, 1.0));
+}
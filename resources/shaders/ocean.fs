@@ -0,0 +1,100 @@
+#version 330 core
+layout (location = 0) out vec4 FragColor;
+// the total weight of the weighted blended transparency, see WriteTransparent()
+layout (location = 1) out vec4 TransparentWeight;
+
+in vec2 TexCoords;
+in vec2 OceanCoords;
+in vec3 WorldPos;
+
+uniform sampler2D texture1;
+// slopes of the simulated surface, see rg/Ocean.h
+uniform sampler2D slopes;
+// the scene mirrored in the water, see rg/PlanarReflection.h
+uniform sampler2D reflection;
+uniform bool reflectionEnabled;
+// the camera the reflection was rendered for
+uniform mat4 reflectionViewProjection;
+uniform vec3 viewPosition;
+// drawn into the targets of weighted blended transparency instead of over the scene, see rg/Transparency.h
+uniform bool weightedBlended;
+// how far the waves push the reflection around, in texture coordinates
+uniform float distortion;
+// small waves around the camera, see rg/RippleSimulation.h
+uniform sampler2D ripples;
+uniform bool ripplesEnabled;
+uniform vec2 rippleOrigin;
+uniform float rippleSize;
+// the opaque scene behind the water, half size, with its depth in alpha, see refractionCopy.fs
+uniform sampler2D refraction;
+uniform bool refractionEnabled;
+uniform vec2 screenSize;
+uniform mat4 view;
+// how far the waves bend what is seen through the water, in texture coordinates
+uniform float refractionStrength;
+// light lost per unit of water it goes through, red first
+uniform vec3 absorption;
+
+vec2 RippleSlope(vec3 position)
+{
+    if (!ripplesEnabled)
+        return vec2(0.0);
+    vec2 uv = (position.xz - rippleOrigin) / rippleSize;
+    vec2 texel = 1.0 / vec2(textureSize(ripples, 0));
+    vec2 slope = vec2(texture(ripples, uv + vec2(texel.x, 0.0)).r - texture(ripples, uv - vec2(texel.x, 0.0)).r,
+                      texture(ripples, uv + vec2(0.0, texel.y)).r - texture(ripples, uv - vec2(0.0, texel.y)).r);
+    return slope / (2.0 * texel * rippleSize);
+}
+
+// what is seen through the water, fading into the color of the water itself the more of it is in the way
+vec3 Refracted(vec2 slope, vec3 waterColor)
+{
+    vec2 screen = gl_FragCoord.xy / screenSize;
+    float surfaceDepth = -(view * vec4(WorldPos, 1.0)).z;
+    vec4 behind = textureLod(refraction, clamp(screen + slope * refractionStrength, 0.001, 0.999), 0.0);
+    // the bent ray landed on something in front of the water, what is straight behind it has to do
+    if (behind.a < surfaceDepth)
+        behind = textureLod(refraction, screen, 0.0);
+    vec3 transmittance = exp(-absorption * max(behind.a - surfaceDepth, 0.0));
+    return mix(waterColor, behind.rgb, transmittance);
+}
+
+// blends over the scene, or adds to the sums of weighted blended transparency with a weight falling off with the
+// distance from the camera (equation 7 of McGuire and Bavoil), so nearer surfaces count for more
+void WriteTransparent(vec4 color)
+{
+    if (!weightedBlended) {
+        FragColor = color;
+        return;
+    }
+    float viewDepth = 1.0 / gl_FragCoord.w;
+    float weight = color.a * clamp(10.0 / (1e-5 + pow(viewDepth / 5.0, 2.0) + pow(viewDepth / 200.0, 6.0)), 1e-2, 3e3);
+    FragColor = vec4(color.rgb * weight, color.a);
+    TransparentWeight = vec4(weight);
+}
+
+void main()
+{
+    vec4 tmp = texture(texture1, TexCoords);
+    tmp.a *= 0.7;
+    vec2 slope = texture(slopes, OceanCoords).xy + RippleSlope(WorldPos);
+    vec3 normal = normalize(vec3(-slope.x, 1.0, -slope.y));
+    // some light from the sky on the side of the waves facing it, as there is nothing to reflect when it is off
+    tmp.rgb *= 0.8 + 0.2 * normal.y;
+    // with refraction the water is opaque, it draws what is behind it itself
+    if (refractionEnabled)
+        tmp = vec4(Refracted(slope, tmp.rgb), 1.0);
+    if (!reflectionEnabled) {
+        WriteTransparent(tmp);
+        return;
+    }
+
+    vec4 projected = reflectionViewProjection * vec4(WorldPos, 1.0);
+    vec2 reflectionCoords = projected.xy / projected.w * 0.5 + 0.5 + slope * distortion;
+    vec3 reflected = texture(reflection, clamp(reflectionCoords, 0.001, 0.999)).rgb;
+
+    // Schlick's approximation for water
+    float cosine = max(dot(normalize(viewPosition - WorldPos), normal), 0.0);
+    float fresnel = 0.02 + 0.98 * pow(1.0 - cosine, 5.0);
+    WriteTransparent(vec4(mix(tmp.rgb, reflected, fresnel), mix(tmp.a, 1.0, fresnel)));
+}
@@ -0,0 +1,39 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aMorph;
+
+out vec2 TexCoords;
+out vec2 OceanCoords;
+out vec3 WorldPos;
+
+// see rg/Ocean.h
+uniform sampler2D displacement;
+uniform float patchLength;
+uniform vec2 center;
+uniform float level;
+// half the side of the mesh, the waves flatten out towards its edge
+uniform float extent;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+vec3 Displacement(vec2 position)
+{
+    return textureLod(displacement, position / patchLength, 0.0).xyz;
+}
+
+void main()
+{
+    vec2 position = center + aPos;
+    // vertices between two of the coarser level's take the average of theirs, so the edge stays straight
+    vec3 offset = aMorph == vec2(0.0)
+            ? Displacement(position)
+            : 0.5 * (Displacement(position - aMorph) + Displacement(position + aMorph));
+    float fade = 1.0 - smoothstep(0.6 * extent, extent, max(abs(aPos.x), abs(aPos.y)));
+
+    // same tiling the flat water quad had
+    TexCoords = position * 0.15;
+    OceanCoords = position / patchLength;
+    WorldPos = vec3(position.x, level, position.y) + offset * fade;
+    gl_Position = projection * view * vec4(WorldPos, 1.0);
+}
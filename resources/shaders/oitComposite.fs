@@ -0,0 +1,19 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// the sums of the transparent fragments, see rg/Transparency.h
+uniform sampler2D accumulation;
+uniform sampler2D weight;
+
+void main()
+{
+    vec4 sums = texture(accumulation, TexCoords);
+    // what all the transparent fragments together let through of the scene
+    float revealage = sums.a;
+    if (revealage >= 1.0)
+        discard;
+    // the weighted average of their colors, blended over the scene by how much of it they cover
+    FragColor = vec4(sums.rgb / max(texture(weight, TexCoords).r, 1e-5), 1.0 - revealage);
+}
@@ -0,0 +1,55 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 Corner;
+in float ViewDepth;
+in float Remaining;
+flat in int Instance;
+
+const int PARTICLE_FLOCK = 1;
+
+// the opaque scene's depth buffer, the particles are tested against it here and fade out where they meet it
+uniform sampler2D depth;
+uniform vec2 screenSize;
+uniform float near;
+uniform float far;
+// how close to the scene a particle starts to fade, in world units
+uniform float softness;
+uniform float time;
+
+uniform int behaviour;
+uniform vec3 color;
+uniform bool additive;
+// the brightest a particle may be, just below where bloom picks it up when it shouldn't bloom
+uniform float maxLuminance;
+
+// a bird seen from afar: two wings in a V, flapping
+float Bird(vec2 p)
+{
+    float flap = sin(time * 9.0 + float(Instance) * 1.7) * 0.35;
+    float wing = abs(p.y - (abs(p.x) * (0.45 + flap) - 0.15));
+    return (1.0 - smoothstep(0.06, 0.14, wing)) * (1.0 - smoothstep(0.8, 1.0, abs(p.x)));
+}
+
+void main()
+{
+    float ndc = texture(depth, gl_FragCoord.xy / screenSize).r * 2.0 - 1.0;
+    float sceneDepth = 2.0 * near * far / (far + near - ndc * (far - near));
+    float fade = clamp((sceneDepth - ViewDepth) / softness, 0.0, 1.0);
+
+    float coverage = behaviour == PARTICLE_FLOCK ? Bird(Corner) : 1.0 - smoothstep(0.2, 1.0, length(Corner));
+    coverage *= fade;
+    if (coverage <= 0.0)
+        discard;
+
+    vec3 emitted = color;
+    float luminance = dot(emitted, vec3(0.2126, 0.7152, 0.0722));
+    if (luminance > maxLuminance)
+        emitted *= maxLuminance / luminance;
+
+    // premultiplied: additive particles add their light and cover nothing, fading over their life
+    if (additive)
+        FragColor = vec4(emitted * coverage * Remaining, 0.0);
+    else
+        FragColor = vec4(emitted * coverage, coverage);
+}
@@ -0,0 +1,40 @@
+#version 330 core
+// a particle per instance, see rg/ParticleSystem.h
+layout (location = 0) in vec4 aPositionAge;
+layout (location = 1) in vec4 aVelocityLife;
+
+out vec2 Corner;
+out float ViewDepth;
+// 1 at birth, 0 at death
+out float Remaining;
+flat out int Instance;
+
+const int PARTICLE_FLOCK = 1;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform int behaviour;
+uniform float size;
+
+void main()
+{
+    // the four corners of a triangle strip
+    Corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+    Instance = gl_InstanceID;
+    float age = aPositionAge.w, life = aVelocityLife.w;
+    Remaining = life > 0.0 ? clamp(1.0 - age / life, 0.0, 1.0) : 0.0;
+    if (age < 0.0 || age >= life) {
+        // unborn or dead, behind the camera where it is clipped
+        gl_Position = vec4(0.0, 0.0, -2.0, 1.0);
+        return;
+    }
+
+    // drifting particles shrink away, birds keep their size
+    float scale = behaviour == PARTICLE_FLOCK ? size : size * sqrt(Remaining);
+    vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+    vec3 position = aPositionAge.xyz + (right * Corner.x + up * Corner.y) * scale * 0.5;
+    vec4 viewPosition = view * vec4(position, 1.0);
+    ViewDepth = -viewPosition.z;
+    gl_Position = projection * viewPosition;
+}
@@ -0,0 +1,96 @@
+#version 330 core
+layout (location = 0) in vec4 aPositionAge;
+layout (location = 1) in vec4 aVelocityLife;
+
+// captured by transform feedback into the other buffer, see rg/ParticleSystem.h
+out vec4 PositionAge;
+out vec4 VelocityLife;
+
+const int PARTICLE_DRIFT = 0;
+const int PARTICLE_FLOCK = 1;
+
+uniform float time;
+uniform float deltaTime;
+uniform int behaviour;
+uniform vec3 emitterPosition;
+uniform vec3 emitterExtent;
+uniform vec3 emitterVelocity;
+uniform float velocitySpread;
+uniform vec2 lifeRange;
+uniform float gravity;
+uniform float drag;
+uniform float turbulence;
+uniform vec3 wind;
+uniform float waterLevel;
+// changes every update, so a particle is born somewhere else every time
+uniform int frame;
+
+uint Hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// in [0, 1), a different one for every call with the same seed
+float Random(inout uint seed)
+{
+    seed = Hash(seed);
+    return float(seed >> 8) / 16777216.0;
+}
+
+void main()
+{
+    vec3 position = aPositionAge.xyz;
+    float age = aPositionAge.w + deltaTime;
+    vec3 velocity = aVelocityLife.xyz;
+    float life = aVelocityLife.w;
+    uint seed = Hash(uint(gl_VertexID) ^ Hash(uint(frame)));
+
+    if (age < 0.0) {
+        // not born yet
+    } else if (age >= life) {
+        // born again at the emitter
+        vec3 box = vec3(Random(seed), Random(seed), Random(seed)) * 2.0 - 1.0;
+        position = emitterPosition + box * emitterExtent;
+        float z = Random(seed) * 2.0 - 1.0, angle = Random(seed) * 6.2831853;
+        vec3 direction = vec3(sqrt(1.0 - z * z) * vec2(cos(angle), sin(angle)), z);
+        velocity = emitterVelocity + direction * velocitySpread * Random(seed);
+        if (behaviour == PARTICLE_FLOCK) {
+            // somewhere on the circle, already flying around it
+            angle = Random(seed) * 6.2831853;
+            position = emitterPosition + vec3(cos(angle) * emitterExtent.x, box.y * emitterExtent.y, sin(angle) * emitterExtent.x);
+            velocity = vec3(-sin(angle), 0.0, cos(angle)) * length(emitterVelocity);
+        }
+        age = 0.0;
+        life = mix(lifeRange.x, lifeRange.y, Random(seed));
+    } else if (behaviour == PARTICLE_DRIFT) {
+        // a cheap swirl, different at every place and changing slowly
+        vec3 swirl = vec3(sin(position.y * 3.1 + time * 2.3), sin(position.z * 2.7 + time * 1.9),
+                          cos(position.x * 2.9 + time * 2.1));
+        velocity += (vec3(0.0, -gravity, 0.0) + wind + swirl * turbulence) * deltaTime;
+        velocity *= exp(-drag * deltaTime);
+        position += velocity * deltaTime;
+        // spray falls back into the water, embers that sink into it go out
+        if (position.y < waterLevel)
+            age = life;
+    } else {
+        // steer towards flying along the circle, pulled back to it when off, each bird at its own height
+        vec3 offset = position - emitterPosition;
+        vec2 radial = normalize(offset.xz + 1e-4);
+        float speed = length(emitterVelocity);
+        float height = (float(Hash(uint(gl_VertexID)) >> 8) / 16777216.0 * 2.0 - 1.0) * emitterExtent.y;
+        vec3 desired = vec3(-radial.y, 0.0, radial.x) * speed;
+        desired.xz += radial * (emitterExtent.x - length(offset.xz)) * 0.5;
+        desired.y = (height - offset.y) * 0.5;
+        desired += vec3(sin(time * 0.7 + float(gl_VertexID)), 0.0, cos(time * 0.9 + float(gl_VertexID))) * turbulence;
+        velocity = mix(desired, velocity, exp(-drag * deltaTime));
+        position += velocity * deltaTime;
+    }
+
+    PositionAge = vec4(position, age);
+    VelocityLife = vec4(velocity, life);
+}
@@ -1,6 +1,6 @@
 #version 330 core
-layout (location = 0) out vec4 FragColor;
-layout (location = 1) out vec4 BrightColor;
+#pragma keywords SHADOWS FOG LIGHTMAP CAUSTICS
+out vec4 FragColor;
 
 in vec2 TexCoords;
 in vec3 Normal;
@@ -20,20 +20,67 @@ uniform float shininess;
 uniform DirLight dirLight;
 uniform vec3 viewPosition;
 uniform bool noc;
+uniform mat4 view;
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
+#ifdef LIGHTMAP
+// rgb sun, sky and bounced light, a ambient occlusion, see tools/lightmap_baker.cpp
+uniform sampler2D lightmap;
+uniform vec4 lightmapScaleOffset;
+#endif
+
+#ifdef FOG
+uniform vec3 fogColor;
+uniform float fogDensity;
+#endif
+
+#ifdef CAUSTICS
+// frames of light focused by the waves, see rg/Caustics.h; red is a frame, green the one after it
+uniform sampler2DArray caustics;
+uniform float causticsLayer;
+uniform float causticsBlend;
+uniform float causticsTileSize;
+uniform float causticsRange;
+uniform float causticsStrength;
+// horizontal distance the sunlight travels in the water per unit of depth
+uniform vec2 causticsShift;
+uniform float waterLevel;
+#endif
+
+#ifdef SHADOWS
+const int NUM_CASCADES = 4;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 cascadeMatrices[NUM_CASCADES];
+uniform float cascadeSplits[NUM_CASCADES];
+uniform float shadowTexelSize;
+#endif
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, float shadow);
+float CalcShadow(vec3 fragPos);
+float CalcCaustics(vec3 fragPos);
 void main()
 {
+#ifdef LIGHTMAP
+    // the lightmap coordinates of the seabed are its texture coordinates, which repeat 15 times
+    vec2 lightmapCoords = TexCoords / 15.0 * lightmapScaleOffset.xy + lightmapScaleOffset.zw;
+    vec3 result = texture(lightmap, lightmapCoords).rgb * vec3(texture(texture1, TexCoords));
+    // under water all of the baked light came in through the surface
+    result *= CalcCaustics(FragPos);
+#else
     vec3 normal = normalize(Normal);
     vec3 viewDir = normalize(viewPosition - FragPos);
-    vec3 result = CalcDirLight(dirLight, normal, viewDir);
+    vec3 result = CalcDirLight(dirLight, normal, viewDir, CalcShadow(FragPos) * CalcCaustics(FragPos));
+#endif
 
     result.rgb *= 0.2;
+#ifdef FOG
+    float fogDistance = length(viewPosition - FragPos) * fogDensity;
+    result = mix(fogColor, result, exp(-fogDistance * fogDistance));
+#endif
     FragColor = vec4(result, 1.0);
 }
 
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, float shadow)
 {
     vec3 lightDir = normalize(-light.direction);
     // diffuse shading
@@ -45,5 +92,47 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 ambient = light.ambient * vec3(texture(texture1, TexCoords));
     vec3 diffuse = light.diffuse * diff * vec3(texture(texture1, TexCoords));
     vec3 specular = light.specular * spec * vec3(texture(texture1, TexCoords));
-    return (ambient + diffuse + specular);
-}
\ No newline at end of file
+    return (ambient + shadow * (diffuse + specular));
+}
+
+// 0 when the fragment is in the sun's shadow, 1 when it is fully lit
+float CalcShadow(vec3 fragPos)
+{
+#ifndef SHADOWS
+    return 1.0;
+#else
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int cascade = 0;
+    while (cascade < NUM_CASCADES && depth > cascadeSplits[cascade])
+        cascade++;
+    if (cascade == NUM_CASCADES)
+        return 1.0;
+
+    vec4 lightSpacePos = cascadeMatrices[cascade] * vec4(fragPos, 1.0);
+    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+    if (projCoords.z > 1.0)
+        return 1.0;
+    // 3x3 PCF, every tap is additionally filtered by the hardware comparison
+    float shadow = 0.0;
+    for (int x = -1; x <= 1; ++x)
+        for (int y = -1; y <= 1; ++y)
+            shadow += texture(shadowMap, vec4(projCoords.xy + vec2(x, y) * shadowTexelSize, float(cascade), projCoords.z - 0.0005));
+    return shadow / 9.0;
+#endif
+}
+
+// how much more (or less) sunlight the waves focus on the fragment than a still surface would let through
+float CalcCaustics(vec3 fragPos)
+{
+#ifndef CAUSTICS
+    return 1.0;
+#else
+    // fetched outside of the branch, mipmapping needs the coordinates of the neighbouring fragments
+    float depth = waterLevel - fragPos.y;
+    // the frames were baked for the sun straight above, the pattern is taken from where the light came in
+    vec2 coords = (fragPos.xz - causticsShift * max(depth, 0.0)) / causticsTileSize;
+    vec2 frames = texture(caustics, vec3(coords, causticsLayer)).rg;
+    float light = mix(frames.r, frames.g, causticsBlend) * causticsRange;
+    return depth > 0.0 ? mix(1.0, light, causticsStrength) : 1.0;
+#endif
+}
@@ -0,0 +1,11 @@
+#version 330 core
+in vec3 FragPos;
+
+uniform vec3 lightPosition;
+uniform float farPlane;
+
+void main()
+{
+    // store the linear distance to the light, mapped to [0, 1]
+    gl_FragDepth = length(FragPos - lightPosition) / farPlane;
+}
@@ -0,0 +1,34 @@
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+uniform mat4 shadowMatrices[6];
+uniform int baseLayer;
+
+out vec3 FragPos;
+
+void main()
+{
+    for (int face = 0; face < 6; ++face)
+    {
+        vec4 clip[3];
+        for (int i = 0; i < 3; ++i)
+            clip[i] = shadowMatrices[face] * gl_in[i].gl_Position;
+        // skip the faces whose frustum the triangle is completely outside of
+        if ((clip[0].x > clip[0].w && clip[1].x > clip[1].w && clip[2].x > clip[2].w) ||
+            (clip[0].x < -clip[0].w && clip[1].x < -clip[1].w && clip[2].x < -clip[2].w) ||
+            (clip[0].y > clip[0].w && clip[1].y > clip[1].w && clip[2].y > clip[2].w) ||
+            (clip[0].y < -clip[0].w && clip[1].y < -clip[1].w && clip[2].y < -clip[2].w) ||
+            (clip[0].w < 0.0 && clip[1].w < 0.0 && clip[2].w < 0.0))
+            continue;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            gl_Layer = baseLayer + face;
+            FragPos = gl_in[i].gl_Position.xyz;
+            gl_Position = clip[i];
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
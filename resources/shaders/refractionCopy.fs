@@ -0,0 +1,27 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// the opaque scene, before the water is drawn over it
+uniform sampler2D sceneColor;
+uniform sampler2D depth;
+uniform float near;
+uniform float far;
+
+float ViewDepth(ivec2 texel)
+{
+    float ndc = texelFetch(depth, texel, 0).r * 2.0 - 1.0;
+    return 2.0 * near * far / (far + near - ndc * (far - near));
+}
+
+// half the size of the scene: rgb is the color of the four texels under this one, a the view space depth
+// of the nearest of them, so an edge in front of the water never counts as behind it
+void main()
+{
+    FragColor.rgb = texture(sceneColor, TexCoords).rgb;
+    ivec2 texel = ivec2(gl_FragCoord.xy) * 2;
+    ivec2 last = textureSize(depth, 0) - 1;
+    FragColor.a = min(min(ViewDepth(texel), ViewDepth(min(texel + ivec2(1, 0), last))),
+                      min(ViewDepth(min(texel + ivec2(0, 1), last)), ViewDepth(min(texel + ivec2(1, 1), last))));
+}
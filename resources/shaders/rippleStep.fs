@@ -0,0 +1,35 @@
+#version 330 core
+out vec2 FragColor;
+
+in vec2 TexCoords;
+
+// height of the last tick in r and of the one before in g, see rg/RippleSimulation.h
+uniform sampler2D state;
+// where this texel was in the last state, as the square follows the camera
+uniform vec2 shift;
+uniform vec2 texel;
+uniform float courant;
+uniform float damping;
+// xy position and z radius in texture coordinates, w strength
+uniform vec4 sources[8];
+uniform int sourceCount;
+
+void main()
+{
+    vec2 uv = TexCoords + shift;
+    vec2 height = texture(state, uv).rg;
+    float laplacian = texture(state, uv + vec2(texel.x, 0.0)).r + texture(state, uv - vec2(texel.x, 0.0)).r +
+                      texture(state, uv + vec2(0.0, texel.y)).r + texture(state, uv - vec2(0.0, texel.y)).r -
+                      4.0 * height.r;
+    float next = (2.0 * height.r - height.g + courant * laplacian) * damping;
+
+    for (int i = 0; i < sourceCount; i++) {
+        float distance = length(TexCoords - sources[i].xy);
+        next += sources[i].w * (1.0 - smoothstep(0.0, sources[i].z, distance));
+    }
+
+    // waves die out towards the edges instead of bouncing back
+    vec2 edge = min(TexCoords, 1.0 - TexCoords);
+    next *= smoothstep(0.0, 0.05, min(edge.x, edge.y));
+    FragColor = vec2(next, height.r);
+}
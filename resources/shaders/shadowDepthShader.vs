@@ -0,0 +1,15 @@
+#version 330 core
+#pragma keywords INSTANCED
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 lightSpaceMatrix;
+uniform mat4 model;
+
+void main()
+{
+#ifdef INSTANCED
+    gl_Position = lightSpaceMatrix * instanceTransform(time) * model * vec4(aPos, 1.0);
+#else
+    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+#endif
+}
@@ -1,7 +1,6 @@
 #version 330 core
 
-layout (location = 0) out vec4 FragColor;
-layout (location = 1) out vec4 BrightColor;
+out vec4 FragColor;
 
 in vec3 TexCoords;
 
@@ -11,5 +10,4 @@ void main()
 {
           FragColor = texture(skybox, TexCoords);
           FragColor.rgb *= 0.7;
-          BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
 }
@@ -0,0 +1,22 @@
+#version 330 core
+out vec2 Velocity;
+
+in vec2 TexCoords;
+
+uniform sampler2D depth;
+// inverse of the jittered view projection the scene was drawn with
+uniform mat4 inverseViewProjection;
+// without jitter, of this frame and the last one
+uniform mat4 viewProjection;
+uniform mat4 previousViewProjection;
+
+// screen space motion of whatever didn't move itself, from the depth buffer and the camera alone
+void main()
+{
+    vec4 ndc = vec4(TexCoords * 2.0 - 1.0, texture(depth, TexCoords).r * 2.0 - 1.0, 1.0);
+    vec4 world = inverseViewProjection * ndc;
+    world /= world.w;
+    vec4 current = viewProjection * world;
+    vec4 previous = previousViewProjection * world;
+    Velocity = (current.xy / current.w - previous.xy / previous.w) * 0.5;
+}
@@ -0,0 +1,11 @@
+#version 330 core
+out vec2 Velocity;
+
+in vec4 CurrentPosition;
+in vec4 PreviousPosition;
+
+// screen space motion of an object that moved on its own, drawn over the camera velocity
+void main()
+{
+    Velocity = (CurrentPosition.xy / CurrentPosition.w - PreviousPosition.xy / PreviousPosition.w) * 0.5;
+}
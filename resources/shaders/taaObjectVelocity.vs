@@ -0,0 +1,43 @@
+#version 330 core
+#pragma keywords INSTANCED CLOTH
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 previousModel;
+// jittered, so the object covers the same pixels it covers in the scene
+uniform mat4 jitteredViewProjection;
+// without jitter, of this frame and the last one
+uniform mat4 viewProjection;
+uniform mat4 previousViewProjection;
+
+out vec4 CurrentPosition;
+out vec4 PreviousPosition;
+
+#ifdef CLOTH
+// where the cloth was the frame before, unless it wasn't stepped since and stands where it stood
+layout (location = 3) in vec3 aPreviousPos;
+uniform bool moved;
+#endif
+
+#ifdef INSTANCED
+// an animated instance (instanceAnimation.glsl) is placed once at time and once at previousTime, where the last
+// frame drew it
+uniform float previousTime;
+#endif
+
+void main()
+{
+#ifdef INSTANCED
+    vec4 position = instanceTransform(time) * model * vec4(aPos, 1.0);
+    vec4 previousPosition = instanceTransform(previousTime) * previousModel * vec4(aPos, 1.0);
+#elif defined(CLOTH)
+    vec4 position = model * vec4(aPos, 1.0);
+    vec4 previousPosition = previousModel * vec4(moved ? aPreviousPos : aPos, 1.0);
+#else
+    vec4 position = model * vec4(aPos, 1.0);
+    vec4 previousPosition = previousModel * vec4(aPos, 1.0);
+#endif
+    CurrentPosition = viewProjection * position;
+    PreviousPosition = previousViewProjection * previousPosition;
+    gl_Position = jitteredViewProjection * position;
+}
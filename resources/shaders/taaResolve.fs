@@ -0,0 +1,53 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D scene;
+uniform sampler2D history;
+uniform sampler2D velocity;
+uniform bool historyValid;
+uniform float feedback;
+
+vec3 RGBToYCoCg(vec3 c)
+{
+    return vec3(0.25 * c.r + 0.5 * c.g + 0.25 * c.b, 0.5 * c.r - 0.5 * c.b, -0.25 * c.r + 0.5 * c.g - 0.25 * c.b);
+}
+
+vec3 YCoCgToRGB(vec3 c)
+{
+    return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+float Luminance(vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+    vec3 current = texture(scene, TexCoords).rgb;
+
+    // the box around the 3x3 neighbourhood in the new frame, the history has to lie in it
+    vec3 boxMin = RGBToYCoCg(current);
+    vec3 boxMax = boxMin;
+    for (int x = -1; x <= 1; x++)
+        for (int y = -1; y <= 1; y++) {
+            vec3 neighbour = RGBToYCoCg(texture(scene, TexCoords + vec2(x, y) * texel).rgb);
+            boxMin = min(boxMin, neighbour);
+            boxMax = max(boxMax, neighbour);
+        }
+
+    vec2 previousCoords = TexCoords - texture(velocity, TexCoords).rg;
+    if (!historyValid || any(lessThan(previousCoords, vec2(0.0))) || any(greaterThan(previousCoords, vec2(1.0)))) {
+        FragColor = vec4(current, 1.0);
+        return;
+    }
+    vec3 previous = YCoCgToRGB(clamp(RGBToYCoCg(texture(history, previousCoords).rgb), boxMin, boxMax));
+
+    // weighting by inverse luminance keeps single bright pixels from dominating the blend
+    float currentWeight = (1.0 - feedback) / (1.0 + Luminance(current));
+    float previousWeight = feedback / (1.0 + Luminance(previous));
+    FragColor = vec4((current * currentWeight + previous * previousWeight) / (currentWeight + previousWeight), 1.0);
+}
@@ -0,0 +1,49 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;
+
+out vec2 TexCoords;
+out vec3 Normal;
+out vec3 FragPos;
+
+// tiles of heights in a cache, see rg/Terrain.h
+uniform sampler2DArray heights;
+uniform float heightMin;
+uniform float heightRange;
+// cells on a side of a tile's grid
+uniform float cells;
+uniform vec2 nodeOrigin;
+uniform float nodeSize;
+uniform float layer;
+// distances over which the grid turns into the one of the next coarser level
+uniform vec2 morphRange;
+
+uniform vec3 viewPosition;
+uniform mat4 view;
+uniform mat4 projection;
+
+float Height(vec2 grid)
+{
+    grid = clamp(grid, 0.0, cells);
+    return heightMin + heightRange * textureLod(heights, vec3((grid + 0.5) / (cells + 1.0), layer), 0.0).r;
+}
+
+void main()
+{
+    float spacing = nodeSize / cells;
+    vec2 world = nodeOrigin + aPos * spacing;
+    float distance = length(viewPosition - vec3(world.x, Height(aPos), world.y));
+    float morph = clamp((distance - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+    // the odd vertices slide onto their even neighbours, which are the vertices of the coarser grid
+    vec2 grid = aPos - fract(aPos * 0.5) * 2.0 * morph;
+    world = nodeOrigin + grid * spacing;
+
+    // one sided along the edges of the tile
+    vec2 low = max(grid - 1.0, 0.0), high = min(grid + 1.0, cells);
+    vec2 slope = vec2(Height(vec2(high.x, grid.y)) - Height(vec2(low.x, grid.y)),
+                      Height(vec2(grid.x, high.y)) - Height(vec2(grid.x, low.y))) / ((high - low) * spacing);
+    Normal = normalize(vec3(-slope.x, 1.0, -slope.y));
+    FragPos = vec3(world.x, Height(grid), world.y);
+    // same tiling as the flat seabed
+    TexCoords = world * 0.15;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -14,7 +14,37 @@
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
+#include <rg/AutoExposure.h>
+#include <rg/Bloom.h>
+#include <rg/CascadedShadowMap.h>
+#include <rg/Caustics.h>
+#include <rg/Cloth.h>
+#include <rg/ColorGrading.h>
+#include <rg/ComputeBlur.h>
+#include <rg/FrameGraph.h>
+#include <rg/GaussianKernel.h>
+#include <rg/GpuTimer.h>
+#include <rg/InstanceBuffer.h>
+#include <rg/JobPool.h>
+#include <rg/Ocean.h>
+#include <rg/ParticleSystem.h>
+#include <rg/PlanarReflection.h>
+#include <rg/Lightmap.h>
+#include <rg/PointShadowMaps.h>
+#include <rg/QualityGovernor.h>
+#include <rg/RenderTargetFormats.h>
+#include <rg/RippleSimulation.h>
+#include <rg/ShaderVariants.h>
+#include <rg/StaticScene.h>
+#include <rg/TemporalAA.h>
+#include <rg/TransformHierarchy.h>
+#include <rg/Transparency.h>
+#include <rg/Terrain.h>
+
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <random>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 
@@ -32,9 +62,31 @@ unsigned int loadCubemap(vector<std::string> faces);
 
 void renderQuad();
 
+glm::vec4 computeBoundingSphere(const Model& model);
+
+ShadowCaster transformBoundingSphere(glm::vec4 sphere, const glm::mat4& model, std::function<void(Shader&)> draw);
+
+std::vector<InstanceData> buildFleet(int count, float waterLevel);
+
 // settings
 int width = 800;
 int height = 600;
+// size of the offscreen targets, follows the window once it stopped changing size for RESIZE_DELAY seconds
+int renderWidth = width;
+int renderHeight = height;
+double lastResizeTime = 0.0;
+const double RESIZE_DELAY = 0.2;
+
+// aircraft animated on the GPU, beside the plane circling the city, see buildFleet()
+const int MAX_FLEET = 4096;
+
+// the particle systems of the scene, see main()
+enum ParticleSystemId {
+    PARTICLES_EMBERS,
+    PARTICLES_SPRAY,
+    PARTICLES_GULLS,
+    PARTICLE_SYSTEM_COUNT
+};
 
 // camera
 
@@ -51,6 +103,19 @@ bool hdr = true;
 bool bloom = true;
 float exposure = 1.0f;
 
+// texture units above the ones Mesh::Draw hands out to material textures
+const int SHADOW_MAP_TEXTURE_UNIT = 10;
+const int POINT_SHADOW_MAP_TEXTURE_UNIT = 11;
+const int LIGHTMAP_TEXTURE_UNIT = 12;
+const int TERRAIN_TEXTURE_UNIT = 13;
+const int CAUSTICS_TEXTURE_UNIT = 14;
+
+enum BloomMode {
+    BLOOM_MIP_CHAIN,
+    // the old full resolution Gaussian ping-pong, kept to compare against
+    BLOOM_PING_PONG
+};
+
 struct PointLight {
     glm::vec3 position;
     glm::vec3 ambient;
@@ -80,6 +145,119 @@ struct ProgramState {
     float backpackScale = 0.5f;
     PointLight pointLight;
     DirLight dirLight;
+    bool shadowsEnabled = true;
+    float shadowGpuMs = 0.0f;
+    int shadowStaticRedraws = 0;
+    int pointShadowUpdatesPerFrame = 1;
+    float pointShadowGpuMs = 0.0f;
+    int pointShadowUpdates = 0;
+    int pointShadowPending = 0;
+    bool bakedLightingEnabled = true;
+    bool bakedLightingAvailable = false;
+    bool fogEnabled = false;
+    float fogDensity = 0.02f;
+    glm::vec3 fogColor = glm::vec3(0.55f, 0.6f, 0.65f);
+    int shaderVariants = 0;
+    int bloomMode = BLOOM_MIP_CHAIN;
+    // runs both bloom implementations every frame to time them side by side
+    bool bloomCompare = false;
+    int bloomLevels = MipChainBloom::MAX_LEVELS;
+    float bloomRadius = 0.004f;
+    float bloomIntensity = 1.0f;
+    // luminance above which the scene blooms
+    float bloomThreshold = 1.3f;
+    bool bloomSkipWhenDark = true;
+    bool bloomSkipped = false;
+    std::vector<FrameGraph::PassTraffic> executedPasses;
+    std::vector<std::string> culledPasses;
+    int renderTargetCount = 0;
+    size_t renderTargetBytes = 0;
+    size_t trafficBytes = 0;
+    int precision = PRECISION_PACKED;
+    bool depth32 = false;
+    bool governorEnabled = false;
+    float governorTargetMs = 16.6f;
+    int governorLevel = 0;
+    float frameGpuMs = 0.0f;
+    float renderScale = 1.0f;
+    float textureLodBias = 0.0f;
+    int pointShadowInterval = 1;
+    bool autoExposure = true;
+    float exposureCompensation = 0.0f;
+    float exposureSpeedUp = 3.0f;
+    float exposureSpeedDown = 1.0f;
+    ColorGradingParams grading;
+    bool fxaaEnabled = true;
+    bool vignetteEnabled = false;
+    float vignetteIntensity = 0.35f;
+    int lutRebuilds = 0;
+    bool taaEnabled = true;
+    float taaFeedback = 0.9f;
+    bool reflectionsEnabled = true;
+    float reflectionThreshold = 0.05f;
+    float reflectionBudgetMs = 0.5f;
+    float reflectionDistortion = 0.2f;
+    float reflectionGpuMs = 0.0f;
+    // fraction of the recent frames that rendered the reflection
+    float reflectionUpdateRate = 0.0f;
+    bool refractionEnabled = true;
+    float refractionStrength = 0.05f;
+    glm::vec3 waterAbsorption = glm::vec3(0.3f, 0.08f, 0.05f);
+    int transparencyMode = TRANSPARENCY_WEIGHTED;
+    int transparentDraws = 0;
+    bool clothEnabled = true;
+    int clothIterations = 8;
+    float clothBendStiffness = 0.15f;
+    bool clothSimd = true;
+    // the flags spread over the job pool
+    bool clothParallel = true;
+    float clothCpuMs = 0.0f;
+    int clothSteps = 0;
+    size_t clothUploadBytes = 0;
+    bool particlesEnabled = true;
+    bool particleSystemEnabled[PARTICLE_SYSTEM_COUNT] = {true, true, true};
+    int particleCounts[PARTICLE_SYSTEM_COUNT] = {4096, 16384, 512};
+    bool particleBloom[PARTICLE_SYSTEM_COUNT] = {true, false, false};
+    float particleGpuMs[PARTICLE_SYSTEM_COUNT] = {};
+    // how close to the scene particles start to fade out
+    float particleSoftness = 0.3f;
+    size_t particleBufferBytes = 0;
+    bool fleetEnabled = true;
+    // aircraft drawn of the MAX_FLEET in the buffer
+    int fleetCount = 48;
+    size_t instanceBufferBytes = 0;
+    bool oceanEnabled = true;
+    // the simulation grid is 128 << oceanResolution on a side
+    int oceanResolution = 1;
+    float oceanWindSpeed = 6.0f;
+    float oceanChoppiness = 1.0f;
+    float oceanCpuMs = 0.0f;
+    size_t oceanUploadBytes = 0;
+    bool terrainEnabled = true;
+    bool terrainAvailable = false;
+    int terrainNodes = 0;
+    int terrainCulled = 0;
+    int terrainResident = 0;
+    int terrainPending = 0;
+    size_t terrainCacheBytes = 0;
+    bool causticsEnabled = true;
+    bool causticsAvailable = false;
+    float causticsStrength = 1.0f;
+    size_t causticsBytes = 0;
+    bool ripplesEnabled = true;
+    // how far the rocking boat lifts the water each tick
+    float rippleStrength = 0.004f;
+    float rippleDamping = 0.99f;
+    float rippleGpuMs = 0.0f;
+    int rippleTicks = 0;
+    float mipChainBloomGpuMs = 0.0f;
+    float pingPongBloomGpuMs = 0.0f;
+    // ten passes of the old 9 tap kernel blurred with a sigma of about 2 * sqrt(5)
+    float pingPongBlurSigma = 4.5f;
+    float pingPongBlurFetches = 0.0f;
+    // the blur in a compute shader with shared memory tiles, where the context is GL 4.3
+    bool computeBlurEnabled = true;
+    bool computeBlurAvailable = false;
     ProgramState()
             : camera(glm::vec3(0.0f, 0.0f, 3.0f)) {}
 
@@ -122,9 +300,7 @@ ProgramState *programState;
 
 void DrawImGui(ProgramState *programState);
 
-unsigned int colorBuffers[2];
-unsigned int rboDepth;
-unsigned int pingpongColorbuffers[2];
+unsigned int scenePassKeywords(ProgramState *programState);
 
 int main() {
     // glfw: initialize and configure
@@ -161,6 +337,16 @@ int main() {
         return -1;
     }
 
+    // Init Imgui
+    // ---------
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    (void) io;
+
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init("#version 330 core");
+
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     stbi_set_flip_vertically_on_load(true);
 
@@ -176,12 +362,39 @@ int main() {
 
     // build and compile shaders
     // -------------------------
-    Shader ourShader("resources/shaders/2.model_lighting.vs", "resources/shaders/2.model_lighting.fs");
+    // lit shaders are specialized per pass and material, see rg/ShaderVariants.h
+    ShaderVariants modelShaders("resources/shaders/2.model_lighting.vs", "resources/shaders/2.model_lighting.fs");
     Shader skyboxShader("resources/shaders/skyboxShader.vs", "resources/shaders/skyboxShader.fs");
-    Shader planeShader("resources/shaders/planeShader.vs", "resources/shaders/planeShader.fs");
+    ShaderVariants planeShaders("resources/shaders/planeShader.vs", "resources/shaders/planeShader.fs");
+    // the seabed terrain, lit like the flat seabed
+    ShaderVariants terrainShaders("resources/shaders/terrain.vs", "resources/shaders/planeShader.fs");
     Shader blendingShader("resources/shaders/blendingShader.vs", "resources/shaders/blendingShader.fs");
-    Shader hdrShader("resources/shaders/hdrShader.vs", "resources/shaders/hdrShader.fs");
+    Shader oceanShader("resources/shaders/ocean.vs", "resources/shaders/ocean.fs");
+    Shader rippleStepShader("resources/shaders/blurShader.vs", "resources/shaders/rippleStep.fs");
+    Shader refractionCopyShader("resources/shaders/blurShader.vs", "resources/shaders/refractionCopy.fs");
+    Shader oitCompositeShader("resources/shaders/blurShader.vs", "resources/shaders/oitComposite.fs");
+    Shader particleUpdateShader = Shader::TransformFeedback("resources/shaders/particleUpdate.vs",
+                                                            {"PositionAge", "VelocityLife"});
+    Shader particleShader("resources/shaders/particle.vs", "resources/shaders/particle.fs");
+    // the final pass, with FXAA and the vignette as variants
+    ShaderVariants postShaders("resources/shaders/hdrShader.vs", "resources/shaders/hdrShader.fs");
     Shader blurShader("resources/shaders/blurShader.vs", "resources/shaders/blurShader.fs");
+    Shader bloomDownsampleShader("resources/shaders/blurShader.vs", "resources/shaders/bloomDownsample.fs");
+    Shader bloomUpsampleShader("resources/shaders/blurShader.vs", "resources/shaders/bloomUpsample.fs");
+    Shader exposureLuminanceShader("resources/shaders/blurShader.vs", "resources/shaders/exposureLuminance.fs");
+    Shader exposureHistogramShader("resources/shaders/exposureHistogram.vs", "resources/shaders/exposureHistogram.fs");
+    Shader exposureAdaptShader("resources/shaders/blurShader.vs", "resources/shaders/exposureAdapt.fs");
+    Shader taaCameraVelocityShader("resources/shaders/blurShader.vs", "resources/shaders/taaCameraVelocity.fs");
+    // the INSTANCED variant for the fleet
+    ShaderVariants taaObjectVelocityShaders("resources/shaders/taaObjectVelocity.vs",
+                                            "resources/shaders/taaObjectVelocity.fs");
+    Shader taaResolveShader("resources/shaders/blurShader.vs", "resources/shaders/taaResolve.fs");
+    // the INSTANCED variants for the fleet
+    ShaderVariants shadowDepthShaders("resources/shaders/shadowDepthShader.vs",
+                                      "resources/shaders/shadowDepthShader.fs");
+    ShaderVariants pointShadowDepthShaders("resources/shaders/pointShadowDepthShader.vs",
+                                           "resources/shaders/pointShadowDepthShader.fs",
+                                           "resources/shaders/pointShadowDepthShader.gs");
 
     float skyboxVertices[] = {
             // positions
@@ -290,8 +503,6 @@ int main() {
     blendingShader.setInt("texture1", 0);
 
     unsigned int sandTexture = loadTexture("resources/textures/sand.jpg");
-    planeShader.use();
-    planeShader.setInt("texture1", 0);
 
     // load models
     // -----------
@@ -319,65 +530,140 @@ int main() {
     Model ourPlane("resources/objects/airplane_crj-900_cityjet/scene.gltf");
     ourBoat.SetShaderTextureNamePrefix("material.");
     stbi_set_flip_vertically_on_load(true);
-
-    // set up floating point framebuffer to render scene to
-    unsigned int hdrFBO;
-    glGenFramebuffers(1, &hdrFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-    glGenTextures(2, colorBuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(
-                GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL
-        );
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // attach texture to framebuffer
-        glFramebufferTexture2D(
-                GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0
-        );
+    glm::vec4 planeBounds = computeBoundingSphere(ourPlane);
+    // the plane circles the city: the orbit node moves every frame, the model turned to fly along it never changes;
+    // the aircraft of the fleet are turned the same way, before the shader moves them
+    TransformHierarchy planeTransforms;
+    int planeOrbit = planeTransforms.add();
+    int planeBody = planeTransforms.add(planeOrbit);
+    int fleetBody = planeTransforms.add();
+    for (int node: {planeBody, fleetBody}) {
+        planeTransforms.setRotation(node, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        planeTransforms.rotate(node, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        planeTransforms.rotate(node, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
     }
 
-    // create and attach depth buffer (renderbuffer)
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
-    // finally check if framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // ping-pong-framebuffer for blurring
-    unsigned int pingpongFBO[2];
-    glGenFramebuffers(2, pingpongFBO);
-    glGenTextures(2, pingpongColorbuffers);
-    for (unsigned int i = 0; i < 2; i++)
+    // lighting of everything that never moves, baked by lightmap_baker
+    StaticScene staticScene = buildStaticScene();
+    BakedLightmap bakedLightmap;
+    programState->bakedLightingAvailable = bakedLightmap.load(staticScene, {&ourCity, &ourFlag, &ourBoat});
+    // light focused by the waves onto the seabed, baked by caustics_baker
+    Caustics caustics;
+    programState->causticsAvailable = caustics.load();
+    programState->causticsBytes = caustics.textureBytes();
+
+    // the cloth of the flags is simulated, the flag model is left with the pole (after the lightmap layout, which
+    // rebuilds the triangles)
+    for (Mesh& mesh: ourFlag.meshes)
+        mesh.KeepTriangles([](const Vertex& a, const Vertex& b, const Vertex& c) {
+            return isFlagPoleTriangle(a.TexCoords, b.TexCoords, c.TexCoords);
+        });
+    ClothSolver clothSolver;
+    std::vector<Cloth> flagCloths;
+    for (StaticInstanceId instance: {FLAG, POLE})
+        // in the space of the model the pole runs along z and the cloth hangs off its top towards -x
+        flagCloths.emplace_back(24, 18, glm::vec3(-0.02f, 0.0f, 2.46f), glm::vec3(-0.8f, 0.0f, 0.0f),
+                                glm::vec3(0.0f, 0.0f, -0.64f), staticScene.instances[instance].transform);
+    // within the red cell of the palette
+    const glm::vec2 flagUvCorner = glm::vec2(0.545f, 0.17f), flagUvOpposite = glm::vec2(0.57f, 0.23f);
+    ClothMesh flagMeshes[2] = {
+            {flagCloths[0], flagUvCorner, flagUvOpposite},
+            {flagCloths[1], flagUvCorner, flagUvOpposite},
+    };
+
+    // compile the variants the scene starts with, the rest only when a setting asks for them
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
-        // also check if framebuffers are complete (no need for depth buffer)
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "Framebuffer not complete!" << std::endl;
+        unsigned int passKeywords = scenePassKeywords(programState);
+        unsigned int staticKeywords = passKeywords;
+        if (programState->bakedLightingAvailable && programState->bakedLightingEnabled)
+            staticKeywords |= LIGHTMAP;
+        unsigned int seabedKeywords = programState->causticsAvailable ? CAUSTICS : 0u;
+        for (Model* staticModel: {&ourFlag, &ourBoat})
+            for (const Mesh& mesh: staticModel->meshes)
+                modelShaders.get(staticKeywords | materialKeywords(mesh));
+        // the buildings are drawn as instances
+        for (const Mesh& mesh: ourCity.meshes)
+            modelShaders.get(staticKeywords | INSTANCED | materialKeywords(mesh));
+        // what moves: the plane and the fleet, and the cloth of the flags with the flag's material
+        for (Model* dynamicModel: {&ourPlane, &ourFlag})
+            for (const Mesh& mesh: dynamicModel->meshes)
+                modelShaders.get(passKeywords | materialKeywords(mesh));
+        for (const Mesh& mesh: ourPlane.meshes)
+            modelShaders.get(passKeywords | INSTANCED | materialKeywords(mesh));
+        planeShaders.get(staticKeywords | seabedKeywords);
     }
 
-    hdrShader.use();
-    hdrShader.setInt("hdrBuffer", 0);
-    hdrShader.setInt("bloomBlur", 1);
+    // shadows of the sun
+    CascadedShadowMap cascadedShadowMap(2048);
+    GpuTimer shadowTimer;
+    // shadows of the lanterns
+    PointShadowMaps pointShadowMaps(512);
+    GpuTimer pointShadowTimer;
+
+    // render targets are handed out to the passes of the frame graph by the pool
+    RenderTargetPool renderTargets;
+
+    // quality is lowered when the GPU can't keep up with the target frame time
+    QualityGovernor governor;
+    GpuTimer frameTimer;
+    bool governorWasEnabled = false;
+    float appliedLodBias = 0.0f;
+    unsigned long long frameIndex = 0;
+    std::vector<unsigned int> lodBiasedTextures = {waterTexture, sandTexture};
+    for (Model* biasedModel: {&ourCity, &ourFlag, &ourBoat, &ourPlane})
+        for (const Texture& texture: biasedModel->textures_loaded)
+            lodBiasedTextures.push_back(texture.id);
+
+    MipChainBloom mipChainBloom(width, height);
+    GpuTimer mipChainBloomTimer;
+    GpuTimer pingPongBloomTimer;
+
+    AutoExposure autoExposure;
+    ColorGradingLut colorGradingLut;
+    // the water surface: the plane quad at y = -1, moved down by half a unit
+    const float WATER_LEVEL = -1.5f;
+    PlanarReflection planarReflection(WATER_LEVEL);
+    // the buildings and the fleet, each model drawn with one instanced call; nothing in either buffer changes after
+    // this, the fleet is moved by the shader (after the lightmap layout, which rebuilds the vertex arrays)
+    std::vector<InstanceData> cityInstanceData;
+    for (StaticInstanceId city: {CITY_FAR_FAR, CITY_FAR, CITY_MIDDLE, CITY_NEAR, CITY_SMALL_NEAR})
+        cityInstanceData.push_back(staticInstance(staticScene.instances[city].transform,
+                                                  bakedLightmap.instanceScaleOffset(city)));
+    InstanceBuffer cityInstances(cityInstanceData);
+    cityInstances.attach(ourCity);
+    std::vector<InstanceData> fleetInstanceData = buildFleet(MAX_FLEET, WATER_LEVEL);
+    InstanceBuffer fleetInstances(fleetInstanceData);
+    fleetInstances.attach(ourPlane);
+    // the shadow of the fleet is culled by a sphere around the paths of the aircraft drawn, found again when their
+    // number changes; the model is only turned within an instance, it reaches as far from the origin in any direction
+    const float fleetModelRadius = glm::length(glm::vec3(planeBounds)) + planeBounds.w;
+    glm::vec4 fleetBounds = glm::vec4(0.0f);
+    int fleetBoundsCount = -1;
+    programState->instanceBufferBytes = cityInstances.bytes() + fleetInstances.bytes();
+    GpuTimer reflectionTimer;
+    // the waves are simulated on the CPU, spread over the worker threads
+    JobPool jobPool;
+    OceanParams oceanParams;
+    Ocean ocean(oceanParams);
+    // 32 x 32 units of small waves around the camera, a texel as wide as the finest cells of the ocean mesh
+    RippleSimulation ripples(256, 32.0f);
+    GpuTimer rippleTimer;
+    // whatever is drawn with blending, refilled every frame
+    TransparentQueue transparentQueue;
+    // streamed from the file written by terrain_builder; without it the seabed stays the flat quad
+    Terrain terrain(TERRAIN_PATH);
+    programState->terrainAvailable = terrain.available();
+    // the scene is rendered with a different subpixel offset every frame and accumulated at window size
+    TemporalAA temporalAA;
+    bool taaWasEnabled = false;
+    glm::mat4 previousViewProjection = glm::mat4(1.0f);
+    glm::mat4 previousPlaneModel = glm::mat4(1.0f);
     blurShader.use();
     blurShader.setInt("image", 0);
+    float blurKernelSigma = 0.0f;
+    float fragmentBlurFetches = 0.0f;
+    ComputeBlur computeBlur((GLADloadproc) glfwGetProcAddress);
+    programState->computeBlurAvailable = computeBlur.available();
 
     //let there be.. lights!
     PointLight& pointLight = programState->pointLight;
@@ -389,8 +675,64 @@ int main() {
     pointLight.constant = 1.0f;
     pointLight.linear = 0.5f;
     pointLight.quadratic = 1.1f;
+    // the lantern's light is too weak to matter further away than this
+    const float lanternShadowRadius = 10.0f;
+    int lanternShadow = pointShadowMaps.addLight(glm::vec3(0.0f, 1.0f, 4.8f), lanternShadowRadius);
+
+    // particles: embers rising from the lantern, spray thrown up around the rocking boat and gulls circling above
+    ParticleEmitter embers;
+    embers.position = glm::vec3(0.0f, 1.05f, 4.8f);
+    embers.extent = glm::vec3(0.05f, 0.02f, 0.05f);
+    embers.velocity = glm::vec3(0.0f, 0.3f, 0.0f);
+    embers.velocitySpread = 0.15f;
+    embers.minLife = 1.5f;
+    embers.maxLife = 3.0f;
+    // hot air carries them up
+    embers.gravity = -0.6f;
+    embers.drag = 0.8f;
+    embers.turbulence = 0.6f;
+    embers.size = 0.03f;
+    embers.color = glm::vec3(8.0f, 3.2f, 0.6f);
+
+    ParticleEmitter spray;
+    // placed at the boat every frame
+    spray.extent = glm::vec3(1.2f, 0.02f, 1.2f);
+    spray.velocitySpread = 0.8f;
+    spray.minLife = 0.6f;
+    spray.maxLife = 1.2f;
+    spray.gravity = 9.8f;
+    spray.drag = 0.3f;
+    spray.turbulence = 0.2f;
+    spray.size = 0.04f;
+    spray.color = glm::vec3(1.1f, 1.15f, 1.2f);
+    spray.bloom = false;
+
+    ParticleEmitter gulls;
+    gulls.behaviour = PARTICLE_FLOCK;
+    gulls.position = glm::vec3(0.0f, 7.0f, 0.0f);
+    // circling 8 units out, 1.5 units above or below the emitter
+    gulls.extent = glm::vec3(8.0f, 1.5f, 0.0f);
+    gulls.velocity = glm::vec3(3.0f, 0.0f, 0.0f);
+    gulls.minLife = 20.0f;
+    gulls.maxLife = 40.0f;
+    gulls.drag = 1.5f;
+    gulls.turbulence = 0.5f;
+    gulls.size = 0.5f;
+    gulls.color = glm::vec3(0.06f, 0.06f, 0.07f);
+    gulls.additive = false;
+    gulls.bloom = false;
+
+    ParticleSystem particleSystems[PARTICLE_SYSTEM_COUNT] = {
+            {embers, programState->particleCounts[PARTICLES_EMBERS]},
+            {spray, programState->particleCounts[PARTICLES_SPRAY]},
+            {gulls, programState->particleCounts[PARTICLES_GULLS]},
+    };
 
     DirLight& dirLight = programState->dirLight;
+    dirLight.direction = staticScene.sunDirection;
+    dirLight.ambient = staticScene.sunAmbient;
+    dirLight.diffuse = staticScene.sunDiffuse;
+    dirLight.specular = staticScene.sunSpecular;
 
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -404,219 +746,924 @@ int main() {
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        //light settings
-        dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
-        dirLight.ambient = glm::vec3(0.4f);
-        dirLight.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
-        dirLight.specular = glm::vec3(0.2f, 0.2f, 0.2f);
-
         // input
         // -----
         processInput(window);
 
+        // resizes are applied once the window stopped changing size, not on every step of a drag
+        if ((renderWidth != width || renderHeight != height) && glfwGetTime() - lastResizeTime > RESIZE_DELAY) {
+            renderWidth = width;
+            renderHeight = height;
+        }
 
-        // render
-        // ------
-        glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        //render scene into floating point framebuffer
-        glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        //unda da sea
-        //----------
-        planeShader.use();
+        // object transforms
+        // -----------------
         glm::mat4 model = glm::mat4(1.0f);
+
+        // static instances, placed by buildStaticScene()
+        const glm::mat4& seabedModel = staticScene.instances[SEABED].transform;
+        const glm::mat4& boatModel = staticScene.instances[BOAT].transform;
+        const glm::mat4& flagModel = staticScene.instances[FLAG].transform;
+        const glm::mat4& poleModel = staticScene.instances[POLE].transform;
+        const StaticInstanceId cities[] = {CITY_FAR_FAR, CITY_FAR, CITY_MIDDLE, CITY_NEAR, CITY_SMALL_NEAR};
+
+        //plane model
+        planeTransforms.setPosition(planeOrbit, glm::vec3(5.0f*cos(currentFrame), 5.0f,5.0f*sin(currentFrame)));
+        planeTransforms.setRotation(planeOrbit, currentFrame, glm::vec3(0.0f, -1.0f, 0.0f));
+        planeTransforms.update();
+        const glm::mat4& planeModel = planeTransforms.world(planeBody);
+        const glm::mat4& fleetModel = planeTransforms.world(fleetBody);
+        int fleetCount = programState->fleetEnabled ? std::min(programState->fleetCount, fleetInstances.count()) : 0;
+
         // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) width / (float) height, 0.1f, 100.0f);
+        // the shape of the targets the scene renders into, which lags the window while it is being resized
+        const float nearPlane = 0.1f, farPlane = 100.0f;
+        const float aspect = (float) renderWidth / (float) std::max(1, renderHeight);
+        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom), aspect, nearPlane, farPlane);
         glm:: mat4 view = programState->camera.GetViewMatrix();
-        planeShader.setMat4("view", view);
-        planeShader.setMat4("projection", projection);
-
-        glBindVertexArray(planeVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, sandTexture);
-        model = glm::translate(model, glm::vec3(0.0f, -5.0f, 0.0f));
-        planeShader.setMat4("model", model);
-
-        //plane shader lights
-        planeShader.setVec3("dirLight.direction", dirLight.direction);
-        planeShader.setVec3("dirLight.ambient", dirLight.ambient);
-        planeShader.setVec3("dirLight.diffuse", dirLight.diffuse);
-        planeShader.setVec3("dirLight.specular", dirLight.specular);
-        planeShader.setFloat("shininess", 1.0f);
-
-
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        //---------------
-
-        // don't forget to enable shader before setting uniforms
-        ourShader.use();
-        //directional light
-        ourShader.setVec3("dirLight.direction", dirLight.direction);
-        ourShader.setVec3("dirLight.ambient", dirLight.ambient);
-        ourShader.setVec3("dirLight.diffuse", dirLight.diffuse);
-        ourShader.setVec3("dirLight.specular", dirLight.specular);
 
         //point light
         pointLight.position = glm::vec3(0.0f, 1.0f, 4.8f);
-        ourShader.setVec3("pointLight.position", pointLight.position);
-        ourShader.setVec3("pointLight.ambient", pointLight.ambient);
-        ourShader.setVec3("pointLight.diffuse", pointLight.diffuse);
-        ourShader.setVec3("pointLight.specular", pointLight.specular);
-        ourShader.setFloat("pointLight.constant", pointLight.constant);
-        ourShader.setFloat("pointLight.linear", pointLight.linear);
-        ourShader.setFloat("pointLight.quadratic", pointLight.quadratic);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setFloat("material.shininess", 32.0f);
-
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        // render the loaded model
-
-        model = glm::mat4(1.0f);
-
-        //render city model far far
-        glm::mat4 cityModelFarFar = model;
-        cityModelFarFar = glm::translate(cityModelFarFar,glm::vec3 (0.0f, 1.0f, -5.0f));
-        cityModelFarFar = glm::scale(cityModelFarFar, glm::vec3(1.0f, 0.5f, 1.0f));
-        cityModelFarFar = glm::rotate(cityModelFarFar,glm::radians(90.0f), glm::vec3(0.0f ,1.0f, 0.0f));
-        ourShader.setMat4("model", cityModelFarFar);
-        ourCity.Draw(ourShader);
-//      render city model far
-        glm::mat4 cityModelFar = model;
-        cityModelFar = glm::translate(cityModelFar,glm::vec3 (0.0f, 1.0f, -3.0f));
-        cityModelFar = glm::scale(cityModelFar, glm::vec3(1.0f, 0.7f, 1.0f));
-        cityModelFar = glm::rotate(cityModelFar,glm::radians(90.0f), glm::vec3(0.0f ,1.0f, 0.0f));
-        ourShader.setMat4("model", cityModelFar);
-        ourCity.Draw(ourShader);
-
-//        render city model
-        glm::mat4 cityModelMiddle = model;
-        cityModelMiddle = glm::translate(cityModelMiddle,glm::vec3 (0.0f, 1.0f, -1.0f));
-        //cityModelMiddle = glm::scale(cityModelMiddle, glm::vec3(1.2f));
-        cityModelMiddle = glm::rotate(cityModelMiddle,glm::radians(90.0f), glm::vec3(0.0f ,1.0f, 0.0f));
-        ourShader.setMat4("model", cityModelMiddle);
-        ourCity.Draw(ourShader);
-
-//        render city model near
-        glm::mat4 cityModelNear = model;
-        cityModelNear = glm::translate(cityModelNear,glm::vec3 (0.0f, 1.0f, 1.0f));
-        cityModelNear = glm::scale(cityModelNear, glm::vec3(1.0f, 1.3f, 1.0f));
-        cityModelNear = glm::rotate(cityModelNear,glm::radians(90.0f), glm::vec3(0.0f ,1.0f, 0.0f));
-        ourShader.setMat4("model", cityModelNear);
-        ourCity.Draw(ourShader);
-
-        //render city model small near
-        glm::mat4 cityModelSNear = model;
-        cityModelSNear = glm::translate(cityModelSNear,glm::vec3 (0.0f, 1.0f, 3.0f));
-        cityModelSNear = glm::scale(cityModelSNear, glm::vec3(1.0f, 1.0f, 1.0f));
-        cityModelSNear = glm::rotate(cityModelSNear,glm::radians(90.0f), glm::vec3(0.0f ,1.0f, 0.0f));
-        ourShader.setMat4("model", cityModelSNear);
-        ourCity.Draw(ourShader);
-
-        //render boat model
-        glm::mat4 boatModel = model;
-        boatModel = glm::translate(boatModel,glm::vec3 (0.0f, 0.0f, -0.5f));
-        boatModel = glm::scale(boatModel, glm::vec3(6.0f, 6.0f, 6.0f));
-        //cityModel = glm::rotate(cityModel,glm::radians(195.0f), glm::vec3(0.0f ,1.0f, 0.0f));
-        ourShader.setMat4("model", boatModel);
-        ourBoat.Draw(ourShader);
-
-        //render flag model
-        glm::mat4 flagModel = model;
-        flagModel = glm::translate(flagModel,glm::vec3 (0.0f, 7.0f, 1.0f));
-        flagModel = glm::scale(flagModel, glm::vec3(1.5f, 1.0f, 1.5f));
-        flagModel = glm::rotate(flagModel,glm::radians(180.0f), glm::vec3(0.0f ,1.0f, 0.0f));
-        flagModel = glm::rotate(flagModel,glm::radians(-90.0f), glm::vec3(1.0f ,0.0f, 0.0f));
-        flagModel = glm::rotate(flagModel,glm::radians(90.0f), glm::vec3(0.0f ,0.0f, 1.0f));
-        ourShader.setMat4("model", flagModel);
-        ourFlag.Draw(ourShader);
-
-        //render pole model
-        glm::mat4 poleModel = model;
-        poleModel = glm::translate(poleModel,glm::vec3 (0.0f, -1.2f, 1.0f));
-        poleModel = glm::scale(poleModel, glm::vec3(3.0f));
-        //cityModel = glm::rotate(cityModel,glm::radians(195.0f), glm::vec3(0.0f ,1.0f, 0.0f));
-        poleModel = glm::rotate(poleModel,glm::radians(180.0f), glm::vec3(0.0f ,1.0f, 0.0f));
-        poleModel = glm::rotate(poleModel,glm::radians(-90.0f), glm::vec3(1.0f ,0.0f, 0.0f));
-        poleModel = glm::rotate(poleModel,glm::radians(90.0f), glm::vec3(0.0f ,0.0f, 1.0f));
-        ourShader.setMat4("model", poleModel);
-        ourFlag.Draw(ourShader);
-
-        //render plane model
-        glm::mat4 planeModel = model;
-        planeModel = glm::translate(planeModel, glm::vec3(5.0f*cos(currentFrame), 5.0f,5.0f*sin(currentFrame)));
-        planeModel = glm::rotate(planeModel, currentFrame, glm::vec3(0.0f, -1.0f, 0.0f));
-
-        planeModel = glm::rotate(planeModel, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        planeModel = glm::rotate(planeModel,glm::radians(180.0f), glm::vec3(0.0f ,0.0f, 1.0f));
-        planeModel = glm::rotate(planeModel,glm::radians(90.0f), glm::vec3(1.0f ,0.0f, 0.0f));
-        ourShader.setMat4("model", planeModel);
-        ourPlane.Draw(ourShader);
-
-        //sea
-        glBindVertexArray(planeVAO);
-        glBindTexture(GL_TEXTURE_2D, waterTexture);
-
-        blendingShader.use();
-        blendingShader.setInt("texture1", 0);
-        blendingShader.setMat4("projection", projection);
-        blendingShader.setMat4("view", view);
-
-        glm::mat4 waterModel = model;
-        waterModel = glm::translate(waterModel, glm::vec3(0.0f, -0.5f,0.0f));
-        blendingShader.use();
-        blendingShader.setMat4("model", waterModel);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        // draw skybox as last
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-        skyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // the flags, before anything draws them
+        int clothSteps = programState->clothEnabled ? clothSolver.stepsFor(deltaTime) : 0;
+        programState->clothSteps = clothSteps;
+        if (clothSteps > 0) {
+            clothSolver.params.iterations = programState->clothIterations;
+            clothSolver.params.bendStiffness = programState->clothBendStiffness;
+            clothSolver.params.simd = programState->clothSimd;
+            glm::vec2 windDirection = glm::normalize(oceanParams.windDirection);
+            clothSolver.params.wind = glm::vec3(windDirection.x, 0.0f, windDirection.y) * programState->oceanWindSpeed;
+            double clothStart = glfwGetTime();
+            clothSolver.simulate(flagCloths, currentFrame, clothSteps, programState->clothParallel ? &jobPool : nullptr);
+            float clothMs = (float) ((glfwGetTime() - clothStart) * 1000.0);
+            programState->clothCpuMs = programState->clothCpuMs * 0.95f + clothMs * 0.05f;
+            size_t clothBytes = 0;
+            for (size_t i = 0; i < flagCloths.size(); i++) {
+                flagMeshes[i].upload(flagCloths[i]);
+                clothBytes += flagMeshes[i].vertexBytes();
+            }
+            programState->clothUploadBytes = clothBytes;
+        }
+
+        frameIndex++;
+        frameTimer.begin();
+
+        // shadows
+        // -------
+        // everything that never moves ends up in the cached shadow maps
+        auto drawStaticCasters = [&](Shader& shader) {
+            shader.setMat4("model", seabedModel);
+            glBindVertexArray(planeVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glBindVertexArray(0);
+
+            for (StaticInstanceId city: cities) {
+                shader.setMat4("model", staticScene.instances[city].transform);
+                ourCity.Draw(shader);
+            }
+            shader.setMat4("model", boatModel);
+            ourBoat.Draw(shader);
+            shader.setMat4("model", flagModel);
+            ourFlag.Draw(shader);
+            shader.setMat4("model", poleModel);
+            ourFlag.Draw(shader);
+        };
+
+        std::vector<ShadowCaster> dynamicCasters;
+        dynamicCasters.push_back(transformBoundingSphere(planeBounds, planeModel, [&](Shader& shader) {
+            shader.setMat4("model", planeModel);
+            ourPlane.Draw(shader);
+        }));
+        for (size_t i = 0; i < flagCloths.size(); i++) {
+            glm::vec4 bounds = flagCloths[i].bounds();
+            dynamicCasters.push_back({glm::vec3(bounds), bounds.w, [&, i](Shader& shader) {
+                shader.setMat4("model", glm::mat4(1.0f));
+                flagMeshes[i].draw();
+            }});
+        }
+        if (fleetCount > 0) {
+            if (fleetCount != fleetBoundsCount) {
+                fleetBounds = instanceBounds(fleetInstanceData, fleetCount, fleetModelRadius);
+                fleetBoundsCount = fleetCount;
+            }
+            ShadowCaster fleetCaster = {glm::vec3(fleetBounds), fleetBounds.w, [&](Shader& shader) {
+                shader.setMat4("model", fleetModel);
+                shader.setFloat("time", currentFrame);
+                setInstanceSplines(shader);
+                for (Mesh& mesh: ourPlane.meshes)
+                    mesh.DrawInstanced(shader, fleetCount);
+            }};
+            fleetCaster.keywords = INSTANCED;
+            fleetCaster.animated = true;
+            dynamicCasters.push_back(fleetCaster);
+        }
+
+        if (programState->shadowsEnabled) {
+            shadowTimer.begin();
+            cascadedShadowMap.update(view, programState->camera.Zoom, aspect, nearPlane, dirLight.direction,
+                                     shadowDepthShaders, drawStaticCasters, dynamicCasters);
+            shadowTimer.end();
+            programState->shadowGpuMs = shadowTimer.averageMilliseconds();
+            programState->shadowStaticRedraws = cascadedShadowMap.staticRedraws();
+
+            pointShadowTimer.begin();
+            pointShadowMaps.updatesPerFrame = frameIndex % programState->pointShadowInterval == 0 ? programState->pointShadowUpdatesPerFrame : 0;
+            pointShadowMaps.setLight(lanternShadow, pointLight.position, lanternShadowRadius);
+            pointShadowMaps.update(pointShadowDepthShaders, drawStaticCasters, dynamicCasters);
+            pointShadowTimer.end();
+            programState->pointShadowGpuMs = pointShadowTimer.averageMilliseconds();
+            programState->pointShadowUpdates = pointShadowMaps.updatesLastFrame();
+            programState->pointShadowPending = pointShadowMaps.pendingUpdates();
+        }
+
+        // render
+        // ------
+        FrameGraph frameGraph;
+        frameGraph.setWindowSize(width, height);
+        int scaledWidth = std::max(1, (int) (renderWidth * programState->renderScale));
+        int scaledHeight = std::max(1, (int) (renderHeight * programState->renderScale));
+        RenderTargetFormats formats = RenderTargetFormats::select((RenderTargetPrecision) programState->precision,
+                                                                  programState->depth32);
+        RenderTargetDesc sceneDesc = {scaledWidth, scaledHeight, formats.hdrColor};
+        RenderTargetDesc depthDesc = {scaledWidth, scaledHeight, formats.depth};
+        RenderTargetDesc velocityDesc = {scaledWidth, scaledHeight, formats.velocity};
+
+        // motion is measured without the jitter, the jitter only decides which part of each pixel gets sampled
+        bool taa = programState->taaEnabled;
+        glm::mat4 cameraProjection = projection;
+        glm::mat4 viewProjection = projection * view;
+        if (taa) {
+            temporalAA.resize(renderWidth, renderHeight);
+            if (!taaWasEnabled)
+                temporalAA.reset();
+            temporalAA.feedback = programState->taaFeedback;
+            projection = temporalAA.jitter(projection, scaledWidth, scaledHeight);
+        }
+        taaWasEnabled = taa;
+        glm::mat4 jitteredViewProjection = projection * view;
+
+        bool baked = programState->bakedLightingAvailable && programState->bakedLightingEnabled;
+        unsigned int passKeywords = scenePassKeywords(programState);
+        unsigned int staticKeywords = passKeywords;
+        if (baked)
+            staticKeywords |= LIGHTMAP;
+        // only the seabed shaders declare it, the rest of the scene is above the water or floats on it
+        unsigned int seabedKeywords = 0;
+        if (caustics.isLoaded() && programState->causticsEnabled)
+            seabedKeywords |= CAUSTICS;
+        modelShaders.nextFrame();
+        planeShaders.nextFrame();
+        terrainShaders.nextFrame();
+
+        // uniforms shared by all draws of a variant, set the first time it is used in the frame
+        // (every sampler needs a unit of its own, the shadow maps must not share unit 0 with a sampler2D)
+        auto setupPlaneShader = [&](Shader& shader) {
+            shader.setInt("texture1", 0);
+            shader.setMat4("view", view);
+            shader.setMat4("projection", projection);
+            shader.setVec3("viewPosition", programState->camera.Position);
+            //plane shader lights
+            shader.setVec3("dirLight.direction", dirLight.direction);
+            shader.setVec3("dirLight.ambient", dirLight.ambient);
+            shader.setVec3("dirLight.diffuse", dirLight.diffuse);
+            shader.setVec3("dirLight.specular", dirLight.specular);
+            shader.setFloat("shininess", 1.0f);
+            cascadedShadowMap.bind(shader, SHADOW_MAP_TEXTURE_UNIT);
+            if (bakedLightmap.isLoaded())
+                bakedLightmap.bind(shader, LIGHTMAP_TEXTURE_UNIT);
+            if (caustics.isLoaded())
+                caustics.bind(shader, CAUSTICS_TEXTURE_UNIT, currentFrame, dirLight.direction, WATER_LEVEL,
+                              programState->causticsStrength);
+            shader.setVec3("fogColor", programState->fogColor);
+            shader.setFloat("fogDensity", programState->fogDensity);
+        };
+        auto setupModelShader = [&](Shader& shader) {
+            //directional light
+            shader.setVec3("dirLight.direction", dirLight.direction);
+            shader.setVec3("dirLight.ambient", dirLight.ambient);
+            shader.setVec3("dirLight.diffuse", dirLight.diffuse);
+            shader.setVec3("dirLight.specular", dirLight.specular);
+            cascadedShadowMap.bind(shader, SHADOW_MAP_TEXTURE_UNIT);
+            //point light
+            pointShadowMaps.bind(shader, POINT_SHADOW_MAP_TEXTURE_UNIT, "pointLights[0]", lanternShadow);
+            shader.setVec3("pointLights[0].position", pointLight.position);
+            shader.setVec3("pointLights[0].ambient", pointLight.ambient);
+            shader.setVec3("pointLights[0].diffuse", pointLight.diffuse);
+            shader.setVec3("pointLights[0].specular", pointLight.specular);
+            shader.setFloat("pointLights[0].constant", pointLight.constant);
+            shader.setFloat("pointLights[0].linear", pointLight.linear);
+            shader.setFloat("pointLights[0].quadratic", pointLight.quadratic);
+            if (bakedLightmap.isLoaded())
+                bakedLightmap.bind(shader, LIGHTMAP_TEXTURE_UNIT);
+            shader.setVec3("fogColor", programState->fogColor);
+            shader.setFloat("fogDensity", programState->fogDensity);
+            shader.setVec3("viewPosition", programState->camera.Position);
+            shader.setFloat("material.shininess", 32.0f);
+            // the only thing the fleet needs from the CPU
+            shader.setFloat("time", currentFrame);
+            setInstanceSplines(shader);
+
+            shader.setMat4("projection", projection);
+            shader.setMat4("view", view);
+        };
+
+        // the waves of this frame, uploaded before anything draws them
+        if (programState->oceanEnabled) {
+            oceanParams.size = 128 << programState->oceanResolution;
+            oceanParams.windSpeed = programState->oceanWindSpeed;
+            oceanParams.choppiness = programState->oceanChoppiness;
+            double oceanStart = glfwGetTime();
+            ocean.configure(oceanParams);
+            ocean.update(currentFrame, &jobPool);
+            float oceanMs = (float) ((glfwGetTime() - oceanStart) * 1000.0);
+            programState->oceanCpuMs = programState->oceanCpuMs * 0.95f + oceanMs * 0.05f;
+            programState->oceanUploadBytes = ocean.uploadBytes();
+        }
+
+        // reflection of the water, at half resolution and only once something moved enough
+        // ---------------------------------------------------------------------------------
+        bool reflections = programState->reflectionsEnabled;
+        bool updateReflection = false;
+        if (reflections) {
+            planarReflection.resize(std::max(1, scaledWidth / 2), std::max(1, scaledHeight / 2), formats.hdrColor);
+            planarReflection.positionThreshold = programState->reflectionThreshold;
+            planarReflection.budgetMs = programState->reflectionBudgetMs;
+            updateReflection = planarReflection.needsUpdate(view, cameraProjection, {glm::vec3(planeModel[3])},
+                                                            reflectionTimer.averageMilliseconds());
+        } else {
+            planarReflection.invalidate();
+        }
+        programState->reflectionUpdateRate = programState->reflectionUpdateRate * 0.95f + (updateReflection ? 0.05f : 0.0f);
+
+        FrameResource reflection = NO_FRAME_RESOURCE;
+        if (updateReflection) {
+            glm::mat4 mirroredView = planarReflection.reflectedView(view);
+            glm::mat4 reflectionProjection = planarReflection.obliqueProjection(cameraProjection, mirroredView);
+            glm::vec3 mirroredPosition = programState->camera.Position;
+            mirroredPosition.y = 2.0f * WATER_LEVEL - mirroredPosition.y;
+            // no shadows and no lantern, the buildings take their light from the lightmap when it is there
+            unsigned int reflectionKeywords = pointLightsKeyword(0) | (programState->fogEnabled ? FOG : 0u);
+            unsigned int reflectionStaticKeywords = reflectionKeywords;
+            if (baked)
+                reflectionStaticKeywords |= LIGHTMAP;
+
+            // the pass runs after this block is left, so what is only declared in here is copied into it
+            FrameGraph::Pass& reflectionPass = frameGraph.addPass("water reflection", [&, mirroredView, reflectionProjection,
+                    mirroredPosition, reflectionKeywords, reflectionStaticKeywords](FrameGraph::Context& context) {
+                auto setupReflectionShader = [&](Shader& shader) {
+                    setupModelShader(shader);
+                    shader.setMat4("projection", reflectionProjection);
+                    shader.setMat4("view", mirroredView);
+                    shader.setVec3("viewPosition", mirroredPosition);
+                };
+                reflectionTimer.begin();
+                planarReflection.begin(programState->clearColor);
+                // the mirror turns the winding of every triangle around
+                glFrontFace(GL_CW);
+                auto drawReflected = [&](Model& reflectedModel, const glm::mat4& transform, unsigned int keywords,
+                                         int lightmapInstance) {
+                    for (Mesh& mesh: reflectedModel.meshes) {
+                        Shader& shader = modelShaders.use(keywords | materialKeywords(mesh), setupReflectionShader);
+                        shader.setMat4("model", transform);
+                        if (lightmapInstance >= 0)
+                            bakedLightmap.bindInstance(shader, lightmapInstance);
+                        mesh.Draw(shader);
+                    }
+                };
+                auto drawReflectedInstances = [&](Model& reflectedModel, int count, const glm::mat4& transform,
+                                                  unsigned int keywords) {
+                    for (Mesh& mesh: reflectedModel.meshes) {
+                        Shader& shader = modelShaders.use(keywords | INSTANCED | materialKeywords(mesh),
+                                                          setupReflectionShader);
+                        shader.setMat4("model", transform);
+                        mesh.DrawInstanced(shader, count);
+                    }
+                };
+                // only what is big enough to show in rippled water at half resolution: the boat, the flag and
+                // the pole are left out, the seabed is under the surface anyway
+                drawReflectedInstances(ourCity, cityInstances.count(), glm::mat4(1.0f), reflectionStaticKeywords);
+                drawReflected(ourPlane, planeModel, reflectionKeywords, -1);
+                if (fleetCount > 0)
+                    drawReflectedInstances(ourPlane, fleetCount, fleetModel, reflectionKeywords);
+
+                glDepthFunc(GL_LEQUAL);
+                skyboxShader.use();
+                skyboxShader.setMat4("view", glm::mat4(glm::mat3(mirroredView)));
+                skyboxShader.setMat4("projection", reflectionProjection);
+                glBindVertexArray(skyboxVAO);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+                glBindVertexArray(0);
+                glDepthFunc(GL_LESS);
+                glFrontFace(GL_CCW);
+                reflectionTimer.end();
+                programState->reflectionGpuMs = reflectionTimer.averageMilliseconds();
+                context.traffic(planarReflection.depthBytes(), planarReflection.depthBytes());
+            });
+            reflection = reflectionPass.write(frameGraph.import("water reflection", planarReflection.texture(),
+                                                                planarReflection.desc()));
+        }
+
+        // the seabed tiles in view, at the detail their distance needs
+        bool drawTerrain = terrain.available() && programState->terrainEnabled;
+        if (drawTerrain) {
+            terrain.update(programState->camera.Position, viewProjection);
+            programState->terrainNodes = terrain.drawnNodes();
+            programState->terrainCulled = terrain.culledNodes();
+            programState->terrainResident = terrain.residentTiles();
+            programState->terrainPending = terrain.pendingTiles();
+            programState->terrainCacheBytes = terrain.cacheBytes();
+        }
+
+        // ripples around the camera, stepped at their own rate
+        // ---------------------------------------------------
+        FrameResource rippleField = NO_FRAME_RESOURCE;
+        int rippleTicks = programState->ripplesEnabled ? ripples.ticksFor(deltaTime) : 0;
+        std::vector<RippleSource> rippleSources;
+        // the hull slaps the water as the boat rocks, which sends rings out around it
+        glm::vec3 boatPosition = glm::vec3(boatModel[3]);
+        rippleSources.push_back({glm::vec2(boatPosition.x, boatPosition.z), 1.2f,
+                                 programState->rippleStrength * std::sin(currentFrame * 12.0f)});
+        programState->rippleTicks = rippleTicks;
+        if (rippleTicks > 0) {
+            ripples.damping = programState->rippleDamping;
+            FrameGraph::Pass& ripplePass = frameGraph.addPass("ripples", [&](FrameGraph::Context& context) {
+                rippleTimer.begin();
+                ripples.step(rippleTicks, programState->camera.Position, rippleSources, rippleStepShader, renderQuad);
+                rippleTimer.end();
+                programState->rippleGpuMs = rippleTimer.averageMilliseconds();
+                size_t tickBytes = ripples.desc().bytes();
+                context.traffic(5 * tickBytes * rippleTicks, tickBytes * rippleTicks);
+            });
+            rippleField = ripplePass.write(frameGraph.import("ripples", ripples.texture(), ripples.desc()));
+        }
+
+        //render scene into floating point framebuffer
+        FrameResource sceneColor = NO_FRAME_RESOURCE, sceneDepth = NO_FRAME_RESOURCE;
+        FrameGraph::Pass& scenePass = frameGraph.addPass("scene", [&](FrameGraph::Context& context) {
+            context.bindTarget({sceneColor}, sceneDepth);
+            glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            //unda da sea
+            //----------
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, sandTexture);
+            if (drawTerrain) {
+                // the lightmap was baked for the flat seabed, it doesn't fit the terrain
+                terrain.draw(terrainShaders.use(passKeywords | seabedKeywords, setupPlaneShader), TERRAIN_TEXTURE_UNIT);
+            } else {
+                Shader& seabedShader = planeShaders.use(staticKeywords | seabedKeywords, setupPlaneShader);
+                glBindVertexArray(planeVAO);
+                seabedShader.setMat4("model", seabedModel);
+                if (baked)
+                    bakedLightmap.bindInstance(seabedShader, SEABED);
+
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                glBindVertexArray(0);
+            }
+            //---------------
+
+            // every mesh is drawn with the cheapest variant its material allows
+            auto drawLit = [&](Model& litModel, const glm::mat4& transform, unsigned int keywords, int lightmapInstance) {
+                for (Mesh& mesh: litModel.meshes) {
+                    Shader& shader = modelShaders.use(keywords | materialKeywords(mesh), setupModelShader);
+                    shader.setMat4("model", transform);
+                    if (lightmapInstance >= 0)
+                        bakedLightmap.bindInstance(shader, lightmapInstance);
+                    mesh.Draw(shader);
+                }
+            };
+            auto drawStatic = [&](Model& staticModel, StaticInstanceId instance) {
+                drawLit(staticModel, staticScene.instances[instance].transform, staticKeywords, baked ? instance : -1);
+            };
+            // the transform of every instance, and its lightmap rectangle, comes from its instance buffer
+            auto drawInstances = [&](Model& instancedModel, int count, const glm::mat4& transform,
+                                     unsigned int keywords) {
+                for (Mesh& mesh: instancedModel.meshes) {
+                    Shader& shader = modelShaders.use(keywords | INSTANCED | materialKeywords(mesh), setupModelShader);
+                    shader.setMat4("model", transform);
+                    mesh.DrawInstanced(shader, count);
+                }
+            };
+
+            // render the loaded models
+            //render city models, far far to small near, in one draw
+            drawInstances(ourCity, cityInstances.count(), glm::mat4(1.0f), staticKeywords);
+
+            //render boat model
+            drawStatic(ourBoat, BOAT);
+
+            //render flag model
+            drawStatic(ourFlag, FLAG);
+
+            //render pole model
+            drawStatic(ourFlag, POLE);
+
+            // the cloth of the flags, in world space and lit like the plane, the lightmap doesn't have it
+            for (ClothMesh& flagMesh: flagMeshes) {
+                const Mesh& flagMaterial = ourFlag.meshes[0];
+                Shader& shader = modelShaders.use(passKeywords | materialKeywords(flagMaterial), setupModelShader);
+                shader.setMat4("model", glm::mat4(1.0f));
+                flagMaterial.BindTextures(shader);
+                flagMesh.draw();
+            }
+
+            //render plane model
+            drawLit(ourPlane, planeModel, passKeywords, -1);
+
+            //render the fleet
+            if (fleetCount > 0)
+                drawInstances(ourPlane, fleetCount, fleetModel, passKeywords);
+            programState->shaderVariants = (int) (modelShaders.compiledCount() + planeShaders.compiledCount() +
+                                                  terrainShaders.compiledCount());
+        });
+        sceneColor = scenePass.create("scene color", sceneDesc);
+        sceneDepth = scenePass.create("scene depth", depthDesc);
+
+        // what the water lets through, copied at half size before the water covers it
+        // ----------------------------------------------------------------------------
+        bool refraction = programState->refractionEnabled;
+        FrameResource refractionColor = NO_FRAME_RESOURCE;
+        if (refraction) {
+            FrameGraph::Pass& refractionPass = frameGraph.addPass("refraction copy", [&](FrameGraph::Context& context) {
+                context.bindTarget({refractionColor});
+                glDisable(GL_DEPTH_TEST);
+                glDisable(GL_BLEND);
+                refractionCopyShader.use();
+                refractionCopyShader.setInt("sceneColor", 0);
+                refractionCopyShader.setInt("depth", 1);
+                refractionCopyShader.setFloat("near", nearPlane);
+                refractionCopyShader.setFloat("far", farPlane);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, context.texture(sceneDepth));
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.texture(sceneColor));
+                renderQuad();
+                glEnable(GL_BLEND);
+                glEnable(GL_DEPTH_TEST);
+            });
+            refractionPass.read(sceneColor);
+            refractionPass.read(sceneDepth);
+            // the depth goes in alpha, which the packed HDR format has none of
+            refractionColor = refractionPass.create("refraction", {std::max(1, scaledWidth / 2),
+                                                                    std::max(1, scaledHeight / 2), GL_RGBA16F});
+        }
+
+        // the water, drawn by the water pass when it covers what is behind it, otherwise with the transparent draws
+        bool weightedTransparency = programState->transparencyMode == TRANSPARENCY_WEIGHTED;
+        glm::mat4 waterModel = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
+        auto drawWater = [&](bool weighted) {
+            auto setupWater = [&](Shader& shader) {
+                shader.setInt("refractionEnabled", refraction);
+                shader.setInt("refraction", 5);
+                shader.setVec2("screenSize", glm::vec2(sceneDesc.width, sceneDesc.height));
+                shader.setFloat("refractionStrength", programState->refractionStrength);
+                shader.setVec3("absorption", programState->waterAbsorption);
+                shader.setInt("weightedBlended", weighted);
+            };
+
+            //sea
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, planarReflection.texture());
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, waterTexture);
+            if (programState->oceanEnabled) {
+                oceanShader.use();
+                oceanShader.setInt("texture1", 0);
+                oceanShader.setInt("reflection", 1);
+                ocean.bind(oceanShader, programState->camera.Position, WATER_LEVEL, 2, 3);
+                oceanShader.setMat4("projection", projection);
+                oceanShader.setMat4("view", view);
+                oceanShader.setInt("reflectionEnabled", reflections);
+                oceanShader.setMat4("reflectionViewProjection", planarReflection.viewProjection());
+                oceanShader.setVec3("viewPosition", programState->camera.Position);
+                oceanShader.setFloat("distortion", programState->reflectionDistortion);
+                oceanShader.setInt("ripplesEnabled", programState->ripplesEnabled);
+                ripples.bind(oceanShader, 4);
+                setupWater(oceanShader);
+                ocean.draw();
+            } else {
+                glBindVertexArray(planeVAO);
+
+                blendingShader.use();
+                blendingShader.setInt("texture1", 0);
+                blendingShader.setInt("reflection", 1);
+                blendingShader.setMat4("projection", projection);
+                blendingShader.setMat4("view", view);
+                blendingShader.setInt("reflectionEnabled", reflections);
+                blendingShader.setMat4("reflectionViewProjection", planarReflection.viewProjection());
+                blendingShader.setVec3("viewPosition", programState->camera.Position);
+                blendingShader.setFloat("time", currentFrame);
+                blendingShader.setFloat("distortion", programState->reflectionDistortion);
+                blendingShader.setInt("ripplesEnabled", programState->ripplesEnabled);
+                ripples.bind(blendingShader, 4);
+                setupWater(blendingShader);
+
+                blendingShader.setMat4("model", waterModel);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            }
+        };
+        transparentQueue.clear();
+        if (!refraction)
+            transparentQueue.submit(-(view * waterModel[3]).z, drawWater);
+        // what the water reads, whichever pass it is drawn in
+        auto readWaterInputs = [&](FrameGraph::Pass& pass) {
+            if (reflection != NO_FRAME_RESOURCE)
+                pass.read(reflection);
+            if (rippleField != NO_FRAME_RESOURCE)
+                pass.read(rippleField);
+        };
+
+        // the opaque water and the sky, over the opaque scene
+        FrameGraph::Pass& waterPass = frameGraph.addPass("water", [&](FrameGraph::Context& context) {
+            context.bindTarget({sceneColor}, sceneDepth);
+            // the water covers what is behind it when it draws that itself, blending would only cost bandwidth
+            if (refraction) {
+                glDisable(GL_BLEND);
+                glActiveTexture(GL_TEXTURE5);
+                glBindTexture(GL_TEXTURE_2D, context.texture(refractionColor));
+                glActiveTexture(GL_TEXTURE0);
+                drawWater(false);
+                glEnable(GL_BLEND);
+            }
+
+            // draw skybox as last
+            glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+            skyboxShader.use();
+            glm::mat4 skyboxView = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
+            skyboxShader.setMat4("view", skyboxView);
+            skyboxShader.setMat4("projection", projection);
+            // skybox cube
+            glBindVertexArray(skyboxVAO);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glBindVertexArray(0);
+            glDepthFunc(GL_LESS); // set depth function back to default
+        });
+        waterPass.read(sceneColor);
+        waterPass.read(sceneDepth);
+        waterPass.write(sceneColor);
+        waterPass.write(sceneDepth);
+        if (refraction) {
+            waterPass.read(refractionColor);
+            readWaterInputs(waterPass);
+        }
+
+        // everything transparent, over the finished opaque scene
+        // ------------------------------------------------------
+        programState->transparentDraws = (int) transparentQueue.size();
+        FrameResource accumulation = NO_FRAME_RESOURCE, transparentWeight = NO_FRAME_RESOURCE;
+        if (!transparentQueue.empty() && weightedTransparency) {
+            FrameGraph::Pass& accumulatePass = frameGraph.addPass("transparent accumulation", [&](FrameGraph::Context& context) {
+                context.bindTarget({accumulation, transparentWeight}, sceneDepth);
+                WeightedBlendedOIT::beginAccumulation();
+                transparentQueue.drawWeighted();
+                WeightedBlendedOIT::endAccumulation();
+            });
+            accumulatePass.read(sceneDepth);
+            readWaterInputs(accumulatePass);
+            accumulation = accumulatePass.create("transparent accumulation",
+                                                 WeightedBlendedOIT::accumulationDesc(sceneDesc.width, sceneDesc.height));
+            transparentWeight = accumulatePass.create("transparent weight",
+                                                      WeightedBlendedOIT::weightDesc(sceneDesc.width, sceneDesc.height));
+
+            FrameGraph::Pass& compositePass = frameGraph.addPass("transparent composite", [&](FrameGraph::Context& context) {
+                context.bindTarget({sceneColor});
+                WeightedBlendedOIT::composite(oitCompositeShader, context.texture(accumulation),
+                                              context.texture(transparentWeight), renderQuad);
+            });
+            compositePass.read(accumulation);
+            compositePass.read(transparentWeight);
+            compositePass.read(sceneColor);
+            compositePass.write(sceneColor);
+        } else if (!transparentQueue.empty()) {
+            FrameGraph::Pass& sortedPass = frameGraph.addPass("transparent sorted", [&](FrameGraph::Context& context) {
+                context.bindTarget({sceneColor}, sceneDepth);
+                transparentQueue.drawSorted();
+            });
+            sortedPass.read(sceneColor);
+            sortedPass.read(sceneDepth);
+            readWaterInputs(sortedPass);
+            sortedPass.write(sceneColor);
+        }
+
+        // particles, simulated and drawn over everything else; not through the transparent queue, which tests
+        // against the attached depth buffer they sample for their soft edges
+        // ----------------------------------------------------
+        ParticleSystem& sprayParticles = particleSystems[PARTICLES_SPRAY];
+        sprayParticles.emitter.position = glm::vec3(boatPosition.x, WATER_LEVEL + 0.05f, boatPosition.z);
+        // thrown highest when the hull slaps the water, like the ripples
+        sprayParticles.emitter.velocity = glm::vec3(0.0f, 1.0f + 1.5f * std::max(0.0f, std::sin(currentFrame * 12.0f)), 0.0f);
+        size_t particleBytes = 0;
+        for (int i = 0; i < PARTICLE_SYSTEM_COUNT; i++) {
+            particleSystems[i].resize(programState->particleCounts[i]);
+            particleSystems[i].emitter.bloom = programState->particleBloom[i];
+            particleBytes += particleSystems[i].bufferBytes();
+        }
+        programState->particleBufferBytes = particleBytes;
+        if (programState->particlesEnabled) {
+            FrameGraph::Pass& particlePass = frameGraph.addPass("particles", [&](FrameGraph::Context& context) {
+                // the depth is sampled for the soft edges, so it can't be attached as well; the shader tests against it
+                context.bindTarget({sceneColor});
+                glDisable(GL_DEPTH_TEST);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.texture(sceneDepth));
+                particleShader.use();
+                particleShader.setInt("depth", 0);
+                particleShader.setMat4("view", view);
+                particleShader.setMat4("projection", projection);
+                particleShader.setVec2("screenSize", glm::vec2(sceneDesc.width, sceneDesc.height));
+                particleShader.setFloat("near", nearPlane);
+                particleShader.setFloat("far", farPlane);
+                particleShader.setFloat("softness", programState->particleSoftness);
+                particleShader.setFloat("time", currentFrame);
+                glm::vec3 wind = glm::vec3(oceanParams.windDirection.x, 0.0f, oceanParams.windDirection.y) *
+                                 (0.05f * programState->oceanWindSpeed);
+                size_t particlesRead = 0, particlesWritten = 0;
+                for (int i = 0; i < PARTICLE_SYSTEM_COUNT; i++) {
+                    if (!programState->particleSystemEnabled[i])
+                        continue;
+                    ParticleSystem& system = particleSystems[i];
+                    system.timer.begin();
+                    system.update(particleUpdateShader, currentFrame, deltaTime, wind, WATER_LEVEL);
+                    // just short of blooming, unless the system is allowed to
+                    system.draw(particleShader, programState->bloomThreshold * 0.95f);
+                    system.timer.end();
+                    programState->particleGpuMs[i] = system.timer.averageMilliseconds();
+                    // read by the update and again by the draw, written once
+                    particlesRead += system.bufferBytes();
+                    particlesWritten += system.bufferBytes() / 2;
+                }
+                glEnable(GL_DEPTH_TEST);
+                context.traffic(particlesRead, particlesWritten);
+            });
+            particlePass.read(sceneColor);
+            particlePass.read(sceneDepth);
+            particlePass.write(sceneColor);
+        }
+
+        // temporal anti-aliasing
+        // ----------------------
+        FrameResource hdrColor = sceneColor;
+        RenderTargetDesc hdrDesc = sceneDesc;
+        // out here, the passes only run once the whole graph is built
+        FrameResource velocity = NO_FRAME_RESOURCE;
+        if (taa) {
+            // the camera's motion follows from the depth buffer alone
+            FrameGraph::Pass& cameraVelocityPass = frameGraph.addPass("camera velocity", [&](FrameGraph::Context& context) {
+                context.bindTarget({velocity});
+                glDisable(GL_DEPTH_TEST);
+                glDisable(GL_BLEND);
+                taaCameraVelocityShader.use();
+                taaCameraVelocityShader.setInt("depth", 0);
+                taaCameraVelocityShader.setMat4("inverseViewProjection", glm::inverse(jitteredViewProjection));
+                taaCameraVelocityShader.setMat4("viewProjection", viewProjection);
+                taaCameraVelocityShader.setMat4("previousViewProjection", previousViewProjection);
+                glBindTexture(GL_TEXTURE_2D, context.texture(sceneDepth));
+                renderQuad();
+                glEnable(GL_BLEND);
+                glEnable(GL_DEPTH_TEST);
+            });
+            cameraVelocityPass.read(sceneDepth);
+            velocity = cameraVelocityPass.create("velocity", velocityDesc);
+
+            // what moves on its own is drawn over it, tested against the scene's depth so only visible parts count
+            FrameGraph::Pass& objectVelocityPass = frameGraph.addPass("object velocity", [&](FrameGraph::Context& context) {
+                context.bindTarget({velocity}, sceneDepth);
+                glDisable(GL_BLEND);
+                glDepthFunc(GL_LEQUAL);
+                glDepthMask(GL_FALSE);
+                auto useVelocityShader = [&](unsigned int keywords) -> Shader& {
+                    Shader& shader = taaObjectVelocityShaders.get(keywords);
+                    shader.use();
+                    shader.setMat4("jitteredViewProjection", jitteredViewProjection);
+                    shader.setMat4("viewProjection", viewProjection);
+                    shader.setMat4("previousViewProjection", previousViewProjection);
+                    return shader;
+                };
+                Shader& planeShader = useVelocityShader(0);
+                planeShader.setMat4("model", planeModel);
+                planeShader.setMat4("previousModel", previousPlaneModel);
+                ourPlane.Draw(planeShader);
+                // the fleet's node never moves, its instances are placed where they were by the time of last frame
+                if (fleetCount > 0) {
+                    Shader& fleetShader = useVelocityShader(INSTANCED);
+                    fleetShader.setMat4("model", fleetModel);
+                    fleetShader.setMat4("previousModel", fleetModel);
+                    fleetShader.setFloat("time", currentFrame);
+                    fleetShader.setFloat("previousTime", currentFrame - deltaTime);
+                    setInstanceSplines(fleetShader);
+                    for (Mesh& mesh: ourPlane.meshes)
+                        mesh.DrawInstanced(fleetShader, fleetCount);
+                }
+                // the flags in world space, from where the last frame drew them
+                Shader& clothShader = useVelocityShader(CLOTH);
+                clothShader.setMat4("model", glm::mat4(1.0f));
+                clothShader.setMat4("previousModel", glm::mat4(1.0f));
+                clothShader.setBool("moved", clothSteps > 0);
+                for (ClothMesh& flagMesh: flagMeshes)
+                    flagMesh.draw();
+                glDepthMask(GL_TRUE);
+                glDepthFunc(GL_LESS);
+                glEnable(GL_BLEND);
+            });
+            objectVelocityPass.read(sceneDepth);
+            objectVelocityPass.read(velocity);
+            objectVelocityPass.write(velocity);
+
+            FrameGraph::Pass& resolvePass = frameGraph.addPass("taa resolve", [&](FrameGraph::Context& context) {
+                temporalAA.resolve(context.texture(sceneColor), context.texture(velocity), taaResolveShader, renderQuad);
+                // the history of the last frame
+                context.traffic(temporalAA.desc().bytes(), 0);
+            });
+            resolvePass.read(sceneColor);
+            resolvePass.read(velocity);
+            hdrDesc = temporalAA.desc();
+            hdrColor = resolvePass.write(frameGraph.import("taa history", temporalAA.texture(), hdrDesc));
+        }
 
         // blur bright fragments with two-pass Gaussian Blur
         // --------------------------------------------------
-        bool horizontal = true, first_iteration = true;
-        unsigned int amount = 10;
-        blurShader.use();
-        for (unsigned int i = 0; i < amount; i++)
-        {
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-            blurShader.setInt("horizontal", horizontal);
-            glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
-            renderQuad();
-            horizontal = !horizontal;
-            if (first_iteration)
-                first_iteration = false;
+        if (programState->pingPongBlurSigma != blurKernelSigma) {
+            blurKernelSigma = programState->pingPongBlurSigma;
+            GaussianKernel blurKernel(blurKernelSigma);
+            blurShader.use();
+            blurKernel.set(blurShader);
+            computeBlur.setKernel(blurKernel);
+            fragmentBlurFetches = 2.0f * (float) blurKernel.fetches();
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        bool blurInCompute = computeBlur.available() && programState->computeBlurEnabled;
+        programState->pingPongBlurFetches = blurInCompute ? computeBlur.fetches() : fragmentBlurFetches;
+        bool mipChain = programState->bloomMode == BLOOM_MIP_CHAIN;
+        unsigned int bloomTexture = 0;
+        float bloomStrength = 1.0f;
+        FrameResource bloomResult = NO_FRAME_RESOURCE;
+        RenderTargetDesc bloomDesc = {hdrDesc.width, hdrDesc.height, formats.bloom};
+
+        // one horizontal and one vertical pass, the kernel is as wide as the blur has to be; in a compute shader
+        // from shared memory where the context has them, otherwise with linear sampled fetches
+        FrameResource blurredHorizontally = NO_FRAME_RESOURCE, blurred = NO_FRAME_RESOURCE;
+        FrameGraph::Pass& horizontalBlurPass = frameGraph.addPass("blur horizontal", [&](FrameGraph::Context& context) {
+            pingPongBloomTimer.begin();
+            if (blurInCompute) {
+                computeBlur.blur(context.texture(hdrColor), context.texture(blurredHorizontally), bloomDesc.width,
+                                 bloomDesc.height, bloomDesc.internalFormat, true, true, programState->bloomThreshold);
+            } else {
+                context.bindTarget({blurredHorizontally});
+                blurShader.use();
+                blurShader.setInt("horizontal", true);
+                blurShader.setInt("brightPass", true);
+                blurShader.setFloat("threshold", programState->bloomThreshold);
+                glBindTexture(GL_TEXTURE_2D, context.texture(hdrColor));
+                renderQuad();
+            }
+        });
+        horizontalBlurPass.read(hdrColor);
+        blurredHorizontally = horizontalBlurPass.create("blurred horizontally", bloomDesc);
+        FrameGraph::Pass& verticalBlurPass = frameGraph.addPass("blur vertical", [&](FrameGraph::Context& context) {
+            if (blurInCompute) {
+                computeBlur.blur(context.texture(blurredHorizontally), context.texture(blurred), bloomDesc.width,
+                                 bloomDesc.height, bloomDesc.internalFormat, false, false, 0.0f);
+            } else {
+                context.bindTarget({blurred});
+                blurShader.use();
+                blurShader.setInt("horizontal", false);
+                blurShader.setInt("brightPass", false);
+                glBindTexture(GL_TEXTURE_2D, context.texture(blurredHorizontally));
+                renderQuad();
+            }
+            pingPongBloomTimer.end();
+            programState->pingPongBloomGpuMs = pingPongBloomTimer.averageMilliseconds();
+            if (!mipChain) {
+                bloomTexture = context.texture(blurred);
+                bloomStrength = 1.0f;
+            }
+        });
+        verticalBlurPass.read(blurredHorizontally);
+        blurred = verticalBlurPass.create("blurred", bloomDesc);
+        if (programState->bloomCompare && mipChain)
+            verticalBlurPass.keep();
+
+        // or downsample them along a mip chain and blur them on the way back up
+        // ----------------------------------------------------------------------
+        mipChainBloom.resize(hdrDesc.width, hdrDesc.height, formats.bloom);
+        mipChainBloom.levels = programState->bloomLevels;
+        mipChainBloom.filterRadius = programState->bloomRadius;
+        mipChainBloom.intensity = programState->bloomIntensity;
+        mipChainBloom.threshold = programState->bloomThreshold;
+        mipChainBloom.skipWhenDark = programState->bloomSkipWhenDark;
+        FrameGraph::Pass& mipChainPass = frameGraph.addPass("mip chain bloom", [&](FrameGraph::Context& context) {
+            mipChainBloomTimer.begin();
+            unsigned int result = mipChainBloom.render(context.texture(hdrColor), bloomDownsampleShader, bloomUpsampleShader, renderQuad);
+            mipChainBloomTimer.end();
+            programState->mipChainBloomGpuMs = mipChainBloomTimer.averageMilliseconds();
+            programState->bloomSkipped = mipChainBloom.skipped();
+            size_t chainRead, chainWritten;
+            mipChainBloom.traffic(chainRead, chainWritten);
+            context.traffic(chainRead, chainWritten);
+            if (mipChain) {
+                bloomTexture = result;
+                bloomStrength = mipChainBloom.strength();
+            }
+        });
+        mipChainPass.read(hdrColor);
+        FrameResource mipChainResult = mipChainPass.write(frameGraph.import("mip chain bloom", mipChainBloom.texture(),
+                                                                            mipChainBloom.desc()));
+        if (programState->bloomCompare && !mipChain)
+            mipChainPass.keep();
+        if (bloom)
+            bloomResult = mipChain ? mipChainResult : blurred;
+
+        // meter the scene and adapt the exposure, all on the GPU
+        // ------------------------------------------------------
+        autoExposure.compensation = programState->exposureCompensation;
+        autoExposure.speedUp = programState->exposureSpeedUp;
+        autoExposure.speedDown = programState->exposureSpeedDown;
+        FrameGraph::Pass& exposurePass = frameGraph.addPass("auto exposure", [&](FrameGraph::Context& context) {
+            autoExposure.update(context.texture(hdrColor), deltaTime, exposureLuminanceShader, exposureHistogramShader,
+                                exposureAdaptShader, renderQuad);
+        });
+        exposurePass.read(hdrColor);
+        FrameResource exposureResult = exposurePass.write(frameGraph.import("exposure", autoExposure.texture(), autoExposure.desc()));
 
         // now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
         // --------------------------------------------------------------------------------------------------------------------------
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        hdrShader.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
-        hdrShader.setInt("bloom", bloom);
-        hdrShader.setFloat("exposure", exposure);
-        renderQuad();
+        colorGradingLut.update(programState->grading);
+        programState->lutRebuilds = colorGradingLut.rebuildCount();
+        FrameGraph::Pass& compositePass = frameGraph.addPass("tonemap", [&](FrameGraph::Context& context) {
+            context.bindTarget({});
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            unsigned int postKeywords = (programState->fxaaEnabled ? FXAA : 0u) | (programState->vignetteEnabled ? VIGNETTE : 0u);
+            postShaders.nextFrame();
+            Shader& hdrShader = postShaders.use(postKeywords, [&](Shader& shader) {
+                shader.setInt("scene", 0);
+                shader.setInt("bloomBlur", 1);
+                shader.setInt("exposureTexture", 2);
+                colorGradingLut.bind(shader, 3);
+                shader.setFloat("vignetteIntensity", programState->vignetteIntensity);
+            });
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.texture(hdrColor));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, bloomTexture);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, autoExposure.texture());
+            glActiveTexture(GL_TEXTURE0);
+            hdrShader.setInt("autoExposure", programState->autoExposure);
+            hdrShader.setInt("bloom", bloomResult != NO_FRAME_RESOURCE && bloomTexture != 0);
+            hdrShader.setFloat("bloomStrength", bloomStrength);
+            hdrShader.setFloat("exposure", exposure);
+            renderQuad();
+            context.traffic(0, RenderTargetDesc{width, height, GL_RGBA8}.bytes());
+        });
+        compositePass.read(hdrColor);
+        if (bloomResult != NO_FRAME_RESOURCE)
+            compositePass.read(bloomResult);
+        if (programState->autoExposure)
+            compositePass.read(exposureResult);
+        compositePass.keep();
+
+        frameGraph.execute(renderTargets);
+        frameTimer.end();
+        previousViewProjection = viewProjection;
+        previousPlaneModel = planeModel;
+        programState->frameGpuMs = frameTimer.averageMilliseconds();
+
+        // the governor overrides the knobs it turns for as long as it is enabled
+        if (programState->governorEnabled) {
+            if (!governorWasEnabled)
+                governor.reset(glfwGetTime());
+            governor.targetMs = programState->governorTargetMs;
+            governor.update(programState->frameGpuMs, glfwGetTime());
+            const QualitySettings& quality = governor.settings();
+            programState->renderScale = quality.renderScale;
+            programState->bloomLevels = quality.bloomLevels;
+            programState->textureLodBias = quality.textureLodBias;
+            programState->pointShadowInterval = quality.shadowUpdateInterval;
+            programState->governorLevel = governor.currentLevel();
+        }
+        governorWasEnabled = programState->governorEnabled;
+        if (programState->textureLodBias != appliedLodBias) {
+            appliedLodBias = programState->textureLodBias;
+            for (unsigned int texture: lodBiasedTextures) {
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, appliedLodBias);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        programState->executedPasses = frameGraph.passTraffic();
+        programState->trafficBytes = frameGraph.trafficBytes();
+        programState->culledPasses = frameGraph.culledPasses();
+        programState->renderTargetCount = renderTargets.textureCount();
+        programState->renderTargetBytes = renderTargets.bytes();
+
+        if (programState->ImGuiEnabled)
+            DrawImGui(programState);
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -630,11 +1677,44 @@ int main() {
     glDeleteBuffers(1, &skyboxVBO);
     glDeleteVertexArrays(1, &planeVAO);
     glDeleteBuffers(1, &planeVBO);
-    glDeleteFramebuffers(1, &hdrFBO);
-    glDeleteTextures(2, colorBuffers);
-    glDeleteRenderbuffers(1, &rboDepth);
-    glDeleteFramebuffers(2, pingpongFBO);
-    glDeleteTextures(2, pingpongColorbuffers);
+    renderTargets.destroy();
+    frameTimer.destroy();
+    autoExposure.destroy();
+    colorGradingLut.destroy();
+    planarReflection.destroy();
+    reflectionTimer.destroy();
+    ocean.destroy();
+    ripples.destroy();
+    rippleTimer.destroy();
+    temporalAA.destroy();
+    postShaders.destroy();
+    cascadedShadowMap.destroy();
+    shadowTimer.destroy();
+    pointShadowMaps.destroy();
+    pointShadowTimer.destroy();
+    mipChainBloom.destroy();
+    mipChainBloomTimer.destroy();
+    pingPongBloomTimer.destroy();
+    computeBlur.destroy();
+    bakedLightmap.destroy();
+    modelShaders.destroy();
+    taaObjectVelocityShaders.destroy();
+    shadowDepthShaders.destroy();
+    pointShadowDepthShaders.destroy();
+    planeShaders.destroy();
+    terrainShaders.destroy();
+    terrain.destroy();
+    caustics.destroy();
+    for (ClothMesh& flagMesh: flagMeshes)
+        flagMesh.destroy();
+    for (ParticleSystem& system: particleSystems)
+        system.destroy();
+    cityInstances.destroy();
+    fleetInstances.destroy();
+
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -642,23 +1722,6 @@ int main() {
     return 0;
 }
 
-void hdr_resize() {
-    for (unsigned int i = 0; i < 2; i++) {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(
-                GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL
-        );
-    }
-
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-
-    for (unsigned int i = 0; i < 2; i++) {
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    }
-}
-
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window) {
@@ -680,9 +1743,7 @@ void processInput(GLFWwindow *window) {
 void framebuffer_size_callback(GLFWwindow *window, int _width, int _height) {
     width = _width;
     height = _height;
-    hdr_resize();
-
-    glViewport(0, 0, width, height);
+    lastResizeTime = glfwGetTime();
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -731,6 +1792,227 @@ void DrawImGui(ProgramState *programState) {
         ImGui::End();
     }
 
+    {
+        ImGui::Begin("Shadows");
+        ImGui::Checkbox("Sun shadows", &programState->shadowsEnabled);
+        ImGui::Text("GPU time: %.3f ms (budget 1 ms)", programState->shadowGpuMs);
+        ImGui::Text("Static cascades redrawn: %d", programState->shadowStaticRedraws);
+        ImGui::Separator();
+        ImGui::SliderInt("Point shadow updates per frame", &programState->pointShadowUpdatesPerFrame, 0, PointShadowMaps::MAX_LIGHTS);
+        ImGui::Text("Point shadows GPU time: %.3f ms", programState->pointShadowGpuMs);
+        ImGui::Text("Updated: %d, waiting: %d", programState->pointShadowUpdates, programState->pointShadowPending);
+        ImGui::Separator();
+        if (programState->bakedLightingAvailable)
+            ImGui::Checkbox("Baked lighting on static objects", &programState->bakedLightingEnabled);
+        else
+            ImGui::Text("No baked lighting, run lightmap_baker");
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Seabed");
+        if (programState->terrainAvailable) {
+            ImGui::Checkbox("Terrain", &programState->terrainEnabled);
+            ImGui::Text("Nodes drawn: %d, culled: %d", programState->terrainNodes, programState->terrainCulled);
+            ImGui::Text("Tiles cached: %d of %d (%.2f MB)", programState->terrainResident, Terrain::CACHE_TILES,
+                        programState->terrainCacheBytes / (1024.0 * 1024.0));
+            ImGui::Text("Tiles loading: %d", programState->terrainPending);
+        } else {
+            ImGui::Text("No terrain, run terrain_builder");
+        }
+        if (programState->causticsAvailable) {
+            ImGui::Checkbox("Caustics", &programState->causticsEnabled);
+            ImGui::SliderFloat("Caustics strength", &programState->causticsStrength, 0.0f, 1.0f);
+            ImGui::Text("Caustics frames: %.2f MB", programState->causticsBytes / (1024.0 * 1024.0));
+        } else {
+            ImGui::Text("No caustics, run caustics_baker");
+        }
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Shaders");
+        ImGui::Checkbox("Fog", &programState->fogEnabled);
+        ImGui::DragFloat("Fog density", &programState->fogDensity, 0.001f, 0.0f, 0.2f);
+        ImGui::ColorEdit3("Fog color", (float *) &programState->fogColor);
+        ImGui::Text("Variants compiled: %d", programState->shaderVariants);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Bloom");
+        ImGui::Checkbox("Bloom", &bloom);
+        ImGui::RadioButton("Mip chain", &programState->bloomMode, BLOOM_MIP_CHAIN);
+        ImGui::SameLine();
+        ImGui::RadioButton("Ping-pong Gaussian", &programState->bloomMode, BLOOM_PING_PONG);
+        if (programState->bloomMode == BLOOM_MIP_CHAIN) {
+            ImGui::SliderInt("Levels", &programState->bloomLevels, 1, MipChainBloom::MAX_LEVELS);
+            ImGui::DragFloat("Radius", &programState->bloomRadius, 0.0005f, 0.0f, 0.02f, "%.4f");
+            ImGui::Checkbox("Skip when nothing is bright", &programState->bloomSkipWhenDark);
+            if (programState->bloomSkipped)
+                ImGui::Text("Skipped, nothing was bright");
+        } else {
+            ImGui::SliderFloat("Sigma", &programState->pingPongBlurSigma, 0.5f, 10.0f);
+            if (programState->computeBlurAvailable)
+                ImGui::Checkbox("Compute shader", &programState->computeBlurEnabled);
+            else
+                ImGui::Text("Compute shader: needs GL 4.3");
+            ImGui::Text("Texture fetches per pixel: %.1f", programState->pingPongBlurFetches);
+        }
+        ImGui::DragFloat("Threshold", &programState->bloomThreshold, 0.01f, 0.0f, 10.0f);
+        ImGui::DragFloat("Intensity", &programState->bloomIntensity, 0.05f, 0.0f, 4.0f);
+        ImGui::Checkbox("Time both", &programState->bloomCompare);
+        ImGui::Text("Mip chain GPU time: %.3f ms", programState->mipChainBloomGpuMs);
+        ImGui::Text("Ping-pong GPU time: %.3f ms", programState->pingPongBloomGpuMs);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Quality");
+        ImGui::Text("GPU frame time: %.2f ms", programState->frameGpuMs);
+        ImGui::Checkbox("Governor", &programState->governorEnabled);
+        ImGui::DragFloat("Target frame time (ms)", &programState->governorTargetMs, 0.1f, 4.0f, 50.0f);
+        if (programState->governorEnabled)
+            ImGui::Text("Level %d", programState->governorLevel);
+        ImGui::SliderFloat("Render scale", &programState->renderScale, 0.25f, 1.0f);
+        ImGui::SliderFloat("Texture LOD bias", &programState->textureLodBias, 0.0f, 2.0f);
+        ImGui::SliderInt("Point shadow interval", &programState->pointShadowInterval, 1, 8);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Exposure");
+        ImGui::Checkbox("Auto exposure", &programState->autoExposure);
+        if (programState->autoExposure) {
+            ImGui::DragFloat("Compensation (stops)", &programState->exposureCompensation, 0.05f, -4.0f, 4.0f);
+            ImGui::DragFloat("Adapt to bright", &programState->exposureSpeedUp, 0.05f, 0.1f, 10.0f);
+            ImGui::DragFloat("Adapt to dark", &programState->exposureSpeedDown, 0.05f, 0.1f, 10.0f);
+        } else {
+            ImGui::DragFloat("Exposure", &exposure, 0.01f, 0.05f, 8.0f);
+        }
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Water");
+        ImGui::Checkbox("Reflections", &programState->reflectionsEnabled);
+        if (programState->reflectionsEnabled) {
+            ImGui::DragFloat("Redraw after moving", &programState->reflectionThreshold, 0.005f, 0.0f, 1.0f);
+            ImGui::DragFloat("Budget (ms per frame)", &programState->reflectionBudgetMs, 0.05f, 0.05f, 5.0f);
+            ImGui::SliderFloat("Distortion", &programState->reflectionDistortion, 0.0f, 1.0f);
+            ImGui::Text("Reflection GPU time: %.3f ms per update", programState->reflectionGpuMs);
+            ImGui::Text("Updated in %.0f%% of frames", programState->reflectionUpdateRate * 100.0f);
+        }
+        ImGui::Checkbox("Refraction", &programState->refractionEnabled);
+        if (programState->refractionEnabled) {
+            ImGui::SliderFloat("Bending", &programState->refractionStrength, 0.0f, 0.2f);
+            ImGui::DragFloat3("Absorption", (float *) &programState->waterAbsorption, 0.005f, 0.0f, 2.0f);
+        }
+        ImGui::Text("Transparency");
+        ImGui::RadioButton("Weighted blended", &programState->transparencyMode, TRANSPARENCY_WEIGHTED);
+        ImGui::SameLine();
+        ImGui::RadioButton("Sorted", &programState->transparencyMode, TRANSPARENCY_SORTED);
+        ImGui::Text("Transparent draws: %d", programState->transparentDraws);
+        ImGui::Checkbox("Simulated waves", &programState->oceanEnabled);
+        if (programState->oceanEnabled) {
+            const char* resolutions[] = {"128 x 128", "256 x 256", "512 x 512"};
+            ImGui::Combo("Resolution", &programState->oceanResolution, resolutions, 3);
+            ImGui::DragFloat("Wind speed", &programState->oceanWindSpeed, 0.1f, 0.5f, 20.0f);
+            ImGui::SliderFloat("Choppiness", &programState->oceanChoppiness, 0.0f, 2.0f);
+            ImGui::Text("Simulation and upload: %.2f ms CPU", programState->oceanCpuMs);
+            ImGui::Text("Streamed: %.2f MB per frame", programState->oceanUploadBytes / (1024.0 * 1024.0));
+        }
+        ImGui::Checkbox("Ripples", &programState->ripplesEnabled);
+        if (programState->ripplesEnabled) {
+            ImGui::DragFloat("Boat push", &programState->rippleStrength, 0.0005f, 0.0f, 0.05f);
+            ImGui::SliderFloat("Ripple damping", &programState->rippleDamping, 0.9f, 1.0f);
+            ImGui::Text("Ripple GPU time: %.3f ms, %d ticks this frame", programState->rippleGpuMs, programState->rippleTicks);
+        }
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Flags");
+        ImGui::Checkbox("Simulate cloth", &programState->clothEnabled);
+        if (programState->clothEnabled) {
+            ImGui::SliderInt("Iterations", &programState->clothIterations, 1, 32);
+            ImGui::SliderFloat("Bend stiffness", &programState->clothBendStiffness, 0.0f, 1.0f);
+            ImGui::Checkbox("SSE", &programState->clothSimd);
+            ImGui::SameLine();
+            ImGui::Checkbox("Job pool", &programState->clothParallel);
+            ImGui::Text("Simulation: %.3f ms CPU, %d steps this frame", programState->clothCpuMs, programState->clothSteps);
+            ImGui::Text("Streamed: %.1f KB per frame", programState->clothUploadBytes / 1024.0);
+        }
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Particles");
+        ImGui::Checkbox("Enabled", &programState->particlesEnabled);
+        ImGui::SliderFloat("Soft edges", &programState->particleSoftness, 0.01f, 2.0f);
+        const char* particleSystemNames[] = {"Lantern embers", "Boat spray", "Gulls"};
+        for (int i = 0; i < PARTICLE_SYSTEM_COUNT; i++) {
+            ImGui::PushID(i);
+            ImGui::Checkbox(particleSystemNames[i], &programState->particleSystemEnabled[i]);
+            if (programState->particleSystemEnabled[i]) {
+                ImGui::DragInt("Count", &programState->particleCounts[i], 64.0f, 64, 262144);
+                ImGui::Checkbox("Bloom", &programState->particleBloom[i]);
+                ImGui::Text("GPU time: %.3f ms", programState->particleGpuMs[i]);
+            }
+            ImGui::PopID();
+        }
+        ImGui::Text("Particle buffers: %.2f MB", programState->particleBufferBytes / (1024.0 * 1024.0));
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Fleet");
+        ImGui::Checkbox("Enabled", &programState->fleetEnabled);
+        if (programState->fleetEnabled)
+            ImGui::DragInt("Aircraft", &programState->fleetCount, 4.0f, 0, MAX_FLEET);
+        ImGui::Text("Instance buffers: %.1f KB, uploaded once", programState->instanceBufferBytes / 1024.0);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Post processing");
+        ImGui::DragFloat("Gamma", &programState->grading.gamma, 0.01f, 0.5f, 3.0f);
+        ImGui::DragFloat("Saturation", &programState->grading.saturation, 0.01f, 0.0f, 2.0f);
+        ImGui::DragFloat("Contrast", &programState->grading.contrast, 0.01f, 0.5f, 2.0f);
+        ImGui::ColorEdit3("Color filter", (float *) &programState->grading.colorFilter);
+        ImGui::Text("LUT rebuilds: %d", programState->lutRebuilds);
+        ImGui::Checkbox("Temporal anti-aliasing", &programState->taaEnabled);
+        if (programState->taaEnabled)
+            ImGui::SliderFloat("History feedback", &programState->taaFeedback, 0.5f, 0.98f);
+        ImGui::Checkbox("FXAA", &programState->fxaaEnabled);
+        ImGui::Checkbox("Vignette", &programState->vignetteEnabled);
+        if (programState->vignetteEnabled)
+            ImGui::SliderFloat("Vignette intensity", &programState->vignetteIntensity, 0.0f, 1.0f);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Frame graph");
+        const float MB = 1024.0f * 1024.0f;
+        ImGui::Text("HDR targets:");
+        for (int precision = 0; precision < PRECISION_COUNT; precision++) {
+            ImGui::SameLine();
+            ImGui::RadioButton(RenderTargetFormats::name((RenderTargetPrecision) precision), &programState->precision, precision);
+        }
+        ImGui::Checkbox("32 bit float depth", &programState->depth32);
+        ImGui::Separator();
+        for (const FrameGraph::PassTraffic& pass: programState->executedPasses)
+            ImGui::Text("%s: %.2f MB read, %.2f MB written", pass.name.c_str(), (float) pass.bytesRead / MB,
+                        (float) pass.bytesWritten / MB);
+        for (const std::string& pass: programState->culledPasses)
+            ImGui::TextDisabled("%s (culled)", pass.c_str());
+        ImGui::Separator();
+        ImGui::Text("Framebuffer traffic: %.1f MB/frame", (float) programState->trafficBytes / MB);
+        ImGui::Text("Render targets: %d, %.1f MB", programState->renderTargetCount,
+                    (float) programState->renderTargetBytes / MB);
+        ImGui::End();
+    }
+
     {
         ImGui::Begin("Camera info");
         const Camera& c = programState->camera;
@@ -867,4 +2149,80 @@ void renderQuad()
     glBindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     glBindVertexArray(0);
-}
\ No newline at end of file
+}
+
+// bounding sphere (xyz center, w radius) around all the vertices of a model, in model space
+// -----------------------------------------------------------------------------------------
+glm::vec4 computeBoundingSphere(const Model& model)
+{
+    glm::vec3 minCorner(std::numeric_limits<float>::max());
+    glm::vec3 maxCorner(-std::numeric_limits<float>::max());
+    for (const Mesh& mesh: model.meshes)
+        for (const Vertex& vertex: mesh.vertices) {
+            minCorner = glm::min(minCorner, vertex.Position);
+            maxCorner = glm::max(maxCorner, vertex.Position);
+        }
+    glm::vec3 center = (minCorner + maxCorner) * 0.5f;
+    float radius = 0.0f;
+    for (const Mesh& mesh: model.meshes)
+        for (const Vertex& vertex: mesh.vertices)
+            radius = std::max(radius, glm::length(vertex.Position - center));
+    return glm::vec4(center, radius);
+}
+
+ShadowCaster transformBoundingSphere(glm::vec4 sphere, const glm::mat4& model, std::function<void(Shader&)> draw)
+{
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    return ShadowCaster{glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f)), sphere.w * scale, draw};
+}
+
+// The aircraft of the fleet: the first ones queue on the landing circuits, which touch down on the water either side
+// of the row of buildings and turn away from it, and the rest circle the city, further out and at all heights the
+// more of them there are. The same random stream every time, so a smaller count is the start of a larger one.
+std::vector<InstanceData> buildFleet(int count, float waterLevel)
+{
+    const int CIRCUITS = 2, LANDING_SLOTS = 6;
+    const glm::vec3 circuitCenters[CIRCUITS] = {glm::vec3(3.0f, waterLevel, -1.5f), glm::vec3(-3.0f, waterLevel, 0.5f)};
+    std::mt19937 random(2024);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<InstanceData> fleet;
+    fleet.reserve(count);
+    int landing = 0;
+    for (int i = 0; i < count; i++) {
+        InstanceAnimation animation;
+        if (i % 4 == 0 && landing < CIRCUITS * LANDING_SLOTS) {
+            int circuit = landing % CIRCUITS;
+            // the circuit on the other side is turned around, so both turn away from the buildings
+            animation.center = circuitCenters[circuit];
+            animation.radius = circuit == 0 ? 1.2f : -1.2f;
+            animation.phase = (float) (landing / CIRCUITS) / (float) LANDING_SLOTS;
+            animation.speed = 0.12f;
+            animation.spline = SPLINE_LANDING;
+            animation.scale = 0.5f;
+            landing++;
+        } else {
+            animation.radius = 6.0f + 0.6f * std::sqrt((float) i) + 2.0f * unit(random);
+            animation.center = glm::vec3(0.0f, 3.0f + 6.0f * unit(random), -1.0f);
+            animation.phase = unit(random);
+            // three to five units a second, either way round
+            float speed = (3.0f + 2.0f * unit(random)) / (glm::radians(360.0f) * animation.radius);
+            animation.speed = unit(random) < 0.5f ? speed : -speed;
+            animation.spline = SPLINE_CIRCLE;
+            animation.scale = 0.4f + 0.3f * unit(random);
+        }
+        fleet.push_back(animatedInstance(animation));
+    }
+    return fleet;
+}
+
+// keywords shared by every lit draw of the scene pass, materials and baked lighting add their own
+// ------------------------------------------------------------------------------------------------
+unsigned int scenePassKeywords(ProgramState *programState)
+{
+    unsigned int keywords = pointLightsKeyword(1);
+    if (programState->shadowsEnabled)
+        keywords |= SHADOWS;
+    if (programState->fogEnabled)
+        keywords |= FOG;
+    return keywords;
+}
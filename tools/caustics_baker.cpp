@@ -0,0 +1,162 @@
+// Bakes the caustics drawn on the seabed (rg/Caustics.h): light coming straight down is refracted by a wavy water
+// surface, and where it lands CAUSTICS_DEPTH below is gathered into one frame for each step of a loop of the
+// waves. The surface is a sum of waves that repeat over the tile and over the loop, with whole numbers of
+// wavelengths across the one and whole numbers of periods in the other, so every frame tiles and the last one
+// leads back into the first. Frames are independent and baked in parallel.
+// Run it from the repository root, like the application. An up to date bake is left alone unless --force is given.
+
+#include <glm/glm.hpp>
+
+#include <rg/CausticsFile.h>
+#include <rg/JobPool.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+const float TWO_PI = 6.28318530718f;
+// air to water
+const float ETA = 1.0f / 1.33f;
+const int WAVE_COUNT = 12;
+
+struct Wave {
+    // whole wavelengths across the tile
+    glm::vec2 k;
+    float amplitude;
+    // angular frequency, a whole number of periods in the loop
+    float omega;
+    float phase;
+};
+
+std::vector<Wave> makeWaves() {
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> cycles(-5, 5), periods(1, 2);
+    std::uniform_real_distribution<float> phase(0.0f, TWO_PI);
+    std::vector<Wave> waves;
+    while ((int) waves.size() < WAVE_COUNT) {
+        glm::ivec2 n(cycles(random), cycles(random));
+        float length = std::sqrt((float) (n.x * n.x + n.y * n.y));
+        if (length < 2.0f || length > 5.0f)
+            continue;
+        Wave wave;
+        wave.k = glm::vec2(n) * (TWO_PI / CAUSTICS_TILE_SIZE);
+        float k2 = glm::dot(wave.k, wave.k);
+        // a wave of curvature a k^2 bends the light into a focus (1 - ETA) a k^2 below, the waves share the
+        // curvature evenly so that together they focus at about the depth the light is gathered at
+        float curvature = 1.0f / ((1.0f - ETA) * CAUSTICS_DEPTH * std::sqrt(WAVE_COUNT * 0.5f));
+        wave.amplitude = curvature / k2;
+        wave.omega = (float) periods(random) * TWO_PI / CAUSTICS_PERIOD;
+        wave.phase = phase(random);
+        waves.push_back(wave);
+    }
+    return waves;
+}
+
+// height of the surface and its slopes along x and z
+glm::vec3 surface(const std::vector<Wave>& waves, glm::vec2 position, float time) {
+    glm::vec3 result(0.0f);
+    for (const Wave& wave: waves) {
+        float angle = glm::dot(wave.k, position) - wave.omega * time + wave.phase;
+        result.x += wave.amplitude * std::sin(angle);
+        float slope = wave.amplitude * std::cos(angle);
+        result.y += slope * wave.k.x;
+        result.z += slope * wave.k.y;
+    }
+    return result;
+}
+
+// light gathered under one tile at the given time, 1 where the surface is still
+void bakeFrame(const std::vector<Wave>& waves, float time, int frame, std::vector<float>& light) {
+    const int size = CAUSTICS_SIZE, side = CAUSTICS_PHOTONS_PER_SIDE;
+    const float texel = CAUSTICS_TILE_SIZE / (float) size;
+    const float weight = 1.0f / (float) (side * side);
+    light.assign((size_t) size * size, 0.0f);
+    std::mt19937 random((unsigned int) frame);
+    std::uniform_real_distribution<float> jitter(0.0f, 1.0f);
+    for (int z = 0; z < size * side; z++)
+        for (int x = 0; x < size * side; x++) {
+            glm::vec2 position = (glm::vec2((float) x, (float) z) + glm::vec2(jitter(random), jitter(random))) *
+                                 (texel / (float) side);
+            glm::vec3 h = surface(waves, position, time);
+            glm::vec3 normal = glm::normalize(glm::vec3(-h.y, 1.0f, -h.z));
+            // Snell's law for light going straight down, cos of the incident angle is normal.y
+            float cosIncident = normal.y;
+            float cosRefracted = std::sqrt(1.0f - ETA * ETA * (1.0f - cosIncident * cosIncident));
+            glm::vec3 refracted = ETA * glm::vec3(0.0f, -1.0f, 0.0f) + (ETA * cosIncident - cosRefracted) * normal;
+            glm::vec2 landed = position + glm::vec2(refracted.x, refracted.z) * ((CAUSTICS_DEPTH + h.x) / -refracted.y);
+
+            // shared between the four nearest texels, wrapping around the tile
+            glm::vec2 coords = landed / texel - 0.5f;
+            float fx = std::floor(coords.x), fz = std::floor(coords.y);
+            float wx = coords.x - fx, wz = coords.y - fz;
+            int x0 = (((int) fx % size) + size) % size, z0 = (((int) fz % size) + size) % size;
+            int x1 = (x0 + 1) % size, z1 = (z0 + 1) % size;
+            light[(size_t) z0 * size + x0] += weight * (1.0f - wx) * (1.0f - wz);
+            light[(size_t) z0 * size + x1] += weight * wx * (1.0f - wz);
+            light[(size_t) z1 * size + x0] += weight * (1.0f - wx) * wz;
+            light[(size_t) z1 * size + x1] += weight * wx * wz;
+        }
+}
+
+int main(int argc, char** argv) {
+    bool force = argc > 1 && std::strcmp(argv[1], "--force") == 0;
+    auto start = std::chrono::steady_clock::now();
+
+    uint64_t hash = hashCausticsSettings();
+    std::string path = causticsPath(hash);
+    CausticsData existing;
+    if (!force && readCaustics(path, hash, existing)) {
+        std::cout << "Caustics are up to date: " << path << std::endl;
+        return 0;
+    }
+
+    std::vector<Wave> waves = makeWaves();
+    CausticsData data;
+    data.size = CAUSTICS_SIZE;
+    data.frames = CAUSTICS_FRAMES;
+    data.tileSize = CAUSTICS_TILE_SIZE;
+    data.period = CAUSTICS_PERIOD;
+    data.range = CAUSTICS_RANGE;
+    size_t frameTexels = (size_t) CAUSTICS_SIZE * CAUSTICS_SIZE;
+    data.texels.resize(frameTexels * CAUSTICS_FRAMES);
+
+    JobPool pool;
+    std::cout << "Baking " << CAUSTICS_FRAMES << " frames with " << pool.threadCount() << " threads" << std::endl;
+    std::atomic<int> framesDone(0);
+    std::atomic<int> clipped(0);
+    pool.parallelFor(CAUSTICS_FRAMES, [&](int frame) {
+        std::vector<float> light;
+        bakeFrame(waves, CAUSTICS_PERIOD * (float) frame / (float) CAUSTICS_FRAMES, frame, light);
+        uint8_t* texels = &data.texels[frameTexels * frame];
+        int over = 0;
+        for (size_t i = 0; i < frameTexels; i++) {
+            float value = light[i] / CAUSTICS_RANGE;
+            over += value > 1.0f;
+            texels[i] = (uint8_t) std::lround(std::min(value, 1.0f) * 255.0f);
+        }
+        clipped += over;
+        int done = ++framesDone;
+        if (done % 16 == 0)
+            std::cout << "  " << done << " / " << CAUSTICS_FRAMES << " frames" << std::endl;
+    });
+    std::cout << "Texels brighter than the range: "
+              << 100.0 * clipped / (double) data.texels.size() << "%" << std::endl;
+
+    mkdir(CAUSTICS_DIRECTORY, 0755);
+    if (!writeCaustics(path, hash, data)) {
+        std::cout << "Failed to write " << path << std::endl;
+        return 1;
+    }
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << path << " in " << seconds << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,81 @@
+// Measures the cloth of the flags (rg/ClothSimulation.h): a frame of 1, 10 and 100 flags of the size the application
+// uses, with the constraints solved one at a time and four at a time with SSE, on one thread and with the flags
+// spread over the job pool. The SSE solver is checked against the scalar one, which it should match but for rounding.
+
+#include <rg/ClothSimulation.h>
+#include <rg/JobPool.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// frames to time for every measurement, after some to let the flags unfold
+const int FRAMES = 100;
+const int WARM_UP = 60;
+// steps of a frame at 60 frames per second
+const int STEPS = 2;
+
+std::vector<Cloth> makeFlags(int count) {
+    std::vector<Cloth> flags;
+    for (int i = 0; i < count; i++) {
+        glm::vec3 place((float) (i % 10) * 3.0f, 0.0f, (float) (i / 10) * 3.0f);
+        flags.emplace_back(24, 18, glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(2.4f, 0.0f, 0.0f), glm::vec3(0.0f, -1.8f, 0.0f),
+                           glm::translate(glm::mat4(1.0f), place));
+    }
+    return flags;
+}
+
+// runs the frames and returns the milliseconds per frame
+double millisecondsPerFrame(std::vector<Cloth>& flags, ClothSolver& solver, JobPool* pool) {
+    float time = 0.0f;
+    for (int frame = 0; frame < WARM_UP; frame++, time += STEPS / solver.params.stepRate)
+        solver.simulate(flags, time, STEPS, pool);
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < FRAMES; frame++, time += STEPS / solver.params.stepRate)
+        solver.simulate(flags, time, STEPS, pool);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / FRAMES;
+}
+
+// largest distance between the particles of a flag solved both ways
+float simdError() {
+    std::vector<Cloth> scalar = makeFlags(1), simd = makeFlags(1);
+    ClothSolver solver;
+    solver.params.simd = false;
+    millisecondsPerFrame(scalar, solver, nullptr);
+    solver.params.simd = true;
+    millisecondsPerFrame(simd, solver, nullptr);
+    float error = 0.0f;
+    for (int row = 0; row < scalar[0].rows(); row++)
+        for (int column = 0; column < scalar[0].columns(); column++)
+            error = std::max(error, glm::length(scalar[0].position(column, row) - simd[0].position(column, row)));
+    return error;
+}
+
+int main() {
+    JobPool pool;
+    std::vector<Cloth> one = makeFlags(1);
+    std::printf("%u threads, %d particles and %d constraints per flag, %d steps of %d iterations per frame\n\n",
+                pool.threadCount(), one[0].particleCount(), one[0].constraintCount(), STEPS, ClothParams().iterations);
+
+    std::printf("%-6s %14s %14s %14s %16s\n", "flags", "scalar ms", "SSE ms", "SSE + pool ms", "Mconstraints/s");
+    for (int count: {1, 10, 100}) {
+        ClothSolver solver;
+        std::vector<Cloth> flags = makeFlags(count);
+        solver.params.simd = false;
+        double scalar = millisecondsPerFrame(flags, solver, nullptr);
+        flags = makeFlags(count);
+        solver.params.simd = true;
+        double simd = millisecondsPerFrame(flags, solver, nullptr);
+        flags = makeFlags(count);
+        double pooled = millisecondsPerFrame(flags, solver, &pool);
+        double solves = (double) count * flags[0].constraintCount() * STEPS * solver.params.iterations;
+        std::printf("%-6d %14.3f %14.3f %14.3f %16.1f\n", count, scalar, simd, pooled, solves * 1e-3 / pooled);
+    }
+
+    std::printf("\nLargest difference between SSE and scalar: %.2e\n", simdError());
+    return 0;
+}
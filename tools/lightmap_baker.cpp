@@ -0,0 +1,845 @@
+// Bakes the lighting of the static part of the scene (rg/StaticScene.h) into a lightmap atlas: the sun, the sky
+// and LIGHTMAP_BOUNCES bounces of indirect light in rgb, ambient occlusion in alpha. The lightmap coordinates
+// are generated here as well and stored along with the atlas, so the models need no second uv set.
+// Run it from the repository root, like the application. An up to date bake is left alone unless --force is given.
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <stb_image.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <rg/JobPool.h>
+#include <rg/LightmapFile.h>
+#include <rg/StaticScene.h>
+
+#include <xmmintrin.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// texels of empty space around every chart and every instance, so that bilinear filtering and mip mapping
+// don't pull in light from a neighbour
+const int PADDING = 2;
+// occluders further than this don't count for ambient occlusion
+const float AO_DISTANCE = 1.0f;
+// offset of ray origins along the normal, against self intersection
+const float RAY_EPSILON = 2e-3f;
+
+// Scene
+// -----
+
+struct BakeMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<uint32_t> indices;
+    glm::vec3 albedo = glm::vec3(0.6f);
+};
+
+struct BakeModel {
+    std::vector<BakeMesh> meshes;
+};
+
+// average color of a texture, as the shaders see it
+glm::vec3 averageColor(const std::string& path, bool srgb, glm::vec3 fallback) {
+    int width, height, components;
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &components, 3);
+    if (!data)
+        return fallback;
+    glm::vec3 sum(0.0f);
+    for (int i = 0; i < width * height; i++)
+        for (int c = 0; c < 3; c++) {
+            float value = data[3 * i + c] / 255.0f;
+            sum[c] += srgb ? std::pow(value, 2.2f) : value;
+        }
+    stbi_image_free(data);
+    return sum / (float) (width * height);
+}
+
+// walks the nodes in the same order as Model::processNode, the lightmap layouts are matched to meshes by index;
+// withoutCloth leaves out the simulated cloth of the flag model like the application does
+void collectMeshes(const aiNode* node, const aiScene* scene, const std::string& directory, bool withoutCloth,
+                   BakeModel& model) {
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+        BakeMesh bakeMesh;
+        for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
+            bakeMesh.positions.push_back(glm::vec3(mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z));
+            bakeMesh.normals.push_back(mesh->HasNormals()
+                                       ? glm::vec3(mesh->mNormals[v].x, mesh->mNormals[v].y, mesh->mNormals[v].z)
+                                       : glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+        for (unsigned int f = 0; f < mesh->mNumFaces; f++)
+            for (unsigned int j = 0; j < mesh->mFaces[f].mNumIndices; j++)
+                bakeMesh.indices.push_back(mesh->mFaces[f].mIndices[j]);
+        // points and lines left over by triangulation would shift every following triangle
+        bakeMesh.indices.resize(bakeMesh.indices.size() / 3 * 3);
+        if (withoutCloth && mesh->mTextureCoords[0]) {
+            auto uv = [&](uint32_t v) { return glm::vec2(mesh->mTextureCoords[0][v].x, mesh->mTextureCoords[0][v].y); };
+            std::vector<uint32_t> kept;
+            for (size_t t = 0; t + 2 < bakeMesh.indices.size(); t += 3) {
+                const uint32_t* triangle = &bakeMesh.indices[t];
+                if (isFlagPoleTriangle(uv(triangle[0]), uv(triangle[1]), uv(triangle[2])))
+                    kept.insert(kept.end(), triangle, triangle + 3);
+            }
+            bakeMesh.indices = kept;
+        }
+
+        const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        if (material->GetTextureCount(aiTextureType_DIFFUSE) > 0) {
+            aiString texture;
+            material->GetTexture(aiTextureType_DIFFUSE, 0, &texture);
+            bakeMesh.albedo = averageColor(directory + '/' + texture.C_Str(), false, bakeMesh.albedo);
+        }
+        model.meshes.push_back(std::move(bakeMesh));
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+        collectMeshes(node->mChildren[i], scene, directory, withoutCloth, model);
+}
+
+bool loadModel(const std::string& path, bool withoutCloth, BakeModel& model) {
+    Assimp::Importer importer;
+    // same flags as Model, they decide the vertex order
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+    collectMeshes(scene->mRootNode, scene, path.substr(0, path.find_last_of('/')), withoutCloth, model);
+    return true;
+}
+
+// Lightmap coordinates
+// --------------------
+// Triangles are grouped by the axis their normal is closest to (and its sign), connected triangles of the same
+// group form a chart, which is projected along that axis. Charts are packed into a square with a shelf packer.
+
+struct Chart {
+    int mesh;
+    int axis;
+    std::vector<uint32_t> triangles;
+    glm::vec2 min, max;
+    glm::vec2 offset;
+};
+
+int findRoot(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+glm::vec2 project(glm::vec3 p, int axis) {
+    if (axis == 0)
+        return glm::vec2(p.z, p.y);
+    if (axis == 1)
+        return glm::vec2(p.x, p.z);
+    return glm::vec2(p.x, p.y);
+}
+
+glm::vec3 triangleNormal(const BakeMesh& mesh, uint32_t triangle) {
+    glm::vec3 a = mesh.positions[mesh.indices[3 * triangle]];
+    glm::vec3 b = mesh.positions[mesh.indices[3 * triangle + 1]];
+    glm::vec3 c = mesh.positions[mesh.indices[3 * triangle + 2]];
+    return glm::cross(b - a, c - a);
+}
+
+void buildCharts(const BakeModel& model, std::vector<Chart>& charts) {
+    for (int m = 0; m < (int) model.meshes.size(); m++) {
+        const BakeMesh& mesh = model.meshes[m];
+        int triangleCount = (int) mesh.indices.size() / 3;
+        std::vector<int> group(triangleCount);
+        for (int t = 0; t < triangleCount; t++) {
+            glm::vec3 n = triangleNormal(mesh, t);
+            glm::vec3 a = glm::abs(n);
+            int axis = a.x >= a.y && a.x >= a.z ? 0 : (a.y >= a.z ? 1 : 2);
+            group[t] = 2 * axis + (n[axis] < 0.0f);
+        }
+
+        // triangles sharing a vertex and a group are joined
+        std::vector<int> parent(triangleCount);
+        std::iota(parent.begin(), parent.end(), 0);
+        std::vector<int> owner(mesh.positions.size() * 6, -1);
+        for (int t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++) {
+                int& first = owner[mesh.indices[3 * t + k] * 6 + group[t]];
+                if (first == -1)
+                    first = t;
+                else
+                    parent[findRoot(parent, t)] = findRoot(parent, first);
+            }
+
+        std::unordered_map<int, int> chartOfRoot;
+        for (int t = 0; t < triangleCount; t++) {
+            int root = findRoot(parent, t);
+            auto found = chartOfRoot.find(root);
+            if (found == chartOfRoot.end()) {
+                found = chartOfRoot.emplace(root, (int) charts.size()).first;
+                Chart chart;
+                chart.mesh = m;
+                chart.axis = group[t] / 2;
+                chart.min = glm::vec2(std::numeric_limits<float>::max());
+                chart.max = glm::vec2(-std::numeric_limits<float>::max());
+                charts.push_back(chart);
+            }
+            Chart& chart = charts[found->second];
+            chart.triangles.push_back(t);
+            for (int k = 0; k < 3; k++) {
+                glm::vec2 p = project(mesh.positions[mesh.indices[3 * t + k]], chart.axis);
+                chart.min = glm::vec2(std::min(chart.min.x, p.x), std::min(chart.min.y, p.y));
+                chart.max = glm::vec2(std::max(chart.max.x, p.x), std::max(chart.max.y, p.y));
+            }
+        }
+    }
+}
+
+// places the charts in a square of side `side`, returns the height used
+float shelfPack(std::vector<Chart>& charts, const std::vector<int>& order, float side, float padding) {
+    float x = 0.0f, y = 0.0f, shelfHeight = 0.0f;
+    for (int i: order) {
+        Chart& chart = charts[i];
+        glm::vec2 size = chart.max - chart.min + glm::vec2(padding);
+        if (x > 0.0f && x + size.x > side) {
+            x = 0.0f;
+            y += shelfHeight;
+            shelfHeight = 0.0f;
+        }
+        chart.offset = glm::vec2(x, y) + glm::vec2(padding * 0.5f);
+        x += size.x;
+        shelfHeight = std::max(shelfHeight, size.y);
+    }
+    return y + shelfHeight;
+}
+
+std::vector<LightmapMeshLayout> layoutModel(const BakeModel& model, int rectSize) {
+    std::vector<Chart> charts;
+    buildCharts(model, charts);
+
+    std::vector<int> order(charts.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return charts[a].max.y - charts[a].min.y > charts[b].max.y - charts[b].min.y;
+    });
+
+    float area = 0.0f, widest = 0.0f;
+    for (const Chart& chart: charts) {
+        area += (chart.max.x - chart.min.x) * (chart.max.y - chart.min.y);
+        widest = std::max(widest, chart.max.x - chart.min.x);
+    }
+    // the padding is fixed in texels, so it grows with the square; if there are too many charts for the
+    // rectangle the last attempt is squeezed in and the padding shrinks
+    float side = std::max(std::max(std::sqrt(area), widest * (1.0f + 2.0f * PADDING / rectSize)), 1e-4f);
+    float used = 0.0f;
+    for (int attempt = 0; attempt < 100; attempt++) {
+        used = shelfPack(charts, order, side, side * PADDING / rectSize);
+        if (used <= side)
+            break;
+        side *= 1.05f;
+    }
+    float scale = 1.0f / std::max(side, used);
+
+    std::vector<LightmapMeshLayout> layouts(model.meshes.size());
+    std::vector<std::unordered_map<uint64_t, uint32_t>> newVertex(model.meshes.size());
+    for (int c = 0; c < (int) charts.size(); c++) {
+        const Chart& chart = charts[c];
+        const BakeMesh& mesh = model.meshes[chart.mesh];
+        LightmapMeshLayout& layout = layouts[chart.mesh];
+        for (uint32_t t: chart.triangles)
+            for (int k = 0; k < 3; k++) {
+                uint32_t vertex = mesh.indices[3 * t + k];
+                // a vertex on the border of two charts is split in two
+                uint64_t key = (uint64_t) vertex << 32 | (uint32_t) c;
+                auto found = newVertex[chart.mesh].find(key);
+                if (found == newVertex[chart.mesh].end()) {
+                    found = newVertex[chart.mesh].emplace(key, (uint32_t) layout.remap.size()).first;
+                    layout.remap.push_back(vertex);
+                    layout.coords.push_back((project(mesh.positions[vertex], chart.axis) - chart.min + chart.offset) * scale);
+                }
+                layout.indices.push_back(found->second);
+            }
+    }
+    return layouts;
+}
+
+// BVH
+// ---
+// Binary tree built with median splits, then collapsed into a tree with four children per node, whose boxes
+// are tested against a ray all at once with SSE.
+
+struct Triangle {
+    glm::vec3 v0, e1, e2;
+    glm::vec3 normal;
+    glm::vec3 albedo;
+};
+
+struct alignas(16) BVHNode {
+    float minX[4], minY[4], minZ[4];
+    float maxX[4], maxY[4], maxZ[4];
+    // inner node index, or first triangle of a leaf
+    int child[4];
+    // triangles in a leaf, 0 for inner nodes, -1 for unused slots
+    int count[4];
+};
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float tMax;
+};
+
+class BVH {
+public:
+    explicit BVH(std::vector<Triangle> input) : triangles(std::move(input)) {
+        std::vector<int> indices(triangles.size());
+        std::iota(indices.begin(), indices.end(), 0);
+        centroids.resize(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i++)
+            centroids[i] = triangles[i].v0 + (triangles[i].e1 + triangles[i].e2) / 3.0f;
+        int root = buildBinary(indices, 0, (int) indices.size());
+
+        std::vector<Triangle> ordered(triangles.size());
+        for (size_t i = 0; i < indices.size(); i++)
+            ordered[i] = triangles[indices[i]];
+        triangles = std::move(ordered);
+
+        if (binary[root].count > 0) {
+            // a single leaf still needs a four wide node above it
+            nodes.emplace_back();
+            setEmpty(nodes[0]);
+            setChild(0, 0, binary[root], binary[root].first, binary[root].count);
+        } else
+            collapse(root);
+        binary.clear();
+        centroids.clear();
+    }
+
+    size_t triangleCount() const { return triangles.size(); }
+
+    // closest hit, returns the triangle or -1 and shortens ray.tMax to the hit
+    int closestHit(Ray& ray) const { return traverse(ray, false); }
+
+    bool occluded(Ray ray) const { return traverse(ray, true) >= 0; }
+
+    const Triangle& triangle(int index) const { return triangles[index]; }
+
+private:
+    struct BinaryNode {
+        glm::vec3 min, max;
+        int left, right;
+        int first, count;
+    };
+
+    std::vector<Triangle> triangles;
+    std::vector<glm::vec3> centroids;
+    std::vector<BinaryNode> binary;
+    std::vector<BVHNode> nodes;
+
+    static const int LEAF_SIZE = 4;
+
+    int buildBinary(std::vector<int>& indices, int begin, int end) {
+        BinaryNode node;
+        node.min = glm::vec3(std::numeric_limits<float>::max());
+        node.max = glm::vec3(-std::numeric_limits<float>::max());
+        glm::vec3 centroidMin = node.min, centroidMax = node.max;
+        for (int i = begin; i < end; i++) {
+            const Triangle& t = triangles[indices[i]];
+            for (glm::vec3 p: {t.v0, t.v0 + t.e1, t.v0 + t.e2}) {
+                node.min = glm::min(node.min, p);
+                node.max = glm::max(node.max, p);
+            }
+            centroidMin = glm::min(centroidMin, centroids[indices[i]]);
+            centroidMax = glm::max(centroidMax, centroids[indices[i]]);
+        }
+        int index = (int) binary.size();
+        binary.push_back(node);
+        if (end - begin <= LEAF_SIZE) {
+            binary[index].left = binary[index].right = -1;
+            binary[index].first = begin;
+            binary[index].count = end - begin;
+            return index;
+        }
+
+        glm::vec3 extent = centroidMax - centroidMin;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        int middle = (begin + end) / 2;
+        std::nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end,
+                         [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+        int left = buildBinary(indices, begin, middle);
+        int right = buildBinary(indices, middle, end);
+        binary[index].left = left;
+        binary[index].right = right;
+        binary[index].first = 0;
+        binary[index].count = 0;
+        return index;
+    }
+
+    static float surfaceArea(const BinaryNode& node) {
+        glm::vec3 d = node.max - node.min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    static void setEmpty(BVHNode& node) {
+        for (int i = 0; i < 4; i++) {
+            // far away boxes that no ray reaches within its tMax
+            node.minX[i] = node.minY[i] = node.minZ[i] = 1e30f;
+            node.maxX[i] = node.maxY[i] = node.maxZ[i] = 1e30f;
+            node.child[i] = 0;
+            node.count[i] = -1;
+        }
+    }
+
+    void setChild(int node, int slot, const BinaryNode& bounds, int child, int count) {
+        BVHNode& n = nodes[node];
+        n.minX[slot] = bounds.min.x;
+        n.minY[slot] = bounds.min.y;
+        n.minZ[slot] = bounds.min.z;
+        n.maxX[slot] = bounds.max.x;
+        n.maxY[slot] = bounds.max.y;
+        n.maxZ[slot] = bounds.max.z;
+        n.child[slot] = child;
+        n.count[slot] = count;
+    }
+
+    int collapse(int binaryIndex) {
+        int node = (int) nodes.size();
+        nodes.emplace_back();
+        setEmpty(nodes[node]);
+
+        // open the largest inner children until there are four
+        int children[4] = {binary[binaryIndex].left, binary[binaryIndex].right, -1, -1};
+        int childCount = 2;
+        while (childCount < 4) {
+            int best = -1;
+            for (int i = 0; i < childCount; i++)
+                if (binary[children[i]].count == 0 &&
+                    (best == -1 || surfaceArea(binary[children[i]]) > surfaceArea(binary[children[best]])))
+                    best = i;
+            if (best == -1)
+                break;
+            int opened = children[best];
+            children[best] = binary[opened].left;
+            children[childCount++] = binary[opened].right;
+        }
+
+        for (int i = 0; i < childCount; i++) {
+            const BinaryNode& child = binary[children[i]];
+            if (child.count > 0)
+                setChild(node, i, child, child.first, child.count);
+            else {
+                // collapse() grows the node vector, the slot is filled after it returns
+                int inner = collapse(children[i]);
+                setChild(node, i, child, inner, 0);
+            }
+        }
+        return node;
+    }
+
+    // Möller-Trumbore
+    static bool intersect(const Triangle& t, const Ray& ray, float& distance) {
+        glm::vec3 p = glm::cross(ray.direction, t.e2);
+        float det = glm::dot(t.e1, p);
+        if (std::fabs(det) < 1e-12f)
+            return false;
+        float invDet = 1.0f / det;
+        glm::vec3 s = ray.origin - t.v0;
+        float u = glm::dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f)
+            return false;
+        glm::vec3 q = glm::cross(s, t.e1);
+        float v = glm::dot(ray.direction, q) * invDet;
+        if (v < 0.0f || u + v > 1.0f)
+            return false;
+        distance = glm::dot(t.e2, q) * invDet;
+        return distance > 0.0f && distance < ray.tMax;
+    }
+
+    int traverse(Ray& ray, bool anyHit) const {
+        glm::vec3 inverse;
+        for (int i = 0; i < 3; i++) {
+            float d = ray.direction[i];
+            // keeps 0 * inf out of the slab test
+            if (std::fabs(d) < 1e-9f)
+                d = d < 0.0f ? -1e-9f : 1e-9f;
+            inverse[i] = 1.0f / d;
+        }
+        const __m128 originX = _mm_set1_ps(ray.origin.x), originY = _mm_set1_ps(ray.origin.y), originZ = _mm_set1_ps(ray.origin.z);
+        const __m128 inverseX = _mm_set1_ps(inverse.x), inverseY = _mm_set1_ps(inverse.y), inverseZ = _mm_set1_ps(inverse.z);
+        const __m128 zero = _mm_setzero_ps();
+
+        int hit = -1;
+        int stack[64];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            const BVHNode& node = nodes[stack[--stackSize]];
+            __m128 tMax = _mm_set1_ps(ray.tMax);
+            __m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), originX), inverseX);
+            __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), originX), inverseX);
+            __m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), originY), inverseY);
+            __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), originY), inverseY);
+            __m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), originZ), inverseZ);
+            __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), originZ), inverseZ);
+            __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), zero));
+            __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), tMax));
+            int mask = _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+            if (!mask)
+                continue;
+
+            alignas(16) float nearest[4];
+            _mm_store_ps(nearest, tNear);
+            // the farthest child goes on the stack first, so the nearest one is visited next; the at most four hit
+            // children are insertion sorted as they are found
+            int order[4];
+            int orderCount = 0;
+            for (int i = 0; i < 4; i++) {
+                if (!(mask & (1 << i)) || node.count[i] < 0)
+                    continue;
+                int k = orderCount++;
+                for (; k > 0 && nearest[order[k - 1]] < nearest[i]; k--)
+                    order[k] = order[k - 1];
+                order[k] = i;
+            }
+
+            for (int k = 0; k < orderCount; k++) {
+                int i = order[k];
+                if (node.count[i] == 0) {
+                    stack[stackSize++] = node.child[i];
+                    continue;
+                }
+                for (int t = node.child[i]; t < node.child[i] + node.count[i]; t++) {
+                    float distance;
+                    if (intersect(triangles[t], ray, distance)) {
+                        ray.tMax = distance;
+                        hit = t;
+                        if (anyHit)
+                            return hit;
+                    }
+                }
+            }
+        }
+        return hit;
+    }
+};
+
+// Baking
+// ------
+
+struct Texel {
+    glm::vec3 position;
+    glm::vec3 normal;
+    bool valid = false;
+};
+
+struct Random {
+    uint32_t state;
+
+    explicit Random(uint32_t seed) : state(seed * 747796405u + 2891336453u) {}
+
+    // PCG hash
+    float next() {
+        state = state * 747796405u + 2891336453u;
+        uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        word = (word >> 22u) ^ word;
+        return (word >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+glm::vec3 cosineSample(glm::vec3 normal, Random& random) {
+    float r = std::sqrt(random.next());
+    float phi = 6.28318530718f * random.next();
+    glm::vec3 tangent = std::fabs(normal.x) > 0.5f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    tangent = glm::normalize(glm::cross(tangent, normal));
+    glm::vec3 bitangent = glm::cross(normal, tangent);
+    return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) +
+           normal * std::sqrt(std::max(0.0f, 1.0f - r * r));
+}
+
+struct Light {
+    glm::vec3 toSun;
+    glm::vec3 sun;
+    glm::vec3 sky;
+};
+
+glm::vec3 sunLight(const BVH& bvh, const Light& light, glm::vec3 position, glm::vec3 normal) {
+    float cosine = glm::dot(normal, light.toSun);
+    if (cosine <= 0.0f || bvh.occluded(Ray{position, light.toSun, std::numeric_limits<float>::max()}))
+        return glm::vec3(0.0f);
+    return light.sun * cosine;
+}
+
+// light arriving at a texel, divided by pi, and the fraction of its hemisphere that is open within AO_DISTANCE
+glm::vec4 bakeTexel(const BVH& bvh, const Light& light, const Texel& texel, Random& random) {
+    glm::vec3 origin = texel.position + texel.normal * RAY_EPSILON;
+    glm::vec3 total = sunLight(bvh, light, origin, texel.normal);
+    glm::vec3 gathered(0.0f);
+    int open = 0;
+    for (int s = 0; s < LIGHTMAP_SAMPLES; s++) {
+        glm::vec3 position = origin, normal = texel.normal, throughput(1.0f);
+        for (int bounce = 0; bounce <= LIGHTMAP_BOUNCES; bounce++) {
+            Ray ray{position, cosineSample(normal, random), std::numeric_limits<float>::max()};
+            int hit = bvh.closestHit(ray);
+            if (bounce == 0 && (hit < 0 || ray.tMax > AO_DISTANCE))
+                open++;
+            if (hit < 0) {
+                gathered += throughput * light.sky;
+                break;
+            }
+            if (bounce == LIGHTMAP_BOUNCES)
+                break;
+            const Triangle& triangle = bvh.triangle(hit);
+            normal = glm::dot(triangle.normal, ray.direction) > 0.0f ? -triangle.normal : triangle.normal;
+            position = ray.origin + ray.direction * ray.tMax + normal * RAY_EPSILON;
+            throughput *= triangle.albedo;
+            gathered += throughput * sunLight(bvh, light, position, normal);
+        }
+    }
+    total += gathered / (float) LIGHTMAP_SAMPLES;
+    return glm::vec4(total, (float) open / LIGHTMAP_SAMPLES);
+}
+
+// writes the world space position and normal of the triangle into every texel whose center it covers
+void rasterize(std::vector<Texel>& texels, int atlasWidth, int atlasHeight, const glm::vec2 uv[3],
+               const glm::vec3 position[3], const glm::vec3 normal[3]) {
+    glm::vec2 p[3];
+    for (int k = 0; k < 3; k++)
+        p[k] = glm::vec2(uv[k].x * atlasWidth, uv[k].y * atlasHeight);
+    float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+    if (std::fabs(area) < 1e-12f)
+        return;
+    int x0 = std::max(0, (int) std::floor(std::min(p[0].x, std::min(p[1].x, p[2].x))));
+    int x1 = std::min(atlasWidth - 1, (int) std::ceil(std::max(p[0].x, std::max(p[1].x, p[2].x))));
+    int y0 = std::max(0, (int) std::floor(std::min(p[0].y, std::min(p[1].y, p[2].y))));
+    int y1 = std::min(atlasHeight - 1, (int) std::ceil(std::max(p[0].y, std::max(p[1].y, p[2].y))));
+    for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++) {
+            glm::vec2 c(x + 0.5f, y + 0.5f);
+            float w0 = ((p[1].x - c.x) * (p[2].y - c.y) - (p[2].x - c.x) * (p[1].y - c.y)) / area;
+            float w1 = ((p[2].x - c.x) * (p[0].y - c.y) - (p[0].x - c.x) * (p[2].y - c.y)) / area;
+            float w2 = 1.0f - w0 - w1;
+            if (w0 < -1e-4f || w1 < -1e-4f || w2 < -1e-4f)
+                continue;
+            Texel& texel = texels[y * atlasWidth + x];
+            texel.position = position[0] * w0 + position[1] * w1 + position[2] * w2;
+            glm::vec3 n = normal[0] * w0 + normal[1] * w1 + normal[2] * w2;
+            texel.normal = glm::length(n) > 0.0f ? glm::normalize(n) : glm::vec3(0.0f, 1.0f, 0.0f);
+            texel.valid = true;
+        }
+}
+
+// spreads the border texels of the charts into the padding around them
+void dilate(std::vector<glm::vec4>& texels, std::vector<bool>& valid, int width, int height) {
+    for (int pass = 0; pass < PADDING; pass++) {
+        std::vector<glm::vec4> result = texels;
+        std::vector<bool> resultValid = valid;
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++) {
+                if (valid[y * width + x])
+                    continue;
+                glm::vec4 sum(0.0f);
+                int count = 0;
+                for (int dy = -1; dy <= 1; dy++)
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int nx = x + dx, ny = y + dy;
+                        if (nx >= 0 && ny >= 0 && nx < width && ny < height && valid[ny * width + nx]) {
+                            sum += texels[ny * width + nx];
+                            count++;
+                        }
+                    }
+                if (count > 0) {
+                    result[y * width + x] = sum / (float) count;
+                    resultValid[y * width + x] = true;
+                }
+            }
+        texels = std::move(result);
+        valid = std::move(resultValid);
+    }
+}
+
+int main(int argc, char** argv) {
+    bool force = argc > 1 && std::strcmp(argv[1], "--force") == 0;
+    auto start = std::chrono::steady_clock::now();
+
+    StaticScene scene = buildStaticScene();
+    uint64_t hash = hashStaticScene(scene);
+    std::string path = lightmapPath(hash);
+    LightmapData existing;
+    if (!force && readLightmap(path, hash, existing)) {
+        std::cout << "Lightmap is up to date: " << path << std::endl;
+        return 0;
+    }
+
+    std::vector<BakeModel> models(scene.models.size());
+    for (size_t i = 0; i < scene.models.size(); i++)
+        if (!loadModel(scene.models[i], (int) i == MODEL_FLAG, models[i])) {
+            std::cout << "Failed to load " << scene.models[i] << ", nothing baked" << std::endl;
+            return 1;
+        }
+
+    // the seabed is the 100x100 plane quad, its lightmap coordinates are its texture coordinates over 15
+    BakeModel seabed;
+    {
+        BakeMesh quad;
+        quad.positions = {glm::vec3(50.0f, -1.0f, 50.0f), glm::vec3(-50.0f, -1.0f, -50.0f),
+                          glm::vec3(-50.0f, -1.0f, 50.0f), glm::vec3(50.0f, -1.0f, -50.0f)};
+        quad.normals.assign(4, glm::vec3(0.0f, 1.0f, 0.0f));
+        quad.indices = {0, 1, 2, 0, 3, 1};
+        quad.albedo = averageColor("resources/textures/sand.jpg", true, glm::vec3(0.6f));
+        seabed.meshes.push_back(quad);
+    }
+    LightmapMeshLayout seabedLayout;
+    seabedLayout.remap = {0, 1, 2, 3};
+    seabedLayout.coords = {glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 1.0f)};
+    seabedLayout.indices = seabed.meshes[0].indices;
+
+    // every instance of a model gets a square of the same size, big enough for its largest instance
+    std::vector<int> instanceRect(scene.instances.size());
+    std::vector<int> modelRect(models.size(), 0);
+    for (size_t i = 0; i < scene.instances.size(); i++) {
+        const StaticInstance& instance = scene.instances[i];
+        if (instance.model == MODEL_SEABED) {
+            instanceRect[i] = LIGHTMAP_MAX_RECT;
+            continue;
+        }
+        float area = 0.0f;
+        for (const BakeMesh& mesh: models[instance.model].meshes)
+            for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+                glm::vec3 a = glm::vec3(instance.transform * glm::vec4(mesh.positions[mesh.indices[t]], 1.0f));
+                glm::vec3 b = glm::vec3(instance.transform * glm::vec4(mesh.positions[mesh.indices[t + 1]], 1.0f));
+                glm::vec3 c = glm::vec3(instance.transform * glm::vec4(mesh.positions[mesh.indices[t + 2]], 1.0f));
+                area += 0.5f * glm::length(glm::cross(b - a, c - a));
+            }
+        // charts never fill their square completely
+        int size = (int) std::ceil(std::sqrt(area * 1.5f) * LIGHTMAP_TEXELS_PER_UNIT);
+        size = std::min(LIGHTMAP_MAX_RECT, std::max(32, (size + 3) / 4 * 4));
+        modelRect[instance.model] = std::max(modelRect[instance.model], size);
+    }
+    for (size_t i = 0; i < scene.instances.size(); i++)
+        if (scene.instances[i].model != MODEL_SEABED)
+            instanceRect[i] = modelRect[scene.instances[i].model];
+
+    LightmapData data;
+    for (size_t m = 0; m < models.size(); m++) {
+        std::cout << "Generating lightmap coordinates for " << scene.models[m] << std::endl;
+        data.layouts.push_back(layoutModel(models[m], modelRect[m]));
+    }
+
+    // shelf pack the instance squares into the atlas
+    std::vector<int> order(scene.instances.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return instanceRect[a] > instanceRect[b]; });
+    long long totalArea = 0;
+    for (int size: instanceRect)
+        totalArea += (long long) size * size;
+    data.width = 256;
+    while ((long long) data.width * data.width < totalArea)
+        data.width *= 2;
+    std::vector<glm::ivec2> instanceOrigin(scene.instances.size());
+    int x = 0, y = 0, shelfHeight = 0;
+    for (int i: order) {
+        if (x + instanceRect[i] > data.width) {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        instanceOrigin[i] = glm::ivec2(x, y);
+        x += instanceRect[i];
+        shelfHeight = std::max(shelfHeight, instanceRect[i]);
+    }
+    data.height = (y + shelfHeight + 3) / 4 * 4;
+    for (size_t i = 0; i < scene.instances.size(); i++)
+        data.instanceScaleOffset.push_back(glm::vec4(
+                (float) instanceRect[i] / data.width, (float) instanceRect[i] / data.height,
+                (float) instanceOrigin[i].x / data.width, (float) instanceOrigin[i].y / data.height));
+    std::cout << "Atlas: " << data.width << "x" << data.height << std::endl;
+
+    // world space triangles for the BVH and texels for the atlas
+    std::vector<Triangle> triangles;
+    std::vector<Texel> texels((size_t) data.width * data.height);
+    for (size_t i = 0; i < scene.instances.size(); i++) {
+        const StaticInstance& instance = scene.instances[i];
+        const BakeModel& model = instance.model == MODEL_SEABED ? seabed : models[instance.model];
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(instance.transform)));
+        glm::vec4 scaleOffset = data.instanceScaleOffset[i];
+        for (size_t m = 0; m < model.meshes.size(); m++) {
+            const BakeMesh& mesh = model.meshes[m];
+            std::vector<glm::vec3> positions(mesh.positions.size()), normals(mesh.normals.size());
+            for (size_t v = 0; v < mesh.positions.size(); v++) {
+                positions[v] = glm::vec3(instance.transform * glm::vec4(mesh.positions[v], 1.0f));
+                normals[v] = glm::normalize(normalMatrix * mesh.normals[v]);
+            }
+            for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+                glm::vec3 a = positions[mesh.indices[t]], b = positions[mesh.indices[t + 1]], c = positions[mesh.indices[t + 2]];
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                if (glm::length(normal) == 0.0f)
+                    continue;
+                triangles.push_back(Triangle{a, b - a, c - a, glm::normalize(normal), mesh.albedo});
+            }
+
+            const LightmapMeshLayout& layout = instance.model == MODEL_SEABED ? seabedLayout : data.layouts[instance.model][m];
+            for (size_t t = 0; t < layout.indices.size(); t += 3) {
+                glm::vec2 uv[3];
+                glm::vec3 position[3], normal[3];
+                for (int k = 0; k < 3; k++) {
+                    uint32_t vertex = layout.indices[t + k];
+                    uv[k] = layout.coords[vertex] * glm::vec2(scaleOffset.x, scaleOffset.y) + glm::vec2(scaleOffset.z, scaleOffset.w);
+                    position[k] = positions[layout.remap[vertex]];
+                    normal[k] = normals[layout.remap[vertex]];
+                }
+                rasterize(texels, data.width, data.height, uv, position, normal);
+            }
+        }
+    }
+
+    std::cout << "Building the BVH over " << triangles.size() << " triangles" << std::endl;
+    BVH bvh(std::move(triangles));
+
+    Light light;
+    light.toSun = glm::normalize(-scene.sunDirection);
+    light.sun = scene.sunDiffuse;
+    light.sky = scene.sunAmbient;
+
+    JobPool pool;
+    std::cout << "Baking with " << pool.threadCount() << " threads" << std::endl;
+    data.texels.assign(texels.size(), glm::vec4(0.0f));
+    std::atomic<int> rowsDone(0);
+    pool.parallelFor(data.height, [&](int row) {
+        for (int column = 0; column < data.width; column++) {
+            size_t index = (size_t) row * data.width + column;
+            if (!texels[index].valid)
+                continue;
+            Random random((uint32_t) index);
+            data.texels[index] = bakeTexel(bvh, light, texels[index], random);
+        }
+        int done = ++rowsDone;
+        if (done % 64 == 0)
+            std::cout << "  " << done << " / " << data.height << " rows" << std::endl;
+    });
+
+    std::vector<bool> valid(texels.size());
+    for (size_t i = 0; i < texels.size(); i++)
+        valid[i] = texels[i].valid;
+    dilate(data.texels, valid, data.width, data.height);
+
+    mkdir(LIGHTMAP_DIRECTORY, 0755);
+    if (!writeLightmap(path, hash, data)) {
+        std::cout << "Failed to write " << path << std::endl;
+        return 1;
+    }
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << path << " in " << seconds << " s" << std::endl;
+    return 0;
+}
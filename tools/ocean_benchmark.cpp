@@ -0,0 +1,102 @@
+// Measures the CPU side of the ocean (rg/Ocean.h): the 2D FFT on its own at 128, 256 and 512 on a side, on one
+// thread and on the job pool, checked against a direct DFT, and the whole per frame simulation at the same sizes.
+// Throughput is given in GFLOPS by the usual 5 n log2(n) operations per transformed line.
+
+#include <rg/FFT.h>
+#include <rg/JobPool.h>
+#include <rg/OceanSpectrum.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// transforms to time for every measurement, after one to warm up
+const int REPEATS = 50;
+
+template<typename F>
+double millisecondsPerRun(F run) {
+    run();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < REPEATS; i++)
+        run();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / REPEATS;
+}
+
+// largest difference between the FFT and a direct DFT, on a few rows of a random grid
+double fftError(int n) {
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::vector<float> re(n * n), im(n * n);
+    for (int i = 0; i < n * n; i++) {
+        re[i] = uniform(random);
+        im[i] = uniform(random);
+    }
+    std::vector<float> outRe = re, outIm = im;
+    FFT2D fft(n);
+    fft.transform(&outRe[0], &outIm[0], false);
+
+    const double pi = std::acos(-1.0);
+    double error = 0.0;
+    for (int v = 0; v < n; v += n / 4)
+        for (int u = 0; u < n; u += 7) {
+            double sumRe = 0.0, sumIm = 0.0;
+            for (int y = 0; y < n; y++)
+                for (int x = 0; x < n; x++) {
+                    double angle = -2.0 * pi * ((double) u * x + (double) v * y) / n;
+                    double c = std::cos(angle), s = std::sin(angle);
+                    sumRe += re[y * n + x] * c - im[y * n + x] * s;
+                    sumIm += re[y * n + x] * s + im[y * n + x] * c;
+                }
+            // relative to the expected magnitude of a sum of n * n random terms
+            double scale = 1.0 / n;
+            error = std::max(error, std::abs(sumRe - outRe[v * n + u]) * scale);
+            error = std::max(error, std::abs(sumIm - outIm[v * n + u]) * scale);
+        }
+    return error;
+}
+
+int main() {
+    JobPool pool;
+    std::printf("%u threads\n\n", pool.threadCount());
+
+    std::printf("%-10s %12s %10s %12s %10s %12s\n", "FFT", "1 thread ms", "GFLOPS", "pool ms", "GFLOPS", "error");
+    for (int n = 128; n <= 512; n *= 2) {
+        FFT2D fft(n);
+        std::vector<float> re(n * n, 1.0f), im(n * n, 0.0f);
+        bool inverse = false;
+        double single = millisecondsPerRun([&]() {
+            fft.transform(&re[0], &im[0], inverse);
+            inverse = !inverse;
+        });
+        double pooled = millisecondsPerRun([&]() {
+            fft.transform(&re[0], &im[0], inverse, &pool);
+            inverse = !inverse;
+        });
+        double gflops = fft.flops() * 1e-6;
+        std::printf("%4d x %-3d %12.3f %10.2f %12.3f %10.2f %12.2e\n", n, n, single, gflops / single, pooled,
+                    gflops / pooled, fftError(n));
+    }
+
+    std::printf("\n%-10s %12s %12s %10s\n", "Ocean", "evaluate ms", "write ms", "GFLOPS");
+    for (int n = 128; n <= 512; n *= 2) {
+        OceanParams params;
+        params.size = n;
+        OceanSpectrum spectrum(params);
+        std::vector<float> displacement(n * n * 4), slopes(n * n * 2);
+        float time = 0.0f;
+        double evaluate = millisecondsPerRun([&]() {
+            spectrum.evaluate(time, &pool);
+            time += 1.0f / 60.0f;
+        });
+        double write = millisecondsPerRun([&]() {
+            spectrum.write(&displacement[0], &slopes[0], &pool);
+        });
+        std::printf("%4d x %-3d %12.3f %12.3f %10.2f\n", n, n, evaluate, write,
+                    spectrum.fftFlops() * 1e-6 / evaluate);
+    }
+    return 0;
+}
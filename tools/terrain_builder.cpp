@@ -0,0 +1,165 @@
+// Builds the seabed terrain streamed by rg/Terrain.h: a pyramid of height tiles, see rg/TerrainFile.h.
+// Given a 16 bit grayscale heightmap and the heights its black and white stand for, the terrain is resampled
+// from it, e.g. a bathymetry export of the Sava and Danube confluence:
+//     terrain_builder confluence.png -24 4
+// Without one, a stand-in is generated: a wide channel running north to south with a narrower one joining it
+// from the west, on a gently rolling bed that rises into banks far from the scene.
+// Run it from the repository root, like the application.
+
+#include <stb_image.h>
+
+#include <rg/TerrainFile.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 32 level 0 tiles on a side of 16 units, half a unit between samples, 512 x 512 units in all
+const int LEVELS = 6;
+const float TILE_SIZE = 16.0f;
+
+float hash(int x, int z) {
+    uint32_t h = (uint32_t) x * 374761393u + (uint32_t) z * 668265263u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return (float) ((h ^ (h >> 16)) & 0xffffff) / (float) 0xffffff;
+}
+
+float valueNoise(float x, float z) {
+    int x0 = (int) std::floor(x), z0 = (int) std::floor(z);
+    float fx = x - x0, fz = z - z0;
+    fx = fx * fx * (3.0f - 2.0f * fx);
+    fz = fz * fz * (3.0f - 2.0f * fz);
+    float a = hash(x0, z0) + (hash(x0 + 1, z0) - hash(x0, z0)) * fx;
+    float b = hash(x0, z0 + 1) + (hash(x0 + 1, z0 + 1) - hash(x0, z0 + 1)) * fx;
+    return a + (b - a) * fz;
+}
+
+// depth of a river bed at the given distance from the middle of its channel
+float channel(float distance, float halfWidth, float depth) {
+    float t = std::min(distance / halfWidth, 1.0f);
+    return -depth * (1.0f - t * t) * (1.0f - t * t);
+}
+
+float standInHeight(float x, float z) {
+    float bed = -5.0f;
+    float amplitude = 0.6f, frequency = 1.0f / 24.0f;
+    for (int octave = 0; octave < 5; octave++) {
+        bed += (valueNoise(x * frequency, z * frequency) - 0.5f) * 2.0f * amplitude;
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+    // banks well away from the city, so the water stays open around it
+    float distance = std::sqrt(x * x + z * z);
+    bed += std::max(distance - 160.0f, 0.0f) * 0.06f;
+
+    float danube = std::fabs(x - 70.0f - 12.0f * std::sin(z / 70.0f));
+    float sava = x < 75.0f ? std::fabs(z + 20.0f - 10.0f * std::sin(x / 45.0f)) : 1e9f;
+    float river = std::min(channel(danube, 45.0f, 9.0f), channel(sava, 25.0f, 6.0f));
+    return bed + river;
+}
+
+struct Heightmap {
+    int width = 0, height = 0;
+    std::vector<uint16_t> values;
+    float low = 0.0f, high = 1.0f;
+
+    // bilinear, with the image stretched over the whole terrain
+    float sample(float u, float v) const {
+        float x = std::min(std::max(u, 0.0f), 1.0f) * (width - 1), y = std::min(std::max(v, 0.0f), 1.0f) * (height - 1);
+        int x0 = std::min((int) x, width - 2), y0 = std::min((int) y, height - 2);
+        float fx = x - x0, fy = y - y0;
+        auto at = [&](int px, int py) { return values[py * width + px] / 65535.0f; };
+        float a = at(x0, y0) + (at(x0 + 1, y0) - at(x0, y0)) * fx;
+        float b = at(x0, y0 + 1) + (at(x0 + 1, y0 + 1) - at(x0, y0 + 1)) * fx;
+        return low + (a + (b - a) * fy) * (high - low);
+    }
+};
+
+int main(int argc, char** argv) {
+    Heightmap heightmap;
+    if (argc > 1) {
+        if (argc < 4) {
+            std::cout << "Usage: terrain_builder [heightmap.png low high]" << std::endl;
+            return 1;
+        }
+        int channels;
+        stbi_us* pixels = stbi_load_16(argv[1], &heightmap.width, &heightmap.height, &channels, 1);
+        if (!pixels || heightmap.width < 2 || heightmap.height < 2) {
+            std::cout << "Failed to load " << argv[1] << std::endl;
+            return 1;
+        }
+        heightmap.values.assign(pixels, pixels + heightmap.width * heightmap.height);
+        stbi_image_free(pixels);
+        heightmap.low = (float) std::atof(argv[2]);
+        heightmap.high = (float) std::atof(argv[3]);
+    }
+
+    TerrainHeader header;
+    header.levels = LEVELS;
+    header.tileSize = TILE_SIZE;
+    int cells = header.tilesPerSide(0) * (TERRAIN_TILE_SAMPLES - 1);
+    int side = cells + 1;
+    float extent = TILE_SIZE * header.tilesPerSide(0);
+    header.originX = -extent / 2.0f;
+    header.originZ = -extent / 2.0f;
+
+    // every height of level 0, the other levels take their samples from it
+    std::vector<float> heights((size_t) side * side);
+    for (int z = 0; z < side; z++)
+        for (int x = 0; x < side; x++) {
+            float u = (float) x / cells, v = (float) z / cells;
+            heights[(size_t) z * side + x] = heightmap.values.empty()
+                    ? standInHeight(header.originX + u * extent, header.originZ + v * extent)
+                    : heightmap.sample(u, v);
+        }
+    auto range = std::minmax_element(heights.begin(), heights.end());
+    header.heightMin = *range.first;
+    header.heightRange = std::max(*range.second - *range.first, 1e-3f);
+
+    mkdir("resources/terrain", 0755);
+    std::ofstream out(TERRAIN_PATH, std::ios::binary);
+    if (!out) {
+        std::cout << "Failed to write " << TERRAIN_PATH << std::endl;
+        return 1;
+    }
+    out.write((const char*) &header, sizeof(header));
+    int tileCount = 0;
+    for (int level = LEVELS - 1; level >= 0; level--) {
+        int step = 1 << level;
+        int tileCells = (TERRAIN_TILE_SAMPLES - 1) * step;
+        for (int tz = 0; tz < header.tilesPerSide(level); tz++)
+            for (int tx = 0; tx < header.tilesPerSide(level); tx++) {
+                TerrainTile tile;
+                tile.minHeight = 1e9f;
+                tile.maxHeight = -1e9f;
+                for (int z = tz * tileCells; z <= (tz + 1) * tileCells; z++)
+                    for (int x = tx * tileCells; x <= (tx + 1) * tileCells; x++) {
+                        float h = heights[(size_t) z * side + x];
+                        tile.minHeight = std::min(tile.minHeight, h);
+                        tile.maxHeight = std::max(tile.maxHeight, h);
+                    }
+                for (int z = 0; z < TERRAIN_TILE_SAMPLES; z++)
+                    for (int x = 0; x < TERRAIN_TILE_SAMPLES; x++) {
+                        float h = heights[(size_t) (tz * tileCells + z * step) * side + tx * tileCells + x * step];
+                        float fraction = (h - header.heightMin) / header.heightRange;
+                        tile.samples.push_back((uint16_t) std::lround(std::min(std::max(fraction, 0.0f), 1.0f) * 65535.0f));
+                    }
+                writeTerrainTile(out, tile);
+                tileCount++;
+            }
+    }
+    if (!out) {
+        std::cout << "Failed to write " << TERRAIN_PATH << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << tileCount << " tiles in " << LEVELS << " levels, " << extent << " x " << extent
+              << " units, heights " << header.heightMin << " to " << header.heightMin + header.heightRange << ": "
+              << TERRAIN_PATH << std::endl;
+    return 0;
+}